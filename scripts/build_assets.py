@@ -0,0 +1,110 @@
+# build_assets.py
+# Packs data/ (including the .gz copies from compress_assets.py) into a
+# read-only bundle for the "assets" flash partition. The firmware maps the
+# partition and serves files straight from flash (src/AssetBundle.h).
+#
+# Layout, little endian:
+#   header   magic "AST1", count, total size, reserved      (4 x uint32)
+#   entries  path[32] (NUL-padded), offset, size, FNV-1a    (44 bytes each,
+#            sorted by path for binary search)
+#   data     each file, 4-byte aligned, offsets from the bundle start
+#
+# As a PlatformIO extra script it builds $BUILD_DIR/assets.bin before the
+# filesystem image and adds "pio run -t uploadassets". Standalone:
+#   python3 scripts/build_assets.py data assets.bin
+
+import csv
+import os
+import struct
+import sys
+
+MAGIC = 0x31545341  # "AST1"
+PATH_LEN = 32
+HEADER = struct.Struct("<IIII")
+ENTRY = struct.Struct("<%dsIII" % PATH_LEN)
+PARTITION_LABEL = "assets"
+
+
+def fnv1a(data):
+    value = 2166136261
+    for byte in data:
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value
+
+
+def pack(data_dir):
+    files = []
+    for root, _, names in os.walk(data_dir):
+        for name in names:
+            source = os.path.join(root, name)
+            path = "/" + os.path.relpath(source, data_dir).replace(os.sep, "/")
+            if len(path) >= PATH_LEN:
+                raise ValueError("%s: path longer than %d characters" % (path, PATH_LEN - 1))
+            with open(source, "rb") as f:
+                files.append((path.encode(), f.read()))
+    files.sort()
+
+    offset = HEADER.size + ENTRY.size * len(files)
+    entries = b""
+    blobs = b""
+    for path, content in files:
+        padding = (-offset) % 4
+        blobs += b"\0" * padding
+        offset += padding
+        entries += ENTRY.pack(path, offset, len(content), fnv1a(content))
+        blobs += content
+        offset += len(content)
+
+    return HEADER.pack(MAGIC, len(files), offset, 0) + entries + blobs
+
+
+def partition_offset(table, label):
+    with open(table) as f:
+        for row in csv.reader(line for line in f if not line.lstrip().startswith("#")):
+            if len(row) >= 5 and row[0].strip() == label:
+                return int(row[3].strip(), 0), int(row[4].strip(), 0)
+    raise ValueError("no %s partition in %s" % (label, table))
+
+
+def write_bundle(data_dir, target, limit=None):
+    bundle = pack(data_dir)
+    if limit is not None and len(bundle) > limit:
+        raise ValueError("asset bundle is %d bytes, partition holds %d" % (len(bundle), limit))
+    with open(target, "wb") as f:
+        f.write(bundle)
+    print("build_assets: %s, %d bytes" % (target, len(bundle)))
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3:
+        sys.exit("usage: build_assets.py DATA_DIR OUTPUT")
+    write_bundle(sys.argv[1], sys.argv[2])
+else:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+
+    table = os.path.join(env.subst("$PROJECT_DIR"), env.GetProjectOption("board_build.partitions"))  # noqa: F821
+    bundle_path = env.subst("$BUILD_DIR/assets.bin")  # noqa: F821
+
+    def build(*args, **kwargs):
+        _, size = partition_offset(table, PARTITION_LABEL)
+        write_bundle(env.subst("$PROJECT_DATA_DIR"), bundle_path, size)  # noqa: F821
+
+    def upload(*args, **kwargs):
+        build()
+        offset, _ = partition_offset(table, PARTITION_LABEL)
+        return env.Execute(" ".join([  # noqa: F821
+            env.subst("$PYTHONEXE"),  # noqa: F821
+            env.subst("$UPLOADER"),  # noqa: F821
+            "--chip", env.subst("$BOARD_MCU"),  # noqa: F821
+            "--port", '"%s"' % env.subst("$UPLOAD_PORT"),  # noqa: F821
+            "write_flash", hex(offset), bundle_path,
+        ]))
+
+    env.AddPreAction("$BUILD_DIR/spiffs.bin", build)  # noqa: F821
+    env.AddCustomTarget(  # noqa: F821
+        name="uploadassets",
+        dependencies=None,
+        actions=[upload],
+        title="Upload asset bundle",
+        description="Pack data/ and write it to the assets partition",
+    )
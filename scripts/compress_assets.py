@@ -0,0 +1,43 @@
+# compress_assets.py
+# PlatformIO extra script: writes a .gz next to every file in data/ so the
+# filesystem image carries both. The web server sends the .gz to clients
+# that accept gzip and the original to the rest.
+#
+# Output is deterministic (no timestamp in the gzip header), so unchanged
+# assets produce identical images.
+
+import gzip
+import os
+
+Import("env")  # noqa: F821 - provided by PlatformIO
+
+# Already compressed, gzip would only add bytes
+SKIP = (".gz", ".png", ".jpg", ".jpeg", ".ico")
+
+
+def compress_assets(*args, **kwargs):
+    data_dir = env.subst("$PROJECT_DATA_DIR")  # noqa: F821
+    if not os.path.isdir(data_dir):
+        return
+
+    for root, _, files in os.walk(data_dir):
+        for name in files:
+            if name.lower().endswith(SKIP):
+                continue
+            source = os.path.join(root, name)
+            target = source + ".gz"
+            if os.path.exists(target) and os.path.getmtime(target) >= os.path.getmtime(source):
+                continue
+
+            with open(source, "rb") as f:
+                raw = f.read()
+            with open(target, "wb") as out:
+                with gzip.GzipFile(filename="", mode="wb", compresslevel=9, fileobj=out, mtime=0) as gz:
+                    gz.write(raw)
+            print("compress_assets: %s %d -> %d bytes" % (name, len(raw), os.path.getsize(target)))
+
+
+# Before the filesystem image is built, and on every run so data/ is
+# current for uploadfs too
+env.AddPreAction("$BUILD_DIR/spiffs.bin", compress_assets)  # noqa: F821
+compress_assets()
@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+"""Concurrent request benchmark for the controller's web server.
+
+Opens N connections at once, each issuing requests back to back, and
+reports throughput and latency percentiles. With --stall, extra clients
+connect and send half a request head to show whether a slow client holds
+up everyone else.
+
+    python3 scripts/http_bench.py 192.168.4.1 --clients 4 --requests 50
+    python3 scripts/http_bench.py g20-controller.local --stall 2
+    python3 scripts/http_bench.py 192.168.4.1 --keep-alive --pipeline 4
+    python3 scripts/http_bench.py 192.168.4.1 --path /index.html --gzip
+
+Time to first byte is reported for fresh connections; run against a
+device with and without the assets partition uploaded to compare the
+mapped bundle with SPIFFS. --writes reads /api/http/stats around the run
+and reports socket sends per response, the server-side count of TCP
+segments started (with nodelay every send pushes at least one).
+"""
+
+import argparse
+import asyncio
+import json
+import time
+
+
+async def fetch(args, ttfbs, sizes):
+    start = time.perf_counter()
+    reader, writer = await asyncio.wait_for(asyncio.open_connection(args.host, args.port), args.timeout)
+    try:
+        writer.write(request_bytes(args, close=True))
+        await writer.drain()
+        first = await asyncio.wait_for(reader.read(1), args.timeout)
+        ttfbs.append(time.perf_counter() - start)
+        data = first + await asyncio.wait_for(reader.read(), args.timeout)
+    finally:
+        writer.close()
+    if data[9:12] != b"200":
+        raise RuntimeError(data.split(b"\r\n", 1)[0].decode(errors="replace"))
+    sizes.append(len(data))
+    return time.perf_counter() - start
+
+
+def request_bytes(args, close=False):
+    head = f"GET {args.path} HTTP/1.1\r\nHost: {args.host}\r\n"
+    if args.gzip:
+        head += "Accept-Encoding: gzip\r\n"
+    if close:
+        head += "Connection: close\r\n"
+    return (head + "\r\n").encode()
+
+
+async def read_response(reader, timeout):
+    head = await asyncio.wait_for(reader.readuntil(b"\r\n\r\n"), timeout)
+    length = 0
+    for line in head.split(b"\r\n"):
+        if line.lower().startswith(b"content-length:"):
+            length = int(line.split(b":", 1)[1])
+    await asyncio.wait_for(reader.readexactly(length), timeout)
+    if head[9:12] != b"200":
+        raise RuntimeError(head.split(b"\r\n", 1)[0].decode(errors="replace"))
+    return b"connection: close" not in head.lower()
+
+
+async def persistent_client(args, latencies, errors):
+    # One socket, `pipeline` requests in flight; reconnects when the
+    # server closes (request cap, keep-alive limit)
+    request = request_bytes(args)
+    remaining = args.requests
+    while remaining > 0:
+        try:
+            reader, writer = await asyncio.wait_for(asyncio.open_connection(args.host, args.port), args.timeout)
+        except (OSError, asyncio.TimeoutError) as error:
+            errors.append(error)
+            remaining -= 1
+            continue
+        try:
+            open_ = True
+            while open_ and remaining > 0:
+                batch = min(args.pipeline, remaining)
+                start = time.perf_counter()
+                writer.write(request * batch)
+                await writer.drain()
+                for _ in range(batch):
+                    open_ = await read_response(reader, args.timeout) and open_
+                    latencies.append(time.perf_counter() - start)
+                    remaining -= 1
+        except (OSError, asyncio.TimeoutError, asyncio.IncompleteReadError, RuntimeError) as error:
+            errors.append(error)
+            remaining -= 1
+        finally:
+            writer.close()
+
+
+async def client(args, latencies, errors, ttfbs, sizes):
+    if args.keep_alive:
+        await persistent_client(args, latencies, errors)
+        return
+    for _ in range(args.requests):
+        try:
+            latencies.append(await fetch(args, ttfbs, sizes))
+        except (OSError, asyncio.TimeoutError, RuntimeError) as error:
+            errors.append(error)
+
+
+async def staller(args, stop):
+    # Connects and never finishes the head - the server should time it out
+    reader, writer = await asyncio.open_connection(args.host, args.port)
+    writer.write(f"GET {args.path} HTTP/1.1\r\nHost: ".encode())
+    await writer.drain()
+    await stop.wait()
+    writer.close()
+
+
+async def server_stats(args):
+    reader, writer = await asyncio.wait_for(asyncio.open_connection(args.host, args.port), args.timeout)
+    try:
+        writer.write(f"GET /api/http/stats HTTP/1.1\r\nHost: {args.host}\r\nConnection: close\r\n\r\n".encode())
+        await writer.drain()
+        data = await asyncio.wait_for(reader.read(), args.timeout)
+    finally:
+        writer.close()
+    return json.loads(data.split(b"\r\n\r\n", 1)[1])
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--path", default="/api/vfd/status")
+    parser.add_argument("--clients", type=int, default=4)
+    parser.add_argument("--requests", type=int, default=50, help="per client")
+    parser.add_argument("--stall", type=int, default=0, help="clients that stop mid-head")
+    parser.add_argument("--gzip", action="store_true", help="send Accept-Encoding: gzip")
+    parser.add_argument("--keep-alive", action="store_true", help="reuse one connection per client")
+    parser.add_argument("--pipeline", type=int, default=1, help="requests in flight with --keep-alive")
+    parser.add_argument("--writes", action="store_true", help="report socket sends per response")
+    parser.add_argument("--timeout", type=float, default=15.0)
+    args = parser.parse_args()
+
+    stop = asyncio.Event()
+    stallers = [asyncio.create_task(staller(args, stop)) for _ in range(args.stall)]
+    await asyncio.sleep(0.2)
+
+    before = await server_stats(args) if args.writes else None
+    latencies, errors, ttfbs, sizes = [], [], [], []
+    start = time.perf_counter()
+    await asyncio.gather(*(client(args, latencies, errors, ttfbs, sizes) for _ in range(args.clients)))
+    elapsed = time.perf_counter() - start
+
+    stop.set()
+    await asyncio.gather(*stallers, return_exceptions=True)
+    after = await server_stats(args) if args.writes else None
+
+    print(f"{len(latencies)} ok, {len(errors)} failed in {elapsed:.2f} s "
+          f"({len(latencies) / elapsed:.1f} req/s)")
+    if latencies:
+        print(f"latency p50 {percentile(latencies, 0.50) * 1000:.1f} ms, "
+              f"p99 {percentile(latencies, 0.99) * 1000:.1f} ms, "
+              f"max {max(latencies) * 1000:.1f} ms")
+    if ttfbs:
+        print(f"first byte p50 {percentile(ttfbs, 0.50) * 1000:.1f} ms, "
+              f"p99 {percentile(ttfbs, 0.99) * 1000:.1f} ms")
+    if sizes:
+        print(f"{sum(sizes) / elapsed / 1024:.1f} KiB/s, {sum(sizes) // len(sizes)} bytes per response")
+    if before and after and after["requests"] > before["requests"]:
+        # The stats requests themselves are in the counts, one each way
+        writes = after["writes"] - before["writes"]
+        requests = after["requests"] - before["requests"]
+        print(f"{writes / requests:.2f} socket writes per response, "
+              f"{after['spilled'] - before['spilled']} spilled past the queue")
+    for error in errors[:5]:
+        print(f"  {error!r}")
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
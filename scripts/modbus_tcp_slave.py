@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""Modbus TCP slave for exercising the controller's TCP transport.
+
+Answers read holding/input registers (FC03/04) and write single/multiple
+registers (FC06/16) from an in-memory register map, echoing each request's
+MBAP transaction id. With --reorder, requests that arrive together are
+answered last-first, so a client that pipelines them has to match replies
+by transaction id rather than by order. Unit 0 is a broadcast: writes are
+applied and nothing is sent back.
+
+    python3 scripts/modbus_tcp_slave.py --port 5020
+    python3 scripts/modbus_tcp_slave.py --port 5020 --reorder --latency 20 -v
+
+Input register N reads back as N so reads can be checked; holding
+registers start at zero and keep what was written. Exceptions follow the
+spec: 01 for unsupported functions, 02 for addresses past the map, 03 for
+bad counts.
+"""
+
+import argparse
+import asyncio
+import struct
+
+REGISTERS = 0x10000
+
+FC_READ_HOLDING = 0x03
+FC_READ_INPUT = 0x04
+FC_WRITE_SINGLE = 0x06
+FC_WRITE_MULTIPLE = 0x10
+
+EX_ILLEGAL_FUNCTION = 0x01
+EX_ILLEGAL_ADDRESS = 0x02
+EX_ILLEGAL_VALUE = 0x03
+
+
+class Slave:
+    def __init__(self, args):
+        self.args = args
+        self.holding = [0] * REGISTERS
+        self.input = [i & 0xFFFF for i in range(REGISTERS)]
+        self.counts = {}
+        self.exceptions = 0
+        self.max_batch = 0
+
+    def handle(self, pdu):
+        """Returns the response PDU for one request PDU."""
+        function = pdu[0]
+        self.counts[function] = self.counts.get(function, 0) + 1
+        try:
+            if function in (FC_READ_HOLDING, FC_READ_INPUT):
+                address, count = struct.unpack(">HH", pdu[1:5])
+                if not 1 <= count <= 125 or len(pdu) != 5:
+                    raise ModbusException(EX_ILLEGAL_VALUE)
+                if address + count > REGISTERS:
+                    raise ModbusException(EX_ILLEGAL_ADDRESS)
+                table = self.holding if function == FC_READ_HOLDING else self.input
+                values = table[address:address + count]
+                return struct.pack(">BB%dH" % count, function, count * 2, *values)
+
+            if function == FC_WRITE_SINGLE:
+                if len(pdu) != 5:
+                    raise ModbusException(EX_ILLEGAL_VALUE)
+                address, value = struct.unpack(">HH", pdu[1:5])
+                self.holding[address] = value
+                return pdu[:5]
+
+            if function == FC_WRITE_MULTIPLE:
+                address, count, length = struct.unpack(">HHB", pdu[1:6])
+                if not 1 <= count <= 123 or length != count * 2 or len(pdu) != 6 + length:
+                    raise ModbusException(EX_ILLEGAL_VALUE)
+                if address + count > REGISTERS:
+                    raise ModbusException(EX_ILLEGAL_ADDRESS)
+                self.holding[address:address + count] = struct.unpack(">%dH" % count, pdu[6:])
+                return pdu[:5]
+
+            raise ModbusException(EX_ILLEGAL_FUNCTION)
+        except (ModbusException, struct.error) as error:
+            self.exceptions += 1
+            code = error.code if isinstance(error, ModbusException) else EX_ILLEGAL_VALUE
+            return bytes([function | 0x80, code])
+
+    async def serve(self, reader, writer):
+        peer = writer.get_extra_info("peername")
+        print(f"connected: {peer[0]}:{peer[1]}")
+        buffer = b""
+        try:
+            while True:
+                data = await reader.read(4096)
+                if not data:
+                    break
+                buffer += data
+
+                # Everything complete in the buffer is one batch
+                batch = []
+                while len(buffer) >= 7:
+                    transaction, protocol, length, unit = struct.unpack(">HHHB", buffer[:7])
+                    if protocol != 0 or length < 2 or length > 254:
+                        print(f"bad MBAP header from {peer[0]}, closing")
+                        return
+                    if len(buffer) < 6 + length:
+                        break
+                    batch.append((transaction, unit, buffer[7:6 + length]))
+                    buffer = buffer[6 + length:]
+                self.max_batch = max(self.max_batch, len(batch))
+
+                if self.args.reorder:
+                    batch.reverse()
+                for transaction, unit, pdu in batch:
+                    if self.args.latency:
+                        await asyncio.sleep(self.args.latency / 1000)
+                    response = self.handle(pdu)
+                    if self.args.verbose:
+                        print(f"  tid {transaction:5d} unit {unit:3d} fc {pdu[0]:02X} -> {response[:8].hex()}")
+                    if unit == 0:
+                        continue
+                    writer.write(struct.pack(">HHHB", transaction, 0, len(response) + 1, unit) + response)
+                await writer.drain()
+        except ConnectionError:
+            pass
+        finally:
+            writer.close()
+            print(f"disconnected: {peer[0]}:{peer[1]}")
+
+    def report(self):
+        names = {FC_READ_HOLDING: "FC03", FC_READ_INPUT: "FC04",
+                 FC_WRITE_SINGLE: "FC06", FC_WRITE_MULTIPLE: "FC16"}
+        counts = ", ".join(f"{names.get(fc, f'FC{fc:02X}')}={n}" for fc, n in sorted(self.counts.items()))
+        print(f"requests: {counts or 'none'}")
+        print(f"exceptions: {self.exceptions}, largest pipelined batch: {self.max_batch}")
+
+
+class ModbusException(Exception):
+    def __init__(self, code):
+        super().__init__(code)
+        self.code = code
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=502)
+    parser.add_argument("--reorder", action="store_true", help="answer pipelined requests last-first")
+    parser.add_argument("--latency", type=float, default=0, help="delay per response (ms)")
+    parser.add_argument("-v", "--verbose", action="store_true", help="log every request")
+    args = parser.parse_args()
+
+    slave = Slave(args)
+    server = await asyncio.start_server(slave.serve, args.host, args.port)
+    print(f"Modbus TCP slave on {args.host}:{args.port}")
+    try:
+        async with server:
+            await server.serve_forever()
+    finally:
+        slave.report()
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass
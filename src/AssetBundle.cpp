@@ -0,0 +1,76 @@
+// AssetBundle.cpp
+// Read-only web assets packed into their own flash partition, memory-mapped
+
+#include "AssetBundle.h"
+
+AssetBundle::AssetBundle() :
+    base(nullptr),
+    handle(0),
+    header(nullptr),
+    entries(nullptr)
+{
+}
+
+AssetBundle::~AssetBundle() {
+    unmap();
+}
+
+bool AssetBundle::begin() {
+    if (header) return true;
+
+    const esp_partition_t* partition = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)ASSET_PARTITION_SUBTYPE, ASSET_PARTITION_LABEL);
+    if (!partition) {
+        DEBUG_PRINTLN("AssetBundle: No assets partition");
+        return false;
+    }
+
+    // Whole partition in the data cache window - reads go through the
+    // flash cache, nothing is copied to RAM
+    const void* mapped = nullptr;
+    if (esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &mapped, &handle) != ESP_OK) {
+        DEBUG_PRINTLN("AssetBundle: Failed to map partition");
+        return false;
+    }
+    base = (const uint8_t*)mapped;
+
+    // Erased flash or a bundle that does not fit is left alone. The count
+    // is bounded by what the partition could index before it is
+    // multiplied, so a corrupt header cannot wrap indexEnd.
+    const AssetBundleHeader* candidate = (const AssetBundleHeader*)base;
+    size_t maxCount = (partition->size - sizeof(AssetBundleHeader)) / sizeof(AssetBundleEntry);
+    size_t indexEnd = sizeof(AssetBundleHeader) + (size_t)min(candidate->count, (uint32_t)maxCount) * sizeof(AssetBundleEntry);
+    if (candidate->magic != ASSET_BUNDLE_MAGIC || candidate->size > partition->size ||
+        candidate->count > maxCount || indexEnd > candidate->size) {
+        DEBUG_PRINTLN("AssetBundle: No bundle uploaded");
+        unmap();
+        return false;
+    }
+
+    // offset <= size is checked first, so neither side can wrap
+    const AssetBundleEntry* index = (const AssetBundleEntry*)(base + sizeof(AssetBundleHeader));
+    for (uint32_t i = 0; i < candidate->count; i++) {
+        const AssetBundleEntry& entry = index[i];
+        if (entry.path[ASSET_PATH_LEN - 1] != '\0' || entry.offset < indexEnd ||
+            entry.offset > candidate->size || entry.size > candidate->size - entry.offset ||
+            (i > 0 && strcmp(index[i - 1].path, entry.path) >= 0)) {
+            DEBUG_PRINTF("AssetBundle: Bad index entry %u\n", (unsigned)i);
+            unmap();
+            return false;
+        }
+    }
+
+    header = candidate;
+    entries = index;
+    DEBUG_PRINTF("AssetBundle: %u assets, %u bytes mapped\n", (unsigned)header->count, (unsigned)header->size);
+    return true;
+}
+
+void AssetBundle::unmap() {
+    if (base) {
+        spi_flash_munmap(handle);
+        base = nullptr;
+    }
+    header = nullptr;
+    entries = nullptr;
+}
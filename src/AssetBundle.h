@@ -0,0 +1,55 @@
+// AssetBundle.h
+// Read-only web assets packed into their own flash partition, memory-mapped
+
+#ifndef ASSET_BUNDLE_H
+#define ASSET_BUNDLE_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include "Config.h"
+
+#define ASSET_BUNDLE_MAGIC  0x31545341  // "AST1"
+#define ASSET_PATH_LEN      32
+
+// Written by scripts/build_assets.py; entries are sorted by path and
+// offsets count from the start of the bundle
+struct AssetBundleHeader {
+    uint32_t magic;
+    uint32_t count;
+    uint32_t size;          // Bytes used, header to last file
+    uint32_t reserved;
+};
+
+struct AssetBundleEntry {
+    char path[ASSET_PATH_LEN];  // NUL-padded
+    uint32_t offset;
+    uint32_t size;
+    uint32_t hash;          // FNV-1a of the contents
+};
+
+class AssetBundle {
+public:
+    AssetBundle();
+    ~AssetBundle();
+
+    // Maps the partition and checks the index; false leaves it unused
+    // (no partition, never uploaded, or corrupt)
+    bool begin();
+
+    bool isMapped() const { return header != nullptr; }
+    size_t getCount() const { return header ? header->count : 0; }
+    const AssetBundleEntry& getEntry(size_t index) const { return entries[index]; }
+
+    // Contents, readable in place for as long as the bundle is mapped
+    const uint8_t* data(const AssetBundleEntry& entry) const { return base + entry.offset; }
+
+private:
+    const uint8_t* base;
+    spi_flash_mmap_handle_t handle;
+    const AssetBundleHeader* header;
+    const AssetBundleEntry* entries;
+
+    void unmap();
+};
+
+#endif // ASSET_BUNDLE_H
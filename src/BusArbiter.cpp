@@ -0,0 +1,79 @@
+// BusArbiter.cpp
+// Shares the RS485 line between the internal poller and tunneled traffic
+
+#include "BusArbiter.h"
+
+BusArbiter::BusArbiter() :
+    hookTask(nullptr),
+    inBoundaryHook(false),
+    activeSource(BusSource::POLLER),
+    frameActive(false),
+    frameStartMicros(0),
+    statsStartTime(0)
+{
+    memset(stats, 0, sizeof(stats));
+    busMutex = xSemaphoreCreateMutex();
+}
+
+void BusArbiter::onFrameBoundary(std::function<void()> hook) {
+    boundaryHook = hook;
+    hookTask = xTaskGetCurrentTaskHandle();
+}
+
+void BusArbiter::frameBoundary() {
+    // Never re-enter: the hook itself issues frames
+    if (!boundaryHook || inBoundaryHook || frameActive) return;
+
+    // The hook owns sockets on its own task - don't run it from a control task
+    if (xTaskGetCurrentTaskHandle() != hookTask) return;
+
+    inBoundaryHook = true;
+    boundaryHook();
+    inBoundaryHook = false;
+}
+
+void BusArbiter::beginFrame(BusSource source) {
+    xSemaphoreTake(busMutex, portMAX_DELAY);
+
+    activeSource = source;
+    frameActive = true;
+    frameStartMicros = micros();
+}
+
+void BusArbiter::endFrame(bool success) {
+    if (!frameActive) return;
+
+    BusSourceStats& s = stats[(size_t)activeSource];
+    s.frames++;
+    if (!success) s.errors++;
+    s.busTimeUs += (uint32_t)(micros() - frameStartMicros);
+    s.lastFrameTime = millis();
+
+    frameActive = false;
+    xSemaphoreGive(busMutex);
+}
+
+const BusSourceStats& BusArbiter::getStats(BusSource source) const {
+    return stats[(size_t)source];
+}
+
+float BusArbiter::getUtilization(BusSource source) const {
+    uint32_t window = getStatsWindow();
+    if (window == 0) return 0.0;
+    return (stats[(size_t)source].busTimeUs / 1000.0) * 100.0 / window;
+}
+
+void BusArbiter::resetStats() {
+    memset(stats, 0, sizeof(stats));
+    statsStartTime = millis();
+}
+
+const char* BusArbiter::sourceName(BusSource source) {
+    switch (source) {
+        case BusSource::POLLER: return "poller";
+        case BusSource::COMMAND: return "command";
+        case BusSource::BRIDGE: return "bridge";
+        case BusSource::CONTROL: return "control";
+        default: return "unknown";
+    }
+}
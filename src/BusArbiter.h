@@ -0,0 +1,66 @@
+// BusArbiter.h
+// Shares the RS485 line between the internal poller and tunneled traffic
+
+#ifndef BUS_ARBITER_H
+#define BUS_ARBITER_H
+
+#include <Arduino.h>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Who is using the bus for a given frame
+enum class BusSource : uint8_t {
+    POLLER = 0,     // ModbusVFD status reads
+    COMMAND,        // ModbusVFD control/frequency writes
+    BRIDGE,         // Frames tunneled from the RTU-over-TCP bridge
+    CONTROL,        // Closed-loop control tasks (follower, PID, ...)
+    COUNT
+};
+
+// Per-source bus usage counters
+struct BusSourceStats {
+    uint32_t frames;
+    uint32_t errors;
+    uint64_t busTimeUs;
+    uint32_t lastFrameTime;
+};
+
+class BusArbiter {
+public:
+    BusArbiter();
+
+    // Hook run at every frame boundary of the bus owner. Used by the
+    // bridge to slip its pending frame in between poller frames. Only
+    // runs on the task that registered it.
+    void onFrameBoundary(std::function<void()> hook);
+    void frameBoundary();
+
+    // Bus time accounting around a single request/response exchange.
+    // beginFrame also takes the bus, so control tasks and the main loop
+    // never interleave on the wire; endFrame releases it.
+    void beginFrame(BusSource source);
+    void endFrame(bool success);
+
+    // Statistics
+    const BusSourceStats& getStats(BusSource source) const;
+    float getUtilization(BusSource source) const;
+    uint32_t getStatsWindow() const { return millis() - statsStartTime; }
+    void resetStats();
+
+    static const char* sourceName(BusSource source);
+
+private:
+    BusSourceStats stats[(size_t)BusSource::COUNT];
+    std::function<void()> boundaryHook;
+    TaskHandle_t hookTask;
+    bool inBoundaryHook;
+    SemaphoreHandle_t busMutex;
+
+    BusSource activeSource;
+    bool frameActive;
+    uint32_t frameStartMicros;
+    uint32_t statsStartTime;
+};
+
+#endif // BUS_ARBITER_H
@@ -0,0 +1,587 @@
+// CalendarScheduler.cpp
+// RTC-based calendar events (once, daily, weekly, monthly) dispatching VFD commands
+
+#include "CalendarScheduler.h"
+#include <SPIFFS.h>
+
+#define SCHEDULE_MAGIC      0x31484353  // "SCH1"
+#define SCHEDULE_TEMP_FILE  "/schedule.tmp"
+
+// Saved form of an event - next is recomputed on load
+struct __attribute__((packed)) ScheduleRecord {
+    uint16_t id;
+    uint32_t first;
+    uint16_t value;
+    uint8_t repeat;
+    uint8_t action;
+};
+
+struct __attribute__((packed)) ScheduleFileHeader {
+    uint32_t magic;
+    uint16_t count;
+    uint16_t reserved;
+};
+
+CalendarScheduler::CalendarScheduler(ModbusVFD& vfd, PCF85063& rtc) :
+    vfd(vfd),
+    rtc(rtc),
+    task(nullptr),
+    heapSize(0),
+    freeHead(SCHEDULE_NO_EVENT),
+    syncEpoch(0),
+    syncMillis(0),
+    lastSyncAttempt(0),
+    clockValid(false),
+    dirty(false)
+{
+    memset(&stats, 0, sizeof(stats));
+    stats.lastEvent = SCHEDULE_NO_EVENT;
+    resetLocked();
+}
+
+CalendarScheduler::~CalendarScheduler() {
+    if (task) {
+        vTaskDelete(task);
+    }
+}
+
+bool CalendarScheduler::begin() {
+    if (task) return true;
+
+    if (!rtc.begin()) {
+        DEBUG_PRINTLN("CalendarScheduler: RTC not available - events will not fire");
+    }
+    syncClock();
+
+    if (load()) {
+        DEBUG_PRINTF("CalendarScheduler: Loaded %d events\n", heapSize);
+    }
+
+    BaseType_t created = xTaskCreatePinnedToCore(
+        taskEntry,
+        "CalendarScheduler",
+        VFD_CONTROL_TASK_STACK,
+        this,
+        VFD_CONTROL_TASK_PRIORITY,
+        &task,
+        VFD_CONTROL_TASK_CORE
+    );
+    if (created != pdPASS) {
+        task = nullptr;
+        DEBUG_PRINTLN("CalendarScheduler: Failed to create task");
+        return false;
+    }
+
+    DEBUG_PRINTLN("CalendarScheduler: Initialized");
+    DEBUG_PRINTF("  Capacity: %d events, clock %s\n", SCHEDULE_MAX_EVENTS, clockValid ? "valid" : "not set");
+    return true;
+}
+
+int CalendarScheduler::add(uint32_t first, ScheduleRepeat repeat, ScheduleAction action, float frequency) {
+    if ((uint8_t)repeat > (uint8_t)ScheduleRepeat::MONTHLY) return -1;
+    if ((uint8_t)action > (uint8_t)ScheduleAction::SET_FREQUENCY) return -1;
+
+    ScheduleEvent event;
+    memset(&event, 0, sizeof(event));
+    event.first = first;
+    event.repeat = (uint8_t)repeat;
+    event.action = (uint8_t)action;
+    event.value = action == ScheduleAction::SET_FREQUENCY ? (uint16_t)(frequency * 100 + 0.5) : 0;
+
+    // Without a valid clock everything is kept and rescheduled on setTime()
+    event.next = nextOccurrence(event, clockValid ? now() : 0);
+    if (event.next == 0) return -1;
+
+    portENTER_CRITICAL(&lock);
+    int id = insertLocked(event);
+    portEXIT_CRITICAL(&lock);
+
+    if (id >= 0) {
+        dirty = true;
+        if (task) xTaskNotifyGive(task);
+    }
+    return id;
+}
+
+bool CalendarScheduler::remove(uint16_t id) {
+    if (id >= SCHEDULE_MAX_EVENTS) return false;
+
+    portENTER_CRITICAL(&lock);
+    bool used = events[id].heapIndex != SCHEDULE_NO_EVENT;
+    if (used) removeLocked(id);
+    portEXIT_CRITICAL(&lock);
+
+    if (used) {
+        dirty = true;
+        if (task) xTaskNotifyGive(task);
+    }
+    return used;
+}
+
+void CalendarScheduler::clear() {
+    portENTER_CRITICAL(&lock);
+    resetLocked();
+    portEXIT_CRITICAL(&lock);
+
+    dirty = true;
+    if (task) xTaskNotifyGive(task);
+}
+
+bool CalendarScheduler::getEvent(uint16_t id, ScheduleEvent& event) {
+    if (id >= SCHEDULE_MAX_EVENTS) return false;
+
+    portENTER_CRITICAL(&lock);
+    event = events[id];
+    portEXIT_CRITICAL(&lock);
+    return event.heapIndex != SCHEDULE_NO_EVENT;
+}
+
+int CalendarScheduler::peekNext() {
+    portENTER_CRITICAL(&lock);
+    int id = heapSize > 0 ? heap[0] : -1;
+    portEXIT_CRITICAL(&lock);
+    return id;
+}
+
+uint32_t CalendarScheduler::now() {
+    portENTER_CRITICAL(&lock);
+    uint32_t epoch = syncEpoch + (millis() - syncMillis) / 1000;
+    portEXIT_CRITICAL(&lock);
+    return epoch;
+}
+
+bool CalendarScheduler::setTime(uint32_t epoch) {
+    if (!rtc.setEpoch(epoch)) return false;
+
+    portENTER_CRITICAL(&lock);
+    syncEpoch = epoch;
+    syncMillis = millis();
+    portEXIT_CRITICAL(&lock);
+    clockValid = true;
+
+    // Every pending occurrence may have moved relative to the new time
+    rebuild(epoch);
+    dirty = true;
+    if (task) xTaskNotifyGive(task);
+
+    DEBUG_PRINTF("CalendarScheduler: Clock set, %d events rescheduled\n", heapSize);
+    return true;
+}
+
+ScheduleStats CalendarScheduler::getStats() {
+    portENTER_CRITICAL(&lock);
+    ScheduleStats copy = stats;
+    portEXIT_CRITICAL(&lock);
+    return copy;
+}
+
+void CalendarScheduler::taskEntry(void* param) {
+    static_cast<CalendarScheduler*>(param)->run();
+}
+
+void CalendarScheduler::run() {
+    while (true) {
+        if (millis() - lastSyncAttempt >= SCHEDULE_RTC_SYNC_MS) {
+            syncClock();
+        }
+
+        if (dirty) {
+            dirty = false;
+            if (!save()) {
+                DEBUG_PRINTLN("CalendarScheduler: Failed to save events");
+            }
+        }
+
+        if (clockValid) {
+            uint32_t current = now();
+
+            // Only the heap root is ever compared - O(1) per idle tick,
+            // O(log n) per fired event
+            while (true) {
+                portENTER_CRITICAL(&lock);
+                if (heapSize == 0 || events[heap[0]].next > current) {
+                    portEXIT_CRITICAL(&lock);
+                    break;
+                }
+
+                uint16_t id = heap[0];
+                ScheduleEvent event = events[id];
+                portEXIT_CRITICAL(&lock);
+
+                bool overdue = current - event.next > SCHEDULE_LATE_LIMIT;
+                uint32_t next = nextOccurrence(event, current);
+
+                // remove(), add() or a rebuild may have replaced the root
+                // while the lock was released - look at the new one
+                portENTER_CRITICAL(&lock);
+                if (heapSize == 0 || heap[0] != id || !sameEvent(events[id], event) ||
+                    events[id].next != event.next) {
+                    portEXIT_CRITICAL(&lock);
+                    continue;
+                }
+
+                updateLocked(id, next);
+                if (next == 0) {
+                    dirty = true;
+                }
+
+                if (overdue) {
+                    stats.missed++;
+                } else {
+                    stats.fired++;
+                    stats.lastFired = event.next;
+                    stats.lastEvent = id;
+                }
+                portEXIT_CRITICAL(&lock);
+
+                // Long overdue (clock jumped forward, or we were off) -
+                // a stale start command is worse than none
+                if (!overdue) {
+                    DEBUG_PRINTF("CalendarScheduler: Event %d: %s\n", id,
+                                 actionName((ScheduleAction)event.action));
+                    dispatch(event);
+                }
+            }
+        }
+
+        // add(), remove() and setTime() wake us early
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SCHEDULE_TICK_MS));
+    }
+}
+
+void CalendarScheduler::syncClock() {
+    lastSyncAttempt = millis();
+
+    RTCDateTime time;
+    if (!rtc.readTime(time)) {
+        portENTER_CRITICAL(&lock);
+        stats.rtcErrors++;
+        portEXIT_CRITICAL(&lock);
+
+        // Keep extrapolating from the last good read
+        return;
+    }
+
+    uint32_t epoch = PCF85063::toEpoch(time);
+    uint32_t expected = now();
+
+    portENTER_CRITICAL(&lock);
+    syncEpoch = epoch;
+    syncMillis = millis();
+    portEXIT_CRITICAL(&lock);
+
+    bool wasValid = clockValid;
+    clockValid = rtc.isTimeValid();
+
+    // A backward step would skip the occurrences now ahead of us again
+    if (clockValid && (!wasValid || epoch + 2 < expected)) {
+        rebuild(epoch);
+    }
+}
+
+void CalendarScheduler::dispatch(const ScheduleEvent& event) {
+    // Through the command queue like every other source of setpoints
+    switch ((ScheduleAction)event.action) {
+        case ScheduleAction::START_FORWARD:
+            vfd.requestCommand(CMD_RUN_FWD);
+            break;
+        case ScheduleAction::START_REVERSE:
+            vfd.requestCommand(CMD_RUN_REV);
+            break;
+        case ScheduleAction::STOP:
+            vfd.requestCommand(CMD_STOP);
+            break;
+        case ScheduleAction::SET_FREQUENCY:
+            vfd.requestFrequency(event.value / 100.0);
+            break;
+    }
+}
+
+void CalendarScheduler::rebuild(uint32_t from) {
+    // One event at a time so the critical sections stay short; the heap
+    // is valid after every step, and the task keeps firing from it
+    for (uint16_t id = 0; id < SCHEDULE_MAX_EVENTS; id++) {
+        portENTER_CRITICAL(&lock);
+        ScheduleEvent event = events[id];
+        portEXIT_CRITICAL(&lock);
+        if (event.heapIndex == SCHEDULE_NO_EVENT) continue;
+
+        uint32_t next = nextOccurrence(event, from > 0 ? from - 1 : 0);
+
+        portENTER_CRITICAL(&lock);
+        if (events[id].heapIndex != SCHEDULE_NO_EVENT && sameEvent(events[id], event)) {
+            // A one-shot that is already in the past goes
+            updateLocked(id, next);
+            if (next == 0) {
+                dirty = true;
+            }
+        }
+        portEXIT_CRITICAL(&lock);
+    }
+}
+
+bool CalendarScheduler::load() {
+    File file = SPIFFS.open(SCHEDULE_FILE, FILE_READ);
+    if (!file) return false;
+
+    ScheduleFileHeader header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != SCHEDULE_MAGIC || header.count > SCHEDULE_MAX_EVENTS) {
+        file.close();
+        DEBUG_PRINTLN("CalendarScheduler: Ignoring invalid schedule file");
+        return false;
+    }
+
+    // Mark saved slots used, then thread the free list through the rest
+    portENTER_CRITICAL(&lock);
+    resetLocked();
+    portEXIT_CRITICAL(&lock);
+
+    // Runs before the task starts, so the slots are filled in directly
+    uint32_t current = clockValid ? now() : 0;
+    for (uint16_t i = 0; i < header.count; i++) {
+        ScheduleRecord record;
+        if (file.read((uint8_t*)&record, sizeof(record)) != sizeof(record)) break;
+        if (record.id >= SCHEDULE_MAX_EVENTS || record.repeat > (uint8_t)ScheduleRepeat::MONTHLY ||
+            record.action > (uint8_t)ScheduleAction::SET_FREQUENCY) continue;
+        if (events[record.id].heapIndex != SCHEDULE_NO_EVENT) continue;
+
+        ScheduleEvent& event = events[record.id];
+        event.first = record.first;
+        event.value = record.value;
+        event.repeat = record.repeat;
+        event.action = record.action;
+        event.next = nextOccurrence(event, current > 0 ? current - 1 : 0);
+        if (event.next == 0) {
+            dirty = true;  // One-shot that is already in the past
+            continue;
+        }
+        event.heapIndex = heapSize;
+        heap[heapSize++] = record.id;
+    }
+    file.close();
+
+    portENTER_CRITICAL(&lock);
+    freeHead = SCHEDULE_NO_EVENT;
+    for (int id = SCHEDULE_MAX_EVENTS - 1; id >= 0; id--) {
+        if (events[id].heapIndex == SCHEDULE_NO_EVENT) {
+            events[id].value = freeHead;
+            freeHead = id;
+        }
+    }
+
+    // Bottom-up heapify, O(n)
+    for (int position = heapSize / 2 - 1; position >= 0; position--) {
+        siftDown(position);
+    }
+    portEXIT_CRITICAL(&lock);
+    return true;
+}
+
+bool CalendarScheduler::save() {
+    File file = SPIFFS.open(SCHEDULE_TEMP_FILE, FILE_WRITE);
+    if (!file) return false;
+
+    ScheduleFileHeader header;
+    header.magic = SCHEDULE_MAGIC;
+    header.count = heapSize;
+    header.reserved = 0;
+    bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+
+    // Slot order keeps ids stable across reboots
+    uint16_t written = 0;
+    for (uint16_t id = 0; ok && id < SCHEDULE_MAX_EVENTS; id++) {
+        portENTER_CRITICAL(&lock);
+        ScheduleEvent event = events[id];
+        portEXIT_CRITICAL(&lock);
+        if (event.heapIndex == SCHEDULE_NO_EVENT) continue;
+
+        ScheduleRecord record;
+        record.id = id;
+        record.first = event.first;
+        record.value = event.value;
+        record.repeat = event.repeat;
+        record.action = event.action;
+        ok = file.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+        written++;
+    }
+
+    // The count may have changed while writing (an event fired)
+    if (ok && written != header.count) {
+        header.count = written;
+        ok = file.seek(0) && file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+    }
+    file.close();
+
+    if (!ok) {
+        SPIFFS.remove(SCHEDULE_TEMP_FILE);
+        return false;
+    }
+    SPIFFS.remove(SCHEDULE_FILE);
+    return SPIFFS.rename(SCHEDULE_TEMP_FILE, SCHEDULE_FILE);
+}
+
+uint32_t CalendarScheduler::nextOccurrence(const ScheduleEvent& event, uint32_t after) {
+    if (event.first > after) return event.first;
+
+    switch ((ScheduleRepeat)event.repeat) {
+        case ScheduleRepeat::DAILY:
+        case ScheduleRepeat::WEEKLY: {
+            uint32_t period = event.repeat == (uint8_t)ScheduleRepeat::DAILY ? 86400 : 604800;
+            return event.first + ((after - event.first) / period + 1) * period;
+        }
+
+        case ScheduleRepeat::MONTHLY: {
+            RTCDateTime anchor, candidate;
+            PCF85063::fromEpoch(event.first, anchor);
+            PCF85063::fromEpoch(after, candidate);
+            candidate.day = anchor.day;
+            candidate.hour = anchor.hour;
+            candidate.minute = anchor.minute;
+            candidate.second = anchor.second;
+
+            // At most two months in a row lack a given day (e.g. 31st)
+            for (uint8_t i = 0; i < 13; i++) {
+                if (anchor.day <= PCF85063::daysInMonth(candidate.year, candidate.month)) {
+                    uint32_t next = PCF85063::toEpoch(candidate);
+                    if (next > after) return next;
+                }
+                if (++candidate.month > 12) {
+                    candidate.month = 1;
+                    candidate.year++;
+                }
+            }
+            return 0;
+        }
+
+        case ScheduleRepeat::ONCE:
+        default:
+            return 0;
+    }
+}
+
+bool CalendarScheduler::sameEvent(const ScheduleEvent& a, const ScheduleEvent& b) {
+    return a.first == b.first && a.repeat == b.repeat && a.action == b.action && a.value == b.value;
+}
+
+int CalendarScheduler::insertLocked(const ScheduleEvent& event) {
+    if (freeHead == SCHEDULE_NO_EVENT) return -1;
+
+    uint16_t id = freeHead;
+    freeHead = events[id].value;
+
+    events[id] = event;
+    events[id].heapIndex = heapSize;
+    heap[heapSize] = id;
+    siftUp(heapSize++);
+    return id;
+}
+
+void CalendarScheduler::removeLocked(uint16_t id) {
+    uint16_t position = events[id].heapIndex;
+    uint16_t last = --heapSize;
+
+    if (position != last) {
+        heap[position] = heap[last];
+        events[heap[position]].heapIndex = position;
+        siftDown(position);
+        siftUp(position);
+    }
+
+    events[id].heapIndex = SCHEDULE_NO_EVENT;
+    events[id].value = freeHead;
+    freeHead = id;
+}
+
+void CalendarScheduler::updateLocked(uint16_t id, uint32_t next) {
+    if (next == 0) {
+        removeLocked(id);
+        return;
+    }
+
+    uint16_t position = events[id].heapIndex;
+    events[id].next = next;
+    siftDown(position);
+    siftUp(events[id].heapIndex);
+}
+
+void CalendarScheduler::siftUp(uint16_t position) {
+    while (position > 0) {
+        uint16_t parent = (position - 1) / 2;
+        if (events[heap[parent]].next <= events[heap[position]].next) break;
+        swap(position, parent);
+        position = parent;
+    }
+}
+
+void CalendarScheduler::siftDown(uint16_t position) {
+    while (true) {
+        uint16_t smallest = position;
+        uint16_t left = 2 * position + 1;
+        uint16_t right = left + 1;
+
+        if (left < heapSize && events[heap[left]].next < events[heap[smallest]].next) smallest = left;
+        if (right < heapSize && events[heap[right]].next < events[heap[smallest]].next) smallest = right;
+        if (smallest == position) break;
+
+        swap(position, smallest);
+        position = smallest;
+    }
+}
+
+void CalendarScheduler::swap(uint16_t a, uint16_t b) {
+    uint16_t id = heap[a];
+    heap[a] = heap[b];
+    heap[b] = id;
+    events[heap[a]].heapIndex = a;
+    events[heap[b]].heapIndex = b;
+}
+
+void CalendarScheduler::resetLocked() {
+    heapSize = 0;
+    freeHead = 0;
+    for (uint16_t id = 0; id < SCHEDULE_MAX_EVENTS; id++) {
+        events[id].heapIndex = SCHEDULE_NO_EVENT;
+        events[id].value = id + 1 < SCHEDULE_MAX_EVENTS ? id + 1 : SCHEDULE_NO_EVENT;
+    }
+}
+
+const char* CalendarScheduler::repeatName(ScheduleRepeat repeat) {
+    switch (repeat) {
+        case ScheduleRepeat::ONCE: return "once";
+        case ScheduleRepeat::DAILY: return "daily";
+        case ScheduleRepeat::WEEKLY: return "weekly";
+        case ScheduleRepeat::MONTHLY: return "monthly";
+        default: return "unknown";
+    }
+}
+
+const char* CalendarScheduler::actionName(ScheduleAction action) {
+    switch (action) {
+        case ScheduleAction::START_FORWARD: return "start";
+        case ScheduleAction::START_REVERSE: return "reverse";
+        case ScheduleAction::STOP: return "stop";
+        case ScheduleAction::SET_FREQUENCY: return "frequency";
+        default: return "unknown";
+    }
+}
+
+bool CalendarScheduler::parseRepeat(const char* text, ScheduleRepeat& repeat) {
+    for (uint8_t i = 0; i <= (uint8_t)ScheduleRepeat::MONTHLY; i++) {
+        if (strcmp(text, repeatName((ScheduleRepeat)i)) == 0) {
+            repeat = (ScheduleRepeat)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CalendarScheduler::parseAction(const char* text, ScheduleAction& action) {
+    for (uint8_t i = 0; i <= (uint8_t)ScheduleAction::SET_FREQUENCY; i++) {
+        if (strcmp(text, actionName((ScheduleAction)i)) == 0) {
+            action = (ScheduleAction)i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,122 @@
+// CalendarScheduler.h
+// RTC-based calendar events (once, daily, weekly, monthly) dispatching VFD commands
+
+#ifndef CALENDAR_SCHEDULER_H
+#define CALENDAR_SCHEDULER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "Config.h"
+#include "ModbusVFD.h"
+#include "PCF85063.h"
+
+#define SCHEDULE_NO_EVENT   0xFFFF
+
+enum class ScheduleRepeat : uint8_t {
+    ONCE = 0,
+    DAILY,
+    WEEKLY,     // Same weekday and time as the first occurrence
+    MONTHLY     // Same day of month; months without that day are skipped
+};
+
+enum class ScheduleAction : uint8_t {
+    START_FORWARD = 0,
+    START_REVERSE,
+    STOP,
+    SET_FREQUENCY
+};
+
+// One event: 16 bytes, plus 2 in the heap
+struct ScheduleEvent {
+    uint32_t first;         // First occurrence (RTC local time, s since 1970)
+    uint32_t next;          // Next fire time
+    uint16_t value;         // Hz x100 for SET_FREQUENCY; free-list link when unused
+    uint16_t heapIndex;     // SCHEDULE_NO_EVENT when the slot is free
+    uint8_t repeat;         // ScheduleRepeat
+    uint8_t action;         // ScheduleAction
+    uint16_t reserved;
+};
+
+struct ScheduleStats {
+    uint32_t fired;
+    uint32_t missed;        // Occurrences skipped over by a clock jump or downtime
+    uint32_t lastFired;     // Fire time of the most recent event
+    uint16_t lastEvent;
+    uint32_t rtcErrors;
+};
+
+class CalendarScheduler {
+public:
+    CalendarScheduler(ModbusVFD& vfd, PCF85063& rtc);
+    ~CalendarScheduler();
+
+    // Loads saved events and starts the dispatch task
+    bool begin();
+
+    // Returns the event id, or -1 if full / invalid / already past (ONCE)
+    int add(uint32_t first, ScheduleRepeat repeat, ScheduleAction action, float frequency = 0);
+    bool remove(uint16_t id);
+    void clear();
+
+    bool getEvent(uint16_t id, ScheduleEvent& event);
+    size_t getEventCount() const { return heapSize; }
+    int peekNext();                 // Id of the earliest event, -1 if none
+
+    // Current time (RTC, advanced with millis() between resyncs)
+    uint32_t now();
+    bool isClockValid() const { return clockValid; }
+    bool setTime(uint32_t epoch);
+
+    ScheduleStats getStats();
+
+    static const char* repeatName(ScheduleRepeat repeat);
+    static const char* actionName(ScheduleAction action);
+    static bool parseRepeat(const char* text, ScheduleRepeat& repeat);
+    static bool parseAction(const char* text, ScheduleAction& action);
+
+private:
+    ModbusVFD& vfd;
+    PCF85063& rtc;
+    TaskHandle_t task;
+
+    // Events live in a fixed pool; the heap orders pool indices by next
+    // fire time, and each event knows its heap slot for O(log n) removal
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    ScheduleEvent events[SCHEDULE_MAX_EVENTS];
+    uint16_t heap[SCHEDULE_MAX_EVENTS];
+    uint16_t heapSize;
+    uint16_t freeHead;
+    ScheduleStats stats;
+
+    // Clock: RTC read at syncMillis, extrapolated in between
+    uint32_t syncEpoch;
+    uint32_t syncMillis;
+    uint32_t lastSyncAttempt;
+    volatile bool clockValid;
+    volatile bool dirty;
+
+    static void taskEntry(void* param);
+    void run();
+    void syncClock();
+    void dispatch(const ScheduleEvent& event);
+    void rebuild(uint32_t from);
+    bool load();
+    bool save();
+
+    // Calendar math - call outside the critical section, then check the
+    // slot still holds the same event before storing the result
+    static uint32_t nextOccurrence(const ScheduleEvent& event, uint32_t after);
+    static bool sameEvent(const ScheduleEvent& a, const ScheduleEvent& b);
+
+    // Heap primitives - call inside the critical section
+    int insertLocked(const ScheduleEvent& event);
+    void removeLocked(uint16_t id);
+    void updateLocked(uint16_t id, uint32_t next);
+    void siftUp(uint16_t position);
+    void siftDown(uint16_t position);
+    void swap(uint16_t a, uint16_t b);
+    void resetLocked();
+};
+
+#endif // CALENDAR_SCHEDULER_H
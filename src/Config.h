@@ -16,6 +16,125 @@
 #define MODBUS_TIMEOUT  100   // Timeout in milliseconds (reduced for faster response)
 #define MODBUS_READ_OFFSET 0  // Some G20 models need -1 offset for read addresses
 #define MODBUS_RTU_SILENCE 15 // Silent interval for RTU mode (>10ms required)
+#define MODBUS_MAX_BLOCK_REGISTERS 12 // Drive limit per FC03/FC16 request (manual ch. 5)
+
+// Raw RTU frame settings (tunneled traffic)
+#define RTU_RAW_TIMEOUT     500   // Wait for first response byte (ms)
+#define RTU_FRAME_SLACK_US  2000  // Extra silence on top of 3.5 chars before frame end
+
+// Drive link: RS485 (default) or Modbus TCP via an RTU-to-TCP gateway
+#define VFD_TRANSPORT_TCP       false
+#define VFD_TCP_HOST            "192.168.1.50"
+#define VFD_TCP_PORT            502
+#define MODBUS_TCP_TIMEOUT      1000  // Response timeout per request (ms)
+#define MODBUS_TCP_MAX_IN_FLIGHT 4    // Pipelined requests per batch
+#define MODBUS_TCP_RECONNECT_MS 2000  // Backoff between connect attempts
+
+// RTU-over-TCP bridge (drive configuration software over WiFi)
+#define RTU_BRIDGE_ENABLED  true
+#define RTU_BRIDGE_PORT     4001  // Raw TCP port, RTU frames incl. CRC
+#define RTU_BRIDGE_IDLE_MS  20    // Gap that ends a frame of unknown length
+#define RTU_BRIDGE_CLIENT_TIMEOUT 300000  // Drop silent clients after 5 min
+
+// Modbus RTU slave endpoint on a second UART (for RTU-only PLCs)
+// Serves cached drive data from memory, never touches the drive bus.
+#define RTU_SLAVE_ENABLED   false
+#define RTU_SLAVE_SERIAL    Serial2
+#define RTU_SLAVE_TX_PIN    43    // UART0 pins are free with USB CDC on boot
+#define RTU_SLAVE_RX_PIN    44
+#define RTU_SLAVE_DE_PIN    -1    // -1 for auto-direction transceivers
+#define RTU_SLAVE_BAUD_RATE 9600
+#define RTU_SLAVE_CONFIG    SERIAL_8N1
+#define RTU_SLAVE_ID        10    // Our address on the PLC's RTU network
+
+// Status polling
+#define VFD_POLL_INTERVAL   100   // Drive status poll period (ms)
+
+// Telemetry history (every status poll). Capacities must be powers of
+// two; 1.5 MB of PSRAM holds ~3.6 h at the 100 ms poll interval.
+#define TELEMETRY_RING_RECORDS          131072  // 12 bytes each, PSRAM
+#define TELEMETRY_RING_FALLBACK_RECORDS 2048    // Internal RAM when no PSRAM
+#define TREND_MAX_BUCKETS               2000    // Per /api/trend?buckets= query
+#define TREND_SAMPLES_PER_CALL          4096    // Ring samples a download goes through per producer call
+
+// Long-term telemetry log on SPIFFS: delta/varint-packed blocks written
+// whole, ~1300 samples per block at 1 s - 512 KB is roughly two days
+#define TELEMETRY_LOG_INTERVAL_MS       1000    // Log at most one poll per interval
+#define TELEMETRY_LOG_BLOCK             4096    // RAM block flushed per write (one erase block)
+#define TELEMETRY_LOG_FILE_BLOCKS       16      // 64 KB per file
+#define TELEMETRY_LOG_MAX_FILES         8       // Oldest file deleted beyond this
+#define TELEMETRY_LOG_DIR               "/tlog"
+#define TELEMETRY_LOG_TASK_PRIORITY     1       // Below the control tasks
+#define TELEMETRY_LOG_TASK_CORE         0
+
+// Fault flight recorder: every poll goes through a rolling pre-trigger
+// window, frozen when 0x2100 shows a new fault or warning code
+#define FLIGHT_PRE_SAMPLES              100     // 10 s at the poll interval
+#define FLIGHT_POST_SAMPLES             50
+#define FLIGHT_MAX_EVENTS               16      // Oldest saved event deleted beyond this
+#define FLIGHT_DIR                      "/flight"
+
+// Drive groups (broadcast setpoints for drives sharing the link)
+#define VFD_GROUP_MAX_DRIVES     8
+#define VFD_GROUP_TURNAROUND_MS  100   // Slave processing time after a broadcast
+#define VFD_GROUP_VERIFY_TIMEOUT 2000  // Stop confirming after (ms)
+#define VFD_GROUP_FREQ_TOLERANCE 1     // Frequency readback tolerance (Hz x100)
+
+// Control tasks (follower loop, PID, ...) - above loop() on the same core
+#define VFD_CONTROL_TASK_PRIORITY 3
+#define VFD_CONTROL_TASK_CORE     1
+#define VFD_CONTROL_TASK_STACK    4096
+
+// Master/follower ratio loop. Each tick is three frames (leader read,
+// follower write, follower read); with the 15 ms RTU silent intervals
+// that is ~110 ms at 9600 baud, so keep the period above that.
+#define VFD_FOLLOWER_ENABLED      false  // Engage at boot
+#define VFD_FOLLOWER_LEADER_ID    1
+#define VFD_FOLLOWER_ID           2
+#define VFD_FOLLOWER_PERIOD_MS    200
+#define VFD_FOLLOWER_SLEW         10.0   // Default slew limit (Hz/s)
+
+// Polling scheduler: periodic block reads for control loops, run on a
+// bus task together with the command queue
+#define POLL_MAX_ENTRIES          8
+#define POLL_MAX_REGISTERS        4     // Per entry
+
+// On-controller PID (process variable from drive AI or local ADC)
+#define PID_ENABLED               false // Engage at boot
+#define PID_PERIOD_MS             200
+#define PID_ADC_PIN               1     // Local ADC channel (GPIO)
+
+// Relay autotuner for the drive's own PID (P08.01-P08.03)
+#define AUTOTUNE_CYCLES           3      // Oscillations measured after one settling cycle
+#define AUTOTUNE_TIMEOUT_MS       180000 // Abort if the loop never oscillates
+#define AUTOTUNE_MAX_SAMPLES_GAP  500    // Abort on a read gap longer than (ms)
+
+// Setpoint ramp generator (streams through the command queue)
+#define RAMP_UPDATE_MS            100    // Setpoint update period
+#define RAMP_SCURVE_TIME          1.0    // Default time to reach full ramp rate (s)
+
+// Multi-step speed table upload
+#define PRESET_MERGE_GAP          3      // Rewrite up to this many unchanged registers to save a frame
+
+// Recipe engine (timed multi-step programs stored on SPIFFS). Step
+// deadlines are kept in RTOS ticks (1 ms with the Arduino core defaults).
+#define RECIPE_MAX_STEPS          32
+#define RECIPE_NAME_LEN           16     // Incl. terminator; SPIFFS paths max 31 chars
+#define RECIPE_DIR                "/recipes"
+#define RECIPE_CONDITION_POLL_MS  20     // Telemetry condition check period
+
+// PCF85063 RTC on the board's I2C bus
+#define RTC_SDA_PIN               39
+#define RTC_SCL_PIN               38
+#define RTC_I2C_ADDRESS           0x51
+#define RTC_YEAR_OFFSET           2000   // Year register is 0-99; the chip's leap years assume 2000
+
+// Calendar scheduler (events kept in a min-heap of next fire times)
+#define SCHEDULE_MAX_EVENTS       256    // 18 bytes of RAM each
+#define SCHEDULE_TICK_MS          100    // Heap root check period
+#define SCHEDULE_RTC_SYNC_MS      60000  // Re-read the RTC, millis() in between
+#define SCHEDULE_LATE_LIMIT       60     // Skip occurrences overdue by more than (s)
+#define SCHEDULE_FILE             "/schedule.bin"
 
 // G20 VFD Modbus Register Addresses (from G20_AppC_IO_Parm_Maps.pdf)
 // Common G20 addressing: subtract 1 from documentation addresses
@@ -44,6 +163,25 @@
 #define REG_TORQUE_READ         0x2113  // Output torque (XXX.X %)
 #define REG_MOTOR_SPEED_READ    0x2114  // Actual motor speed (XXXXX rpm)
 
+// Multi-step speeds 1-15 (P04.00-P04.14, XXX.XX Hz) - one block
+#define REG_MULTI_STEP_SPEED    0x0400
+#define PRESET_STEPS            15
+
+// Drive accel/decel time 1 (P01.12/P01.13, XXX.XX s) - adjacent
+#define REG_ACCEL_TIME          0x010C
+#define REG_DECEL_TIME          0x010D
+
+// Drive PID parameters (group 08) - P08.00-P08.03 are one block
+#define REG_PID_FEEDBACK_SEL    0x0800  // P08.00 PID feedback terminal (0 = disabled)
+#define REG_PID_P_GAIN          0x0801  // P08.01 Proportional gain (XXX.X)
+#define REG_PID_I_TIME          0x0802  // P08.02 Integral time (XX.XX s)
+#define REG_PID_D_TIME          0x0803  // P08.03 Derivative time (X.XX s)
+
+// Extended monitor block (Delta-family layout, verify on the drive)
+#define REG_PID_FEEDBACK_READ   0x220A  // PID feedback value (XXX.XX %)
+#define REG_AI1_READ            0x220B  // AI1 analog input (XXX.X %)
+#define REG_AI2_READ            0x220C  // AI2 analog input (XXX.X %)
+
 // Alternative read addresses (for compatibility)
 #define REG_STATUS_READ_ALT     0x2100  // Same as primary
 #define REG_FREQUENCY_READ_ALT  0x2101  // Same as primary
@@ -57,6 +195,9 @@
 #define CMD_JOG_FWD     0x0013  // 0001 0011: JOG+Run + FWD
 #define CMD_JOG_REV     0x0023  // 0010 0011: JOG+Run + REV
 #define CMD_RESET       0x0000  // 0000 0000: No function/reset
+// Bits 11-8: multi-step speed 1-15 (0 = master frequency), bit 12 enables them
+#define CMD_STEP_SHIFT  8
+#define CMD_STEP_ENABLE 0x1000
 
 // Additional control bits for 0x2002
 // Bit 0: E.F. (External Fault) ON
@@ -77,6 +218,46 @@
 #define WEB_SERVER_PORT 80
 #define WS_PORT         81
 
+// HTTP connections served at once, each with its own request/response buffers
+#define HTTP_MAX_CONNECTIONS    4
+#define HTTP_REQUEST_BUFFER     2048    // Head and a short body, a longer head gets 431
+#define HTTP_BODY_LIMIT         8192    // Longer body received apart, else 413 (full recipe ~5 KB)
+#define HTTP_RESPONSE_BUFFER    2048    // Queued response bytes, more spills to the heap
+#define HTTP_SPILL_LIMIT        65536   // Response bytes past the queue, per connection
+#define HTTP_PRODUCE_PER_PASS   8192    // Body bytes a producer adds per connection and pass
+#define HTTP_HEAD_BUFFER        320     // Status line and headers of one response
+#define HTTP_CHUNK_BUFFER       1024    // Data per chunk of a streamed response
+#define HTTP_HEADER_TIMEOUT_MS  5000
+#define HTTP_BODY_TIMEOUT_MS    5000
+#define HTTP_WRITE_TIMEOUT_MS   10000
+
+// Persistent connections - fewer than HTTP_MAX_CONNECTIONS, and counted
+// together with event streams, so idle sockets never lock out a new client
+#define HTTP_MAX_KEEPALIVE      3
+#define HTTP_KEEPALIVE_TIMEOUT_MS 5000  // Idle time between requests
+#define HTTP_MAX_REQUESTS_PER_CONNECTION 100
+#define HTTP_MAX_PATH_PARAMS    4       // {name} segments per route
+
+// Static file caching. Names with a hex version part (app.3f2a91c0.js)
+// never change content and may be cached for good; anything else is
+// revalidated against its ETag on every use.
+#define HTTP_CACHE_VERSIONED    "public, max-age=31536000, immutable"
+#define HTTP_CACHE_DEFAULT      "no-cache"
+#define HTTP_VERSION_MIN_DIGITS 8
+
+// Server-sent status events on /api/events. Streams hold an HTTP slot
+// for good, so fewer than HTTP_MAX_CONNECTIONS, kept-alive ones included.
+#define HTTP_MAX_EVENT_STREAMS  2
+#define SSE_MIN_INTERVAL_MS     250     // Fastest a client may ask for (the broadcast rate)
+#define SSE_MAX_INTERVAL_MS     30000   // Slowest, so proxies see traffic
+#define SSE_RETRY_MS            2000    // Reconnect delay sent to clients
+#define SSE_MAX_REPLAY          32      // Ring samples resent on Last-Event-ID, as queue room allows
+
+// Web asset bundle partition (partitions.csv, scripts/build_assets.py);
+// served from mapped flash ahead of SPIFFS when present
+#define ASSET_PARTITION_LABEL   "assets"
+#define ASSET_PARTITION_SUBTYPE 0x40
+
 // Version Information
 #define FIRMWARE_VERSION "0.1.0"
 #define HARDWARE_VERSION "ESP32-S3"
@@ -0,0 +1,298 @@
+// DriveGroup.cpp
+// Synchronized setpoints for several drives on one link via Modbus broadcast
+
+#include "DriveGroup.h"
+
+// Verification block: 0x2100 error, 0x2101 status, 0x2102 frequency
+// command, 0x2103 output frequency - one read per drive
+#define GROUP_BLOCK_START   REG_ERROR_STATUS
+#define GROUP_BLOCK_COUNT   4
+#define GROUP_BLOCK_STATUS  1
+#define GROUP_BLOCK_FREQ    2
+
+DriveGroup::DriveGroup(ModbusTransport& transport) :
+    transport(transport),
+    memberCount(0),
+    minFrequency(0.0),
+    maxFrequency(60.0),
+    verifying(false),
+    verifyStart(0),
+    dispatchStart(0),
+    correctionsPending(0),
+    nextPoll(0)
+{
+    memset(members, 0, sizeof(members));
+    memset(&result, 0, sizeof(result));
+}
+
+DriveGroup::~DriveGroup() {
+}
+
+bool DriveGroup::addDrive(uint8_t slaveId, float ratio) {
+    if (slaveId == MODBUS_BROADCAST_ID || slaveId > 247 || ratio <= 0) return false;
+    if (findMember(slaveId)) return setRatio(slaveId, ratio);
+    if (memberCount >= VFD_GROUP_MAX_DRIVES) return false;
+
+    GroupMember& member = members[memberCount++];
+    memset(&member, 0, sizeof(member));
+    member.slaveId = slaveId;
+    member.ratio = ratio;
+    return true;
+}
+
+bool DriveGroup::setRatio(uint8_t slaveId, float ratio) {
+    GroupMember* member = findMember(slaveId);
+    if (!member || ratio <= 0) return false;
+    member->ratio = ratio;
+    return true;
+}
+
+void DriveGroup::clear() {
+    memberCount = 0;
+    verifying = false;
+    correctionsPending = 0;
+}
+
+void DriveGroup::setLimits(float minFrequency, float maxFrequency) {
+    this->minFrequency = minFrequency;
+    this->maxFrequency = maxFrequency;
+}
+
+bool DriveGroup::setFrequency(float frequencyHz) {
+    if (memberCount == 0) return false;
+
+    uint16_t base = toRegister(frequencyHz);
+    uint32_t dispatchStart = micros();
+
+    if (!broadcast(REG_FREQUENCY_WRITE, base)) return false;
+    beginVerify(false, base, dispatchStart);
+
+    // Every member now runs at the base setpoint; the ones whose ratio
+    // puts them somewhere else get a unicast from handle() after the
+    // turnaround, so the request that made the change doesn't wait for it
+    for (size_t i = 0; i < memberCount; i++) {
+        GroupMember& member = members[i];
+        member.expected = toRegister(frequencyHz * member.ratio);
+        member.lastMissMicros = dispatchStart;
+        if (member.expected != base) {
+            member.correctionPending = true;
+            correctionsPending++;
+        }
+    }
+    result.unicastWrites = correctionsPending;
+
+    DEBUG_PRINTF("DriveGroup: Frequency %.2f Hz to %d drives (%d ratio writes queued)\n",
+                 base / 100.0, memberCount, correctionsPending);
+    return true;
+}
+
+bool DriveGroup::sendCommand(uint16_t command) {
+    if (memberCount == 0) return false;
+
+    uint32_t dispatchStart = micros();
+    if (!broadcast(REG_CONTROL_WRITE, command)) return false;
+
+    beginVerify(true, command, dispatchStart);
+    for (size_t i = 0; i < memberCount; i++) {
+        members[i].expected = command;
+        members[i].lastMissMicros = dispatchStart;
+    }
+
+    DEBUG_PRINTF("DriveGroup: Command 0x%04X to %d drives\n", command, memberCount);
+    return true;
+}
+
+void DriveGroup::handle() {
+    if (!verifying) return;
+
+    // Give the drives their turnaround time before the first poll
+    unsigned long elapsed = millis() - verifyStart;
+    if (elapsed < VFD_GROUP_TURNAROUND_MS) return;
+
+    // Ratio corrections first, one frame per call
+    if (correctionsPending > 0) {
+        sendCorrection();
+        return;
+    }
+
+    if (elapsed >= VFD_GROUP_VERIFY_TIMEOUT) {
+        finishVerify();
+        return;
+    }
+
+    // One block read per call, round robin over unconfirmed drives
+    for (size_t tried = 0; tried < memberCount; tried++) {
+        GroupMember& member = members[nextPoll];
+        nextPoll = (nextPoll + 1) % memberCount;
+        if (member.confirmed) continue;
+
+        pollMember(member);
+        break;
+    }
+
+    if (result.confirmed == result.members) {
+        finishVerify();
+    }
+}
+
+bool DriveGroup::broadcast(uint16_t address, uint16_t value) {
+    BusArbiter& arbiter = transport.getArbiter();
+    arbiter.frameBoundary();
+    arbiter.beginFrame(BusSource::COMMAND);
+
+    uint8_t status = transport.writeSingleRegister(MODBUS_BROADCAST_ID, address, value);
+    arbiter.endFrame(status == MODBUS_OK);
+
+    if (status != MODBUS_OK) {
+        DEBUG_PRINTF("DriveGroup: Broadcast to 0x%04X failed (0x%02X)\n", address, status);
+        return false;
+    }
+    return true;
+}
+
+bool DriveGroup::writeMember(uint8_t slaveId, uint16_t address, uint16_t value) {
+    BusArbiter& arbiter = transport.getArbiter();
+    arbiter.beginFrame(BusSource::COMMAND);
+
+    uint8_t status = transport.writeSingleRegister(slaveId, address, value);
+    arbiter.endFrame(status == MODBUS_OK);
+    return status == MODBUS_OK;
+}
+
+void DriveGroup::sendCorrection() {
+    for (size_t i = 0; i < memberCount; i++) {
+        GroupMember& member = members[i];
+        if (!member.correctionPending) continue;
+
+        member.correctionPending = false;
+        correctionsPending--;
+        member.lastMissMicros = micros();
+        if (!writeMember(member.slaveId, REG_FREQUENCY_WRITE, member.expected)) {
+            // Verification reports the drive as unconfirmed
+            DEBUG_PRINTF("DriveGroup: Ratio write to drive %d failed\n", member.slaveId);
+        }
+        break;
+    }
+
+    // Dispatch ends with the last frame of the change
+    if (correctionsPending == 0) {
+        result.dispatchMicros = micros() - dispatchStart;
+    }
+}
+
+void DriveGroup::beginVerify(bool isCommand, uint16_t value, uint32_t dispatchStart) {
+    uint32_t now = micros();
+
+    uint32_t sequence = result.sequence + 1;
+    memset(&result, 0, sizeof(result));
+    result.sequence = sequence;
+    result.isCommand = isCommand;
+    result.value = value;
+    result.members = memberCount;
+    result.dispatchMicros = now - dispatchStart;
+    this->dispatchStart = dispatchStart;
+    correctionsPending = 0;
+
+    for (size_t i = 0; i < memberCount; i++) {
+        members[i].correctionPending = false;
+        members[i].confirmed = false;
+        members[i].confirmMicros = 0;
+        members[i].lastError = MODBUS_OK;
+    }
+
+    verifying = true;
+    verifyStart = millis();
+    nextPoll = 0;
+}
+
+void DriveGroup::pollMember(GroupMember& member) {
+    uint16_t block[GROUP_BLOCK_COUNT];
+
+    BusArbiter& arbiter = transport.getArbiter();
+    arbiter.frameBoundary();
+    arbiter.beginFrame(BusSource::POLLER);
+
+    member.lastError = transport.readRegisters(member.slaveId, GROUP_BLOCK_START,
+                                               GROUP_BLOCK_COUNT, block);
+    arbiter.endFrame(member.lastError == MODBUS_OK);
+
+    uint32_t now = micros();
+    if (member.lastError != MODBUS_OK || !isApplied(member, block)) {
+        member.lastMissMicros = now;
+        return;
+    }
+
+    member.confirmed = true;
+    member.confirmMicros = now;
+    result.confirmed++;
+}
+
+bool DriveGroup::isApplied(const GroupMember& member, const uint16_t* block) const {
+    if (!result.isCommand) {
+        int diff = (int)block[GROUP_BLOCK_FREQ] - (int)member.expected;
+        return abs(diff) <= VFD_GROUP_FREQ_TOLERANCE;
+    }
+
+    // Bits 1-0 of the status word: 11 = operating
+    bool operating = (block[GROUP_BLOCK_STATUS] & 0x03) == 0x03;
+    switch (member.expected) {
+        case CMD_RUN_FWD:
+        case CMD_RUN_REV:
+        case CMD_JOG_FWD:
+        case CMD_JOG_REV:
+            return operating;
+        case CMD_STOP:
+            return !operating;
+        default:
+            return true;  // Nothing observable - an answer is all we can check
+    }
+}
+
+void DriveGroup::finishVerify() {
+    verifying = false;
+    result.complete = true;
+    result.verified = result.confirmed == result.members;
+    result.verifyMillis = millis() - verifyStart;
+
+    // Each drive applied the change somewhere between its last miss and
+    // its confirmation. The skew is bounded below by how far the latest
+    // miss trails the earliest confirmation, above by the widest window.
+    uint32_t earliestMiss = 0, latestMiss = 0, earliestConfirm = 0, latestConfirm = 0;
+    bool any = false;
+    for (size_t i = 0; i < memberCount; i++) {
+        const GroupMember& member = members[i];
+        if (!member.confirmed) continue;
+        if (!any) {
+            earliestMiss = latestMiss = member.lastMissMicros;
+            earliestConfirm = latestConfirm = member.confirmMicros;
+            any = true;
+            continue;
+        }
+        if ((int32_t)(member.lastMissMicros - earliestMiss) < 0) earliestMiss = member.lastMissMicros;
+        if ((int32_t)(member.lastMissMicros - latestMiss) > 0) latestMiss = member.lastMissMicros;
+        if ((int32_t)(member.confirmMicros - earliestConfirm) < 0) earliestConfirm = member.confirmMicros;
+        if ((int32_t)(member.confirmMicros - latestConfirm) > 0) latestConfirm = member.confirmMicros;
+    }
+    if (any) {
+        int32_t lower = (int32_t)(latestMiss - earliestConfirm);
+        result.skewMinMicros = lower > 0 ? lower : 0;
+        result.skewMaxMicros = latestConfirm - earliestMiss;
+    }
+
+    DEBUG_PRINTF("DriveGroup: %s %d/%d confirmed in %lu ms, skew %lu-%lu us\n",
+                 result.verified ? "Verified" : "Incomplete",
+                 result.confirmed, result.members, (unsigned long)result.verifyMillis,
+                 (unsigned long)result.skewMinMicros, (unsigned long)result.skewMaxMicros);
+}
+
+GroupMember* DriveGroup::findMember(uint8_t slaveId) {
+    for (size_t i = 0; i < memberCount; i++) {
+        if (members[i].slaveId == slaveId) return &members[i];
+    }
+    return nullptr;
+}
+
+uint16_t DriveGroup::toRegister(float frequencyHz) const {
+    frequencyHz = constrain(frequencyHz, minFrequency, maxFrequency);
+    return (uint16_t)(frequencyHz * 100 + 0.5);
+}
@@ -0,0 +1,95 @@
+// DriveGroup.h
+// Synchronized setpoints for several drives on one link via Modbus broadcast
+
+#ifndef DRIVE_GROUP_H
+#define DRIVE_GROUP_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "ModbusRTU.h"
+#include "ModbusTransport.h"
+
+// One drive in the group
+struct GroupMember {
+    uint8_t slaveId;
+    float ratio;                // Setpoint multiplier, 1.0 = take the broadcast as is
+    uint16_t expected;          // Value the verification poll must see
+    bool correctionPending;     // Ratio write not sent yet
+    bool confirmed;
+    uint32_t lastMissMicros;    // Write time, then last poll not showing the change
+    uint32_t confirmMicros;     // First poll that did
+    uint8_t lastError;          // Result of the last verification poll
+};
+
+// Outcome of the most recent group change
+struct GroupResult {
+    uint32_t sequence;
+    bool isCommand;             // false = frequency setpoint
+    uint16_t value;             // Command code or base frequency (Hz x100)
+    uint8_t members;
+    uint8_t confirmed;
+    uint8_t unicastWrites;      // Ratio corrections sent after the broadcast
+    uint32_t dispatchMicros;    // First frame start to last frame end
+    uint32_t skewMinMicros;     // Bounds on the spread of apply times, from the
+    uint32_t skewMaxMicros;     // miss/confirm poll windows of each member
+    uint32_t verifyMillis;      // Until the last member confirmed or timeout
+    bool complete;              // Verification finished
+    bool verified;              // Every member confirmed
+};
+
+class DriveGroup {
+public:
+    DriveGroup(ModbusTransport& transport);
+    ~DriveGroup();
+
+    // Membership
+    bool addDrive(uint8_t slaveId, float ratio = 1.0);
+    bool setRatio(uint8_t slaveId, float ratio);
+    void clear();
+    size_t getDriveCount() const { return memberCount; }
+    const GroupMember& getDrive(size_t index) const { return members[index]; }
+
+    void setLimits(float minFrequency, float maxFrequency);
+
+    // Group changes: one broadcast frame, then unicast writes only for
+    // drives whose ratio makes their setpoint differ from the broadcast.
+    // The unicasts go out from handle() once the drives' broadcast
+    // turnaround has passed, verification follows them.
+    bool setFrequency(float frequencyHz);
+    bool sendCommand(uint16_t command);
+    bool start(bool reverse = false) { return sendCommand(reverse ? CMD_RUN_REV : CMD_RUN_FWD); }
+    bool stop() { return sendCommand(CMD_STOP); }
+
+    // Ratio corrections and verification polls (call from loop)
+    void handle();
+
+    bool isVerifying() const { return verifying; }
+    const GroupResult& getLastResult() const { return result; }
+
+private:
+    ModbusTransport& transport;
+
+    GroupMember members[VFD_GROUP_MAX_DRIVES];
+    size_t memberCount;
+    float minFrequency;
+    float maxFrequency;
+
+    GroupResult result;
+    bool verifying;
+    unsigned long verifyStart;
+    uint32_t dispatchStart;
+    uint8_t correctionsPending;
+    size_t nextPoll;
+
+    bool broadcast(uint16_t address, uint16_t value);
+    bool writeMember(uint8_t slaveId, uint16_t address, uint16_t value);
+    void sendCorrection();
+    void beginVerify(bool isCommand, uint16_t value, uint32_t dispatchStart);
+    void pollMember(GroupMember& member);
+    bool isApplied(const GroupMember& member, const uint16_t* block) const;
+    void finishVerify();
+    GroupMember* findMember(uint8_t slaveId);
+    uint16_t toRegister(float frequencyHz) const;
+};
+
+#endif // DRIVE_GROUP_H
@@ -0,0 +1,260 @@
+// FlightRecorder.cpp
+// Fault flight recorder: polls before and after a drive fault/warning, saved to SPIFFS
+
+#include "FlightRecorder.h"
+#include <SPIFFS.h>
+
+FlightRecorder::FlightRecorder(CalendarScheduler& clock) :
+    clock(clock),
+    task(nullptr),
+    preHead(0),
+    preCount(0),
+    postCount(0),
+    state(FlightState::ARMED),
+    lastError(0),
+    first(0),
+    end(0)
+{
+    memset(&pending, 0, sizeof(pending));
+    memset(&stats, 0, sizeof(stats));
+}
+
+FlightRecorder::~FlightRecorder() {
+    if (task) {
+        vTaskDelete(task);
+    }
+}
+
+bool FlightRecorder::begin() {
+    if (task) return true;
+
+    scanEvents();
+
+    // Saving takes a few flash writes - done off the loop so polling
+    // carries on while the event goes out
+    BaseType_t created = xTaskCreatePinnedToCore(
+        taskEntry,
+        "FlightRecorder",
+        VFD_CONTROL_TASK_STACK,
+        this,
+        TELEMETRY_LOG_TASK_PRIORITY,
+        &task,
+        TELEMETRY_LOG_TASK_CORE
+    );
+    if (created != pdPASS) {
+        task = nullptr;
+        DEBUG_PRINTLN("FlightRecorder: Failed to create task");
+        return false;
+    }
+
+    DEBUG_PRINTF("FlightRecorder: Armed, %u saved events\n", end - first);
+    return true;
+}
+
+void FlightRecorder::sample(const VFDStatus& status) {
+    if (!task) return;
+
+    FlightSample sample;
+    sample.record = TelemetryRing::toRecord(status);
+    sample.errorStatus = status.errorStatus;
+    sample.reserved = 0;
+
+    // A new code (fault or warning) - not one that is merely still set
+    bool triggered = sample.errorStatus != 0 && sample.errorStatus != lastError;
+    lastError = sample.errorStatus;
+
+    switch (state) {
+        case FlightState::ARMED:
+            pre[preHead] = sample;
+            preHead = (preHead + 1) % FLIGHT_PRE_SAMPLES;
+            if (preCount < FLIGHT_PRE_SAMPLES) preCount++;
+            if (triggered) {
+                start(sample, false);
+            }
+            break;
+
+        case FlightState::CAPTURING:
+            post[postCount++] = sample;
+            if (postCount >= FLIGHT_POST_SAMPLES) {
+                state = FlightState::SAVING;
+                xTaskNotifyGive(task);
+            }
+            if (triggered) {
+                portENTER_CRITICAL(&lock);
+                stats.skipped++;
+                portEXIT_CRITICAL(&lock);
+            }
+            break;
+
+        case FlightState::SAVING:
+            if (triggered) {
+                portENTER_CRITICAL(&lock);
+                stats.skipped++;
+                portEXIT_CRITICAL(&lock);
+            }
+            break;
+    }
+}
+
+bool FlightRecorder::trigger() {
+    if (!task || state != FlightState::ARMED || preCount == 0) return false;
+
+    start(pre[(preHead + FLIGHT_PRE_SAMPLES - 1) % FLIGHT_PRE_SAMPLES], true);
+    return true;
+}
+
+FlightStats FlightRecorder::getStats() {
+    portENTER_CRITICAL(&lock);
+    FlightStats copy = stats;
+    portEXIT_CRITICAL(&lock);
+    return copy;
+}
+
+bool FlightRecorder::readHeader(uint32_t id, FlightEventHeader& header) {
+    File file = SPIFFS.open(path(id), FILE_READ);
+    if (!file) return false;
+
+    bool ok = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              header.magic == FLIGHT_MAGIC &&
+              header.preCount <= FLIGHT_PRE_SAMPLES && header.postCount <= FLIGHT_POST_SAMPLES &&
+              file.size() == sizeof(header) + (header.preCount + header.postCount) * sizeof(FlightSample);
+    file.close();
+    header.name[FLIGHT_NAME_LEN - 1] = '\0';
+    return ok;
+}
+
+bool FlightRecorder::clear() {
+    // The writer task owns the file numbers while saving
+    if (state == FlightState::SAVING) return false;
+
+    for (uint32_t id = first; id != end; id++) {
+        SPIFFS.remove(path(id));
+    }
+    first = end;
+    return true;
+}
+
+String FlightRecorder::path(uint32_t id) {
+    return String(FLIGHT_DIR) + "/" + String(id) + ".flt";
+}
+
+void FlightRecorder::describe(uint16_t errorStatus, char* buffer, size_t size) {
+    uint8_t error = errorStatus & 0xFF;
+    uint8_t warning = errorStatus >> 8;
+    if (error != 0 && warning != 0) {
+        snprintf(buffer, size, "%s, warning %u", ModbusVFD::errorName(error), warning);
+    } else if (error != 0) {
+        snprintf(buffer, size, "%s", ModbusVFD::errorName(error));
+    } else if (warning != 0) {
+        snprintf(buffer, size, "Warning %u", warning);
+    } else {
+        snprintf(buffer, size, "Manual trigger");
+    }
+}
+
+const char* FlightRecorder::stateName(FlightState state) {
+    switch (state) {
+        case FlightState::ARMED: return "armed";
+        case FlightState::CAPTURING: return "capturing";
+        case FlightState::SAVING: return "saving";
+        default: return "unknown";
+    }
+}
+
+void FlightRecorder::taskEntry(void* param) {
+    static_cast<FlightRecorder*>(param)->run();
+}
+
+void FlightRecorder::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (state != FlightState::SAVING) continue;
+
+        bool ok = save();
+        portENTER_CRITICAL(&lock);
+        if (ok) {
+            stats.saved++;
+        } else {
+            stats.saveErrors++;
+        }
+        portEXIT_CRITICAL(&lock);
+
+        // Re-arm with an empty window; the next event gets a fresh history
+        preHead = 0;
+        preCount = 0;
+        postCount = 0;
+        state = FlightState::ARMED;
+    }
+}
+
+void FlightRecorder::start(const FlightSample& trigger, bool manual) {
+    pending.magic = FLIGHT_MAGIC;
+    pending.epoch = clock.isClockValid() ? clock.now() : 0;
+    pending.triggerTime = trigger.record.time;
+    pending.errorStatus = trigger.errorStatus;
+    pending.preCount = preCount;
+    pending.postCount = 0;
+    pending.manual = manual ? 1 : 0;
+    pending.reserved = 0;
+    describe(trigger.errorStatus, pending.name, sizeof(pending.name));
+
+    postCount = 0;
+    state = FlightState::CAPTURING;
+
+    portENTER_CRITICAL(&lock);
+    stats.triggers++;
+    portEXIT_CRITICAL(&lock);
+
+    DEBUG_PRINTF("FlightRecorder: Triggered by 0x%04X (%s)\n", trigger.errorStatus, pending.name);
+}
+
+bool FlightRecorder::save() {
+    pending.postCount = postCount;
+
+    // Keep the newest FLIGHT_MAX_EVENTS - 1 plus this one
+    while (end - first >= FLIGHT_MAX_EVENTS) {
+        SPIFFS.remove(path(first));
+        first++;
+    }
+
+    File file = SPIFFS.open(path(end), FILE_WRITE);
+    if (!file) return false;
+
+    // Pre-trigger ring in time order: oldest is at preHead once it wrapped
+    uint16_t start = preCount < FLIGHT_PRE_SAMPLES ? 0 : preHead;
+    uint16_t firstRun = min((uint16_t)(FLIGHT_PRE_SAMPLES - start), preCount);
+    size_t bytes = sizeof(pending) + (preCount + postCount) * sizeof(FlightSample);
+    size_t written = file.write((const uint8_t*)&pending, sizeof(pending));
+    written += file.write((const uint8_t*)(pre + start), firstRun * sizeof(FlightSample));
+    written += file.write((const uint8_t*)pre, (preCount - firstRun) * sizeof(FlightSample));
+    written += file.write((const uint8_t*)post, postCount * sizeof(FlightSample));
+    file.close();
+
+    if (written != bytes) {
+        SPIFFS.remove(path(end));
+        DEBUG_PRINTLN("FlightRecorder: Failed to save event");
+        return false;
+    }
+
+    DEBUG_PRINTF("FlightRecorder: Saved event %u (%s)\n", end, pending.name);
+    end++;
+    return true;
+}
+
+void FlightRecorder::scanEvents() {
+    bool found = false;
+    File dir = SPIFFS.open(FLIGHT_DIR);
+    File file = dir.openNextFile();
+    while (file) {
+        String entry = file.name();
+        int slash = entry.lastIndexOf('/');
+        if (slash != -1) entry = entry.substring(slash + 1);
+        if (entry.endsWith(".flt")) {
+            uint32_t id = strtoul(entry.c_str(), nullptr, 10);
+            if (!found || id < first) first = id;
+            if (!found || id >= end) end = id + 1;
+            found = true;
+        }
+        file = dir.openNextFile();
+    }
+}
@@ -0,0 +1,105 @@
+// FlightRecorder.h
+// Fault flight recorder: polls before and after a drive fault/warning, saved to SPIFFS
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "Config.h"
+#include "ModbusVFD.h"
+#include "TelemetryRing.h"
+#include "CalendarScheduler.h"
+
+#define FLIGHT_MAGIC        0x31544C46  // "FLT1"
+#define FLIGHT_NAME_LEN     40
+
+enum class FlightState : uint8_t {
+    ARMED = 0,      // Rolling pre-trigger window
+    CAPTURING,      // Pre-trigger frozen, filling the post-trigger window
+    SAVING          // Waiting for the writer task
+};
+
+struct FlightSample {
+    TelemetryRecord record;
+    uint16_t errorStatus;   // 0x2100 as read
+    uint16_t reserved;
+};
+
+// Saved event: this header, then preCount + postCount samples in time
+// order. The trigger sample is the last of the pre-trigger ones.
+struct FlightEventHeader {
+    uint32_t magic;
+    uint32_t epoch;         // RTC time of the trigger, 0 if the clock was unset
+    uint32_t triggerTime;   // millis() of the trigger sample
+    uint16_t errorStatus;   // 0x2100 at the trigger
+    uint16_t preCount;
+    uint16_t postCount;
+    uint8_t manual;         // Triggered over REST rather than by the drive
+    uint8_t reserved;
+    char name[FLIGHT_NAME_LEN];
+};
+
+struct FlightStats {
+    uint32_t triggers;
+    uint32_t saved;
+    uint32_t saveErrors;
+    uint32_t skipped;       // Codes that appeared while the last event was still being captured/saved
+};
+
+class FlightRecorder {
+public:
+    FlightRecorder(CalendarScheduler& clock);
+    ~FlightRecorder();
+
+    // Finds saved events and starts the writer task (mount SPIFFS first)
+    bool begin();
+
+    // Every successful poll; triggers when 0x2100 changes to a nonzero code
+    void sample(const VFDStatus& status);
+
+    // Capture now, as if the drive had reported the current code
+    bool trigger();
+
+    FlightState getState() const { return state; }
+    FlightStats getStats();
+
+    // Saved events are numbered; [first, end) exist unless deleted
+    uint32_t firstEvent() const { return first; }
+    uint32_t endEvent() const { return end; }
+    bool readHeader(uint32_t id, FlightEventHeader& header);
+    bool clear();
+
+    static String path(uint32_t id);
+    static void describe(uint16_t errorStatus, char* buffer, size_t size);
+    static const char* stateName(FlightState state);
+
+private:
+    CalendarScheduler& clock;
+    TaskHandle_t task;
+
+    // Pre-trigger ring, frozen once triggered
+    FlightSample pre[FLIGHT_PRE_SAMPLES];
+    uint16_t preHead;
+    uint16_t preCount;
+    FlightSample post[FLIGHT_POST_SAMPLES];
+    uint16_t postCount;
+
+    volatile FlightState state;
+    uint16_t lastError;
+    FlightEventHeader pending;      // Header of the event being captured
+    uint32_t first;
+    uint32_t end;
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    FlightStats stats;
+
+    static void taskEntry(void* param);
+    void run();
+    void start(const FlightSample& trigger, bool manual);
+    bool save();
+    void scanEvents();
+};
+
+#endif // FLIGHT_RECORDER_H
@@ -0,0 +1,228 @@
+// FollowerLoop.cpp
+// Master/follower ratio loop: drive B tracks drive A's output frequency
+
+#include "FollowerLoop.h"
+
+FollowerLoop::FollowerLoop(ModbusTransport& transport) :
+    transport(transport),
+    task(nullptr),
+    engaged(false),
+    commandValid(false),
+    command(0.0),
+    lastTickMicros(0)
+{
+    config.leaderId = VFD_FOLLOWER_LEADER_ID;
+    config.followerId = VFD_FOLLOWER_ID;
+    config.ratio = 1.0;
+    config.offset = 0.0;
+    config.slewUp = VFD_FOLLOWER_SLEW;
+    config.slewDown = VFD_FOLLOWER_SLEW;
+    config.periodMs = VFD_FOLLOWER_PERIOD_MS;
+    config.minFrequency = 0.0;
+    config.maxFrequency = 60.0;
+
+    memset(&stats, 0, sizeof(stats));
+}
+
+FollowerLoop::~FollowerLoop() {
+    if (task) {
+        vTaskDelete(task);
+    }
+}
+
+bool FollowerLoop::begin() {
+    if (task) return true;
+
+    BaseType_t created = xTaskCreatePinnedToCore(
+        taskEntry,
+        "FollowerLoop",
+        VFD_CONTROL_TASK_STACK,
+        this,
+        VFD_CONTROL_TASK_PRIORITY,
+        &task,
+        VFD_CONTROL_TASK_CORE
+    );
+    if (created != pdPASS) {
+        task = nullptr;
+        DEBUG_PRINTLN("FollowerLoop: Failed to create task");
+        return false;
+    }
+
+    DEBUG_PRINTLN("FollowerLoop: Initialized");
+    DEBUG_PRINTF("  Leader: %d, Follower: %d, Period: %d ms\n",
+                 config.leaderId, config.followerId, config.periodMs);
+    return true;
+}
+
+void FollowerLoop::engage() {
+    if (engaged) return;
+
+    // The task picks up from the follower's current output (bumpless)
+    commandValid = false;
+    lastTickMicros = 0;
+    engaged = true;
+    DEBUG_PRINTLN("FollowerLoop: Engaged");
+}
+
+void FollowerLoop::disengage() {
+    if (!engaged) return;
+
+    // The follower keeps running at the last setpoint written
+    engaged = false;
+    DEBUG_PRINTLN("FollowerLoop: Disengaged");
+}
+
+void FollowerLoop::setConfig(const FollowerConfig& newConfig) {
+    portENTER_CRITICAL(&lock);
+    config = newConfig;
+    if (config.periodMs < 10) config.periodMs = 10;
+    portEXIT_CRITICAL(&lock);
+}
+
+FollowerConfig FollowerLoop::getConfig() {
+    portENTER_CRITICAL(&lock);
+    FollowerConfig copy = config;
+    portEXIT_CRITICAL(&lock);
+    return copy;
+}
+
+FollowerStats FollowerLoop::getStats() {
+    portENTER_CRITICAL(&lock);
+    FollowerStats copy = stats;
+    portEXIT_CRITICAL(&lock);
+    return copy;
+}
+
+void FollowerLoop::resetStats() {
+    portENTER_CRITICAL(&lock);
+    memset(&stats, 0, sizeof(stats));
+    portEXIT_CRITICAL(&lock);
+}
+
+void FollowerLoop::taskEntry(void* param) {
+    static_cast<FollowerLoop*>(param)->run();
+}
+
+void FollowerLoop::run() {
+    TickType_t lastWake = xTaskGetTickCount();
+
+    while (true) {
+        FollowerConfig cfg = getConfig();
+
+        // Absolute wake times - the tick's own run time doesn't drift the rate
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(cfg.periodMs));
+
+        if (!engaged) {
+            lastTickMicros = 0;
+            continue;
+        }
+        tick(cfg);
+    }
+}
+
+void FollowerLoop::tick(const FollowerConfig& cfg) {
+    uint32_t start = micros();
+    uint32_t interval = lastTickMicros ? start - lastTickMicros : 0;
+    lastTickMicros = start;
+
+    // Start from the follower's current speed so engaging doesn't jump
+    if (!commandValid) {
+        float current = 0;
+        if (readFrequency(cfg.followerId, current) != MODBUS_OK) {
+            portENTER_CRITICAL(&lock);
+            stats.followerErrors++;
+            portEXIT_CRITICAL(&lock);
+            return;
+        }
+        command = current;
+        commandValid = true;
+    }
+
+    float leader = 0;
+    uint8_t leaderResult = readFrequency(cfg.leaderId, leader);
+
+    float target = command;
+    uint32_t writeUs = 0;
+    uint8_t writeResult = MODBUS_OK;
+    if (leaderResult == MODBUS_OK) {
+        target = constrain(leader * cfg.ratio + cfg.offset, cfg.minFrequency, cfg.maxFrequency);
+
+        // Slew limit per tick
+        float dt = cfg.periodMs / 1000.0;
+        if (target > command) {
+            command = cfg.slewUp > 0 ? min(target, command + cfg.slewUp * dt) : target;
+        } else {
+            command = cfg.slewDown > 0 ? max(target, command - cfg.slewDown * dt) : target;
+        }
+
+        uint32_t writeStart = micros();
+        writeResult = writeSetpoint(cfg.followerId, command);
+        writeUs = micros() - writeStart;
+    }
+
+    float follower = 0;
+    uint8_t followerResult = readFrequency(cfg.followerId, follower);
+
+    uint32_t exec = micros() - start;
+    uint32_t periodUs = (uint32_t)cfg.periodMs * 1000;
+
+    portENTER_CRITICAL(&lock);
+    stats.ticks++;
+    if (exec > periodUs) stats.overruns++;
+    stats.lastExecUs = exec;
+    if (exec > stats.maxExecUs) stats.maxExecUs = exec;
+
+    if (interval) {
+        if (stats.minPeriodUs == 0 || interval < stats.minPeriodUs) stats.minPeriodUs = interval;
+        if (interval > stats.maxPeriodUs) stats.maxPeriodUs = interval;
+        uint32_t jitter = interval > periodUs ? interval - periodUs : periodUs - interval;
+        if (jitter > stats.maxJitterUs) stats.maxJitterUs = jitter;
+    }
+
+    stats.leaderLost = leaderResult != MODBUS_OK;
+    if (stats.leaderLost) {
+        stats.leaderErrors++;
+    } else {
+        stats.leaderFrequency = leader;
+        stats.target = target;
+        stats.command = command;
+        stats.lastWriteUs = writeUs;
+        if (writeUs > stats.maxWriteUs) stats.maxWriteUs = writeUs;
+        if (writeResult != MODBUS_OK) stats.writeErrors++;
+    }
+
+    if (followerResult == MODBUS_OK) {
+        stats.followerFrequency = follower;
+        stats.trackingError = stats.target - follower;
+        if (fabs(stats.trackingError) > stats.maxTrackingError) {
+            stats.maxTrackingError = fabs(stats.trackingError);
+        }
+    } else {
+        stats.followerErrors++;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+uint8_t FollowerLoop::readFrequency(uint8_t slaveId, float& frequency) {
+    uint16_t value = 0;
+
+    BusArbiter& arbiter = transport.getArbiter();
+    arbiter.beginFrame(BusSource::CONTROL);
+    uint8_t result = transport.readRegisters(slaveId, REG_FREQ_OUT_READ, 1, &value);
+    arbiter.endFrame(result == MODBUS_OK);
+
+    if (result == MODBUS_OK) {
+        frequency = value / 100.0;  // XXX.XX Hz format
+    }
+    return result;
+}
+
+uint8_t FollowerLoop::writeSetpoint(uint8_t slaveId, float frequency) {
+    uint16_t value = (uint16_t)(frequency * 100 + 0.5);
+
+    BusArbiter& arbiter = transport.getArbiter();
+    arbiter.beginFrame(BusSource::CONTROL);
+    uint8_t result = transport.writeSingleRegister(slaveId, REG_FREQUENCY_WRITE, value);
+    arbiter.endFrame(result == MODBUS_OK);
+    return result;
+}
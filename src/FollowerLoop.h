@@ -0,0 +1,92 @@
+// FollowerLoop.h
+// Master/follower ratio loop: drive B tracks drive A's output frequency
+
+#ifndef FOLLOWER_LOOP_H
+#define FOLLOWER_LOOP_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "Config.h"
+#include "ModbusTransport.h"
+
+// follower setpoint = leader output x ratio + offset, slew limited
+struct FollowerConfig {
+    uint8_t leaderId;
+    uint8_t followerId;
+    float ratio;
+    float offset;           // Hz
+    float slewUp;           // Hz/s, 0 = unlimited
+    float slewDown;         // Hz/s, 0 = unlimited
+    uint16_t periodMs;
+    float minFrequency;
+    float maxFrequency;
+};
+
+// Loop telemetry (Hz unless noted)
+struct FollowerStats {
+    uint32_t ticks;
+    uint32_t overruns;          // Ticks that took longer than the period
+    uint32_t leaderErrors;
+    uint32_t writeErrors;
+    uint32_t followerErrors;
+    bool leaderLost;            // Last leader read failed - holding the setpoint
+
+    float leaderFrequency;
+    float target;               // Ratio/offset result before slew limiting
+    float command;              // Setpoint written to the follower
+    float followerFrequency;
+    float trackingError;        // target - follower output
+    float maxTrackingError;     // Largest |trackingError| since reset
+
+    uint32_t minPeriodUs;       // Measured tick-to-tick interval
+    uint32_t maxPeriodUs;
+    uint32_t maxJitterUs;       // Largest |interval - period|
+    uint32_t lastExecUs;        // Time spent in one tick
+    uint32_t maxExecUs;
+    uint32_t lastWriteUs;       // Setpoint write round trip
+    uint32_t maxWriteUs;
+};
+
+class FollowerLoop {
+public:
+    FollowerLoop(ModbusTransport& transport);
+    ~FollowerLoop();
+
+    // Starts the loop task (idle until engaged)
+    bool begin();
+
+    void engage();
+    void disengage();
+    bool isEngaged() const { return engaged; }
+
+    void setConfig(const FollowerConfig& config);
+    FollowerConfig getConfig();
+
+    // Consistent copy for the web thread
+    FollowerStats getStats();
+    void resetStats();
+
+private:
+    ModbusTransport& transport;
+    TaskHandle_t task;
+    volatile bool engaged;
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    FollowerConfig config;
+    FollowerStats stats;
+
+    // Task-local state
+    bool commandValid;
+    float command;
+    uint32_t lastTickMicros;
+
+    static void taskEntry(void* param);
+    void run();
+    void tick(const FollowerConfig& cfg);
+
+    uint8_t readFrequency(uint8_t slaveId, float& frequency);
+    uint8_t writeSetpoint(uint8_t slaveId, float frequency);
+};
+
+#endif // FOLLOWER_LOOP_H
@@ -0,0 +1,158 @@
+// JsonWriter.cpp
+// Streaming JSON serializer: output goes to a Print as values are added
+
+#include "JsonWriter.h"
+#include <math.h>
+
+JsonWriter::JsonWriter(Print& out) :
+    out(out),
+    depth(0),
+    started(0),
+    afterKey(false)
+{
+}
+
+JsonWriter& JsonWriter::beginObject(const char* name) {
+    open('{', name);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    close('}');
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray(const char* name) {
+    open('[', name);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    close(']');
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* text) {
+    separate();
+    if (text) {
+        string(text);
+    } else {
+        out.print("null");
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+    separate();
+    out.print(flag ? "true" : "false");
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(long number) {
+    separate();
+    out.print(number);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(unsigned long number) {
+    separate();
+    out.print(number);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double number, uint8_t decimals) {
+    separate();
+    if (isnan(number) || isinf(number)) {
+        out.print("null");
+        return *this;
+    }
+
+    // Fixed point without trailing zeros, like ArduinoJson prints them
+    char text[32];
+    int length = snprintf(text, sizeof(text), "%.*f", decimals, number);
+    if (length <= 0 || length >= (int)sizeof(text)) {
+        out.print("null");
+        return *this;
+    }
+    if (strchr(text, '.')) {
+        while (text[length - 1] == '0') length--;
+        if (text[length - 1] == '.') length--;
+    }
+    const char* start = text;
+    if (length == 2 && text[0] == '-' && text[1] == '0') {
+        start++;        // Rounded to -0
+        length--;
+    }
+    out.write((const uint8_t*)start, length);
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    separate();
+    out.print("null");
+    return *this;
+}
+
+void JsonWriter::key(const char* name) {
+    separate();
+    string(name);
+    out.write(':');
+    afterKey = true;
+}
+
+void JsonWriter::separate() {
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+    if (depth == 0 || depth > JSON_WRITER_MAX_DEPTH) return;
+
+    uint32_t bit = 1UL << (depth - 1);
+    if (started & bit) {
+        out.write(',');
+    }
+    started |= bit;
+}
+
+void JsonWriter::open(char bracket, const char* name) {
+    if (name) {
+        key(name);
+    }
+    separate();
+    out.write(bracket);
+    depth++;
+    if (depth <= JSON_WRITER_MAX_DEPTH) {
+        started &= ~(1UL << (depth - 1));
+    }
+}
+
+void JsonWriter::close(char bracket) {
+    if (depth > 0) {
+        depth--;
+    }
+    out.write(bracket);
+}
+
+void JsonWriter::string(const char* text) {
+    out.write('"');
+
+    // Plain runs are written as they are, only escapes one by one
+    const char* run = text;
+    for (const char* c = text; *c; c++) {
+        uint8_t ch = (uint8_t)*c;
+        if (ch >= 0x20 && ch != '"' && ch != '\\') continue;
+
+        out.write((const uint8_t*)run, c - run);
+        run = c + 1;
+        switch (ch) {
+            case '"': out.print("\\\""); break;
+            case '\\': out.print("\\\\"); break;
+            case '\n': out.print("\\n"); break;
+            case '\r': out.print("\\r"); break;
+            case '\t': out.print("\\t"); break;
+            default: out.printf("\\u%04x", ch); break;
+        }
+    }
+    out.write((const uint8_t*)run, strlen(run));
+    out.write('"');
+}
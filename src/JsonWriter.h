@@ -0,0 +1,66 @@
+// JsonWriter.h
+// Streaming JSON serializer: output goes to a Print as values are added
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <Arduino.h>
+
+#define JSON_WRITER_MAX_DEPTH   32      // Nesting tracked for commas
+
+// Writes a document without building it in memory first - the state is
+// the nesting depth and one bit per level, so the size of the output is
+// unbounded. Members go in objects, values in arrays:
+//
+//   JsonWriter json(stream);
+//   json.beginObject();
+//   json.beginArray("networks");
+//   json.beginObject().field("ssid", ssid).field("rssi", rssi).endObject();
+//   json.endArray();
+//   json.endObject();
+class JsonWriter {
+public:
+    explicit JsonWriter(Print& out);
+
+    // Containers; `name` when the container is an object member
+    JsonWriter& beginObject(const char* name = nullptr);
+    JsonWriter& endObject();
+    JsonWriter& beginArray(const char* name = nullptr);
+    JsonWriter& endArray();
+
+    // Array elements
+    JsonWriter& value(const char* text);
+    JsonWriter& value(const String& text) { return value(text.c_str()); }
+    JsonWriter& value(bool flag);
+    JsonWriter& value(int number) { return value((long)number); }
+    JsonWriter& value(unsigned int number) { return value((unsigned long)number); }
+    JsonWriter& value(long number);
+    JsonWriter& value(unsigned long number);
+    JsonWriter& value(double number, uint8_t decimals = 6);    // NaN/inf as null
+    JsonWriter& null();
+
+    // Object members
+    template <typename T>
+    JsonWriter& field(const char* name, T data) {
+        key(name);
+        return value(data);
+    }
+    JsonWriter& field(const char* name, double number, uint8_t decimals) {
+        key(name);
+        return value(number, decimals);
+    }
+
+private:
+    Print& out;
+    uint8_t depth;
+    uint32_t started;       // Bit per level: something was written there
+    bool afterKey;          // Next value belongs to the key just written
+
+    void key(const char* name);
+    void separate();
+    void open(char bracket, const char* name);
+    void close(char bracket);
+    void string(const char* text);
+};
+
+#endif // JSON_WRITER_H
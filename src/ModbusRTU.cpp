@@ -0,0 +1,94 @@
+// ModbusRTU.cpp
+// Modbus RTU framing helpers
+
+#include "ModbusRTU.h"
+
+uint16_t modbusCRC16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            if (crc & 0x0001) {
+                crc = (crc >> 1) ^ 0xA001;
+            } else {
+                crc >>= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+bool modbusCheckCRC(const uint8_t* frame, size_t length) {
+    if (length < 4) return false;
+    uint16_t crc = modbusCRC16(frame, length - 2);
+    // CRC is transmitted low byte first
+    return frame[length - 2] == (crc & 0xFF) && frame[length - 1] == (crc >> 8);
+}
+
+size_t modbusAppendCRC(uint8_t* frame, size_t length) {
+    uint16_t crc = modbusCRC16(frame, length);
+    frame[length] = crc & 0xFF;
+    frame[length + 1] = crc >> 8;
+    return length + 2;
+}
+
+int modbusRequestLength(const uint8_t* frame, size_t available) {
+    if (available < 2) return 0;
+
+    switch (frame[1]) {
+        case 0x01:  // Read coils
+        case 0x02:  // Read discrete inputs
+        case 0x03:  // Read holding registers
+        case 0x04:  // Read input registers
+        case 0x05:  // Write single coil
+        case 0x06:  // Write single register
+            return 8;
+
+        case 0x0F:  // Write multiple coils
+        case 0x10:  // Write multiple registers
+            // addr, fc, start(2), qty(2), byteCount, data..., crc(2)
+            if (available < 7) return 0;
+            return 9 + frame[6];
+
+        case 0x17:  // Read/write multiple registers
+            if (available < 11) return 0;
+            return 13 + frame[10];
+
+        default:
+            return -1;
+    }
+}
+
+int modbusResponseLength(const uint8_t* frame, size_t available) {
+    if (available < 2) return 0;
+
+    // Exception response: addr, fc|0x80, code, crc(2)
+    if (frame[1] & 0x80) return 5;
+
+    switch (frame[1]) {
+        case 0x01:
+        case 0x02:
+        case 0x03:
+        case 0x04:
+        case 0x17:
+            // addr, fc, byteCount, data..., crc(2)
+            if (available < 3) return 0;
+            return 5 + frame[2];
+
+        case 0x05:
+        case 0x06:
+        case 0x0F:
+        case 0x10:
+            return 8;
+
+        default:
+            return -1;
+    }
+}
+
+uint32_t modbusFrameGapMicros(uint32_t baudRate) {
+    // Spec fixes the gap at 1750us above 19200 baud
+    if (baudRate > 19200) return 1750;
+    // 3.5 characters of 11 bits each
+    return (38500000UL + baudRate - 1) / baudRate;
+}
@@ -0,0 +1,47 @@
+// ModbusRTU.h
+// Modbus RTU framing helpers shared by the bridge, slave and transports
+
+#ifndef MODBUS_RTU_H
+#define MODBUS_RTU_H
+
+#include <Arduino.h>
+
+// Largest RTU frame allowed by the Modbus spec (address + PDU + CRC)
+#define MODBUS_RTU_MAX_FRAME    256
+
+// Broadcast address - all slaves act on the request, none reply
+#define MODBUS_BROADCAST_ID     0
+
+// Function codes used across the firmware
+#define MODBUS_FC_READ_HOLDING      0x03
+#define MODBUS_FC_READ_INPUT        0x04
+#define MODBUS_FC_WRITE_SINGLE      0x06
+#define MODBUS_FC_WRITE_MULTIPLE    0x10
+
+// Exception codes
+#define MODBUS_EX_ILLEGAL_FUNCTION  0x01
+#define MODBUS_EX_ILLEGAL_ADDRESS   0x02
+#define MODBUS_EX_ILLEGAL_VALUE     0x03
+#define MODBUS_EX_SLAVE_FAILURE     0x04
+
+// CRC-16/MODBUS over a buffer
+uint16_t modbusCRC16(const uint8_t* data, size_t length);
+
+// Check the trailing CRC of a complete frame
+bool modbusCheckCRC(const uint8_t* frame, size_t length);
+
+// Append CRC at frame[length], returns new frame length
+size_t modbusAppendCRC(uint8_t* frame, size_t length);
+
+// Expected length of a request frame (including CRC) from its header.
+// Returns 0 if more bytes are needed, -1 if the function code is unknown.
+int modbusRequestLength(const uint8_t* frame, size_t available);
+
+// Expected length of a response frame (including CRC) from its header.
+// Returns 0 if more bytes are needed, -1 if the function code is unknown.
+int modbusResponseLength(const uint8_t* frame, size_t available);
+
+// Inter-frame silence (3.5 character times) in microseconds for a baud rate
+uint32_t modbusFrameGapMicros(uint32_t baudRate);
+
+#endif // MODBUS_RTU_H
@@ -0,0 +1,281 @@
+// ModbusSlave.cpp
+// Modbus RTU slave endpoint exposing cached drive data on a second UART
+
+#include "ModbusSlave.h"
+
+ModbusSlave::ModbusSlave(ModbusVFD& vfd) :
+    vfd(vfd),
+    slaveId(RTU_SLAVE_ID),
+    running(false),
+    lastCommand(0),
+    lastFrequency(0),
+    requestCount(0),
+    errorCount(0),
+    maxResponseMicros(0)
+{
+}
+
+ModbusSlave::~ModbusSlave() {
+    stop();
+}
+
+bool ModbusSlave::begin(uint8_t slaveId) {
+    this->slaveId = slaveId;
+    lastFrequency = (uint16_t)(vfd.getTargetFrequency() * 100);
+
+#if RTU_SLAVE_DE_PIN >= 0
+    pinMode(RTU_SLAVE_DE_PIN, OUTPUT);
+    digitalWrite(RTU_SLAVE_DE_PIN, LOW);  // Receive mode by default
+#endif
+
+    RTU_SLAVE_SERIAL.begin(RTU_SLAVE_BAUD_RATE, RTU_SLAVE_CONFIG,
+                           RTU_SLAVE_RX_PIN, RTU_SLAVE_TX_PIN);
+
+    // Hand each frame over as soon as the line has been idle for ~3.5
+    // characters. The callback runs on the UART event task, so replies
+    // go out from memory even while the main loop is busy on the drive bus.
+    RTU_SLAVE_SERIAL.setRxTimeout(4);
+    RTU_SLAVE_SERIAL.onReceive([this]() {
+        onFrameReceived();
+    }, true);
+
+    running = true;
+
+    DEBUG_PRINTLN("ModbusSlave: Initialized");
+    DEBUG_PRINTF("  Slave ID: %d\n", slaveId);
+    DEBUG_PRINTF("  Baud Rate: %d\n", RTU_SLAVE_BAUD_RATE);
+    DEBUG_PRINTF("  TX Pin: %d, RX Pin: %d, DE Pin: %d\n",
+                 RTU_SLAVE_TX_PIN, RTU_SLAVE_RX_PIN, RTU_SLAVE_DE_PIN);
+
+    return true;
+}
+
+void ModbusSlave::stop() {
+    if (running) {
+        RTU_SLAVE_SERIAL.onReceive(nullptr);
+        RTU_SLAVE_SERIAL.end();
+        running = false;
+        DEBUG_PRINTLN("ModbusSlave: Stopped");
+    }
+}
+
+void ModbusSlave::onFrameReceived() {
+    uint32_t startMicros = micros();
+
+    size_t length = 0;
+    while (RTU_SLAVE_SERIAL.available() && length < sizeof(frame)) {
+        frame[length++] = RTU_SLAVE_SERIAL.read();
+    }
+    // Oversized garbage - throw the rest away
+    while (RTU_SLAVE_SERIAL.available()) {
+        RTU_SLAVE_SERIAL.read();
+    }
+
+    if (length < 4) return;
+
+    // Not for us - another slave on the PLC's network
+    if (frame[0] != slaveId && frame[0] != MODBUS_BROADCAST_ID) return;
+
+    if (!modbusCheckCRC(frame, length)) {
+        errorCount++;
+        return;
+    }
+
+    size_t replyLength = processRequest(frame, length, reply);
+    requestCount++;
+
+    // Broadcasts are applied silently
+    if (frame[0] == MODBUS_BROADCAST_ID || replyLength == 0) return;
+
+    sendReply(reply, replyLength);
+
+    uint32_t elapsed = micros() - startMicros;
+    if (elapsed > maxResponseMicros) {
+        maxResponseMicros = elapsed;
+    }
+}
+
+size_t ModbusSlave::processRequest(const uint8_t* request, size_t length, uint8_t* response) {
+    uint8_t function = request[1];
+    response[0] = slaveId;
+    response[1] = function;
+
+    switch (function) {
+        case MODBUS_FC_READ_HOLDING:
+        case MODBUS_FC_READ_INPUT: {
+            if (length != 8) {
+                return buildException(function, MODBUS_EX_ILLEGAL_VALUE, response);
+            }
+            uint16_t start = (request[2] << 8) | request[3];
+            uint16_t count = (request[4] << 8) | request[5];
+            if (count == 0 || count > 125) {
+                return buildException(function, MODBUS_EX_ILLEGAL_VALUE, response);
+            }
+
+            response[2] = count * 2;
+            for (uint16_t i = 0; i < count; i++) {
+                uint16_t value;
+                if (!readRegister(start + i, value)) {
+                    return buildException(function, MODBUS_EX_ILLEGAL_ADDRESS, response);
+                }
+                response[3 + i * 2] = value >> 8;
+                response[4 + i * 2] = value & 0xFF;
+            }
+            return modbusAppendCRC(response, 3 + count * 2);
+        }
+
+        case MODBUS_FC_WRITE_SINGLE: {
+            if (length != 8) {
+                return buildException(function, MODBUS_EX_ILLEGAL_VALUE, response);
+            }
+            uint16_t address = (request[2] << 8) | request[3];
+            uint16_t value = (request[4] << 8) | request[5];
+
+            uint8_t result = writeRegister(address, value);
+            if (result != 0) {
+                return buildException(function, result, response);
+            }
+
+            // Echo the request
+            memcpy(response + 2, request + 2, 4);
+            return modbusAppendCRC(response, 6);
+        }
+
+        case MODBUS_FC_WRITE_MULTIPLE: {
+            uint16_t start = (request[2] << 8) | request[3];
+            uint16_t count = (request[4] << 8) | request[5];
+            uint8_t byteCount = request[6];
+            if (count == 0 || count > 123 || byteCount != count * 2 ||
+                length != (size_t)(9 + byteCount)) {
+                return buildException(function, MODBUS_EX_ILLEGAL_VALUE, response);
+            }
+
+            // Check the whole range first so a bad request changes nothing
+            for (uint16_t i = 0; i < count; i++) {
+                if (!isWritable(start + i)) {
+                    return buildException(function, MODBUS_EX_ILLEGAL_ADDRESS, response);
+                }
+            }
+            for (uint16_t i = 0; i < count; i++) {
+                uint16_t value = (request[7 + i * 2] << 8) | request[8 + i * 2];
+                uint8_t result = writeRegister(start + i, value);
+                if (result != 0) {
+                    return buildException(function, result, response);
+                }
+            }
+
+            memcpy(response + 2, request + 2, 4);
+            return modbusAppendCRC(response, 6);
+        }
+
+        default:
+            return buildException(function, MODBUS_EX_ILLEGAL_FUNCTION, response);
+    }
+}
+
+bool ModbusSlave::readRegister(uint16_t address, uint16_t& value) {
+    const VFDStatus& status = vfd.getStatus();
+
+    switch (address) {
+        case SLAVE_REG_COMMAND:
+            value = lastCommand;
+            return true;
+
+        case SLAVE_REG_FREQUENCY:
+            value = lastFrequency;
+            return true;
+
+        case SLAVE_REG_STATUS_WORD:
+            value = status.statusWord;
+            return true;
+
+        case SLAVE_REG_OUT_FREQ:
+            value = (uint16_t)(status.actualFrequency * 100);
+            return true;
+
+        case SLAVE_REG_CURRENT:
+            value = (uint16_t)(status.outputCurrent * 100);
+            return true;
+
+        case SLAVE_REG_VOLTAGE:
+            value = (uint16_t)(status.outputVoltage * 10);
+            return true;
+
+        case SLAVE_REG_TARGET_FREQ:
+            value = (uint16_t)(vfd.getTargetFrequency() * 100);
+            return true;
+
+        case SLAVE_REG_FLAGS:
+            value = (vfd.isConnected() ? 0x01 : 0) |
+                    (status.isRunning ? 0x02 : 0) |
+                    (status.isFaulted ? 0x04 : 0) |
+                    (status.isReady ? 0x08 : 0);
+            return true;
+
+        case SLAVE_REG_DATA_AGE: {
+            if (status.lastUpdateTime == 0) {
+                value = 0xFFFF;  // Never polled
+            } else {
+                uint32_t age = millis() - status.lastUpdateTime;
+                value = age > 0xFFFF ? 0xFFFF : age;
+            }
+            return true;
+        }
+
+        case SLAVE_REG_REQUESTS:
+            value = requestCount & 0xFFFF;
+            return true;
+
+        default:
+            // Gaps inside the block read as zero so PLCs can fetch it in one go
+            if (address < SLAVE_REG_COUNT) {
+                value = 0;
+                return true;
+            }
+            return false;
+    }
+}
+
+uint8_t ModbusSlave::writeRegister(uint16_t address, uint16_t value) {
+    switch (address) {
+        case SLAVE_REG_COMMAND:
+            lastCommand = value;
+            vfd.requestCommand(value);
+            return 0;
+
+        case SLAVE_REG_FREQUENCY: {
+            float frequency = value / 100.0;
+            const VFDParams& params = vfd.getParameters();
+            if (frequency < params.minFrequency || frequency > params.maxFrequency) {
+                return MODBUS_EX_ILLEGAL_VALUE;
+            }
+            lastFrequency = value;
+            vfd.requestFrequency(frequency);
+            return 0;
+        }
+
+        default:
+            return MODBUS_EX_ILLEGAL_ADDRESS;
+    }
+}
+
+size_t ModbusSlave::buildException(uint8_t function, uint8_t code, uint8_t* response) {
+    errorCount++;
+    response[0] = slaveId;
+    response[1] = function | 0x80;
+    response[2] = code;
+    return modbusAppendCRC(response, 3);
+}
+
+void ModbusSlave::sendReply(const uint8_t* response, size_t length) {
+#if RTU_SLAVE_DE_PIN >= 0
+    digitalWrite(RTU_SLAVE_DE_PIN, HIGH);  // Enable transmit mode
+#endif
+
+    RTU_SLAVE_SERIAL.write(response, length);
+    RTU_SLAVE_SERIAL.flush();  // Wait for the last byte to leave
+
+#if RTU_SLAVE_DE_PIN >= 0
+    digitalWrite(RTU_SLAVE_DE_PIN, LOW);   // Back to receive mode
+#endif
+}
@@ -0,0 +1,83 @@
+// ModbusSlave.h
+// Modbus RTU slave endpoint exposing cached drive data on a second UART
+
+#ifndef MODBUS_SLAVE_H
+#define MODBUS_SLAVE_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "ModbusRTU.h"
+#include "ModbusVFD.h"
+
+// Register map (holding registers, FC03/FC04 read, FC06/FC16 write)
+// PLC addresses in brackets are the 1-based 4xxxx form.
+//
+//  Setpoints (read/write)
+//   0  [40001]  Control command - same codes as drive 0x2000 (CMD_*)
+//   1  [40002]  Frequency setpoint, Hz x100
+//
+//  Telemetry (read only, from the controller's cache)
+//  16  [40017]  Drive status word (0x2101)
+//  17  [40018]  Output frequency, Hz x100
+//  18  [40019]  Output current, A x100
+//  19  [40020]  Output voltage, V x10
+//  20  [40021]  Target frequency, Hz x100
+//  21  [40022]  Flags: bit0 connected, bit1 running, bit2 faulted, bit3 ready
+//  22  [40023]  Data age, ms since last successful poll (saturates at 65535)
+//  23  [40024]  Requests served by this endpoint (wraps)
+#define SLAVE_REG_COMMAND       0
+#define SLAVE_REG_FREQUENCY     1
+#define SLAVE_REG_STATUS_WORD   16
+#define SLAVE_REG_OUT_FREQ      17
+#define SLAVE_REG_CURRENT       18
+#define SLAVE_REG_VOLTAGE       19
+#define SLAVE_REG_TARGET_FREQ   20
+#define SLAVE_REG_FLAGS         21
+#define SLAVE_REG_DATA_AGE      22
+#define SLAVE_REG_REQUESTS      23
+#define SLAVE_REG_COUNT         24
+
+class ModbusSlave {
+public:
+    ModbusSlave(ModbusVFD& vfd);
+    ~ModbusSlave();
+
+    bool begin(uint8_t slaveId = RTU_SLAVE_ID);
+    void stop();
+
+    bool isRunning() const { return running; }
+
+    // Statistics
+    uint32_t getRequestCount() const { return requestCount; }
+    uint32_t getErrorCount() const { return errorCount; }
+    uint32_t getMaxResponseMicros() const { return maxResponseMicros; }
+
+private:
+    ModbusVFD& vfd;
+    uint8_t slaveId;
+    bool running;
+
+    uint8_t frame[MODBUS_RTU_MAX_FRAME];
+    uint8_t reply[MODBUS_RTU_MAX_FRAME];
+
+    uint16_t lastCommand;
+    uint16_t lastFrequency;
+
+    volatile uint32_t requestCount;
+    volatile uint32_t errorCount;
+    volatile uint32_t maxResponseMicros;
+
+    // Runs on the UART event task when the line goes idle after a frame
+    void onFrameReceived();
+    size_t processRequest(const uint8_t* request, size_t length, uint8_t* response);
+
+    // Register access; writes return 0 or a Modbus exception code
+    bool readRegister(uint16_t address, uint16_t& value);
+    uint8_t writeRegister(uint16_t address, uint16_t value);
+    static bool isWritable(uint16_t address) { return address <= SLAVE_REG_FREQUENCY; }
+
+    size_t buildException(uint8_t function, uint8_t code, uint8_t* response);
+    void sendReply(const uint8_t* response, size_t length);
+};
+
+#endif // MODBUS_SLAVE_H
@@ -0,0 +1,394 @@
+// ModbusTCPTransport.cpp
+// Modbus TCP client for drives behind RTU-to-TCP gateways
+
+#include "ModbusTCPTransport.h"
+#include <lwip/sockets.h>
+
+ModbusTCPTransport::ModbusTCPTransport(const char* host, uint16_t port) :
+    host(host),
+    port(port),
+    nextTransactionId(1),
+    lastConnectAttempt(0),
+    pendingSocket(-1)
+{
+}
+
+ModbusTCPTransport::~ModbusTCPTransport() {
+    disconnect();
+}
+
+bool ModbusTCPTransport::begin() {
+    DEBUG_PRINTLN("ModbusTCPTransport: Initialized");
+    DEBUG_PRINTF("  Gateway: %s:%d\n", host.c_str(), port);
+    DEBUG_PRINTF("  Max in flight: %d\n", MODBUS_TCP_MAX_IN_FLIGHT);
+
+    arbiter.resetStats();
+    return ensureConnected();
+}
+
+bool ModbusTCPTransport::ensureConnected() {
+    if (client.connected()) return true;
+    if (pendingSocket >= 0) return finishConnect();
+
+    // Don't stall the loop retrying an unreachable gateway
+    if (lastConnectAttempt != 0 && millis() - lastConnectAttempt < MODBUS_TCP_RECONNECT_MS) {
+        return false;
+    }
+    lastConnectAttempt = millis();
+
+    return startConnect();
+}
+
+bool ModbusTCPTransport::startConnect() {
+    // Gateways are normally configured by address; names go through the
+    // DNS cache
+    IPAddress address;
+    if (!address.fromString(host.c_str()) && !WiFi.hostByName(host.c_str(), address)) {
+        DEBUG_PRINTF("ModbusTCPTransport: Cannot resolve %s\n", host.c_str());
+        return false;
+    }
+
+    int fd = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+        DEBUG_PRINTLN("ModbusTCPTransport: No socket available");
+        return false;
+    }
+    lwip_fcntl(fd, F_SETFL, lwip_fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in gateway;
+    memset(&gateway, 0, sizeof(gateway));
+    gateway.sin_family = AF_INET;
+    gateway.sin_addr.s_addr = (uint32_t)address;
+    gateway.sin_port = htons(port);
+
+    // The handshake completes in the background, finishConnect() picks
+    // it up on a later call instead of blocking the loop here
+    if (lwip_connect(fd, (struct sockaddr*)&gateway, sizeof(gateway)) != 0 && errno != EINPROGRESS) {
+        DEBUG_PRINTF("ModbusTCPTransport: Connect to %s:%d failed (%d)\n", host.c_str(), port, errno);
+        lwip_close(fd);
+        return false;
+    }
+
+    pendingSocket = fd;
+    return finishConnect();
+}
+
+bool ModbusTCPTransport::finishConnect() {
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(pendingSocket, &writable);
+    struct timeval poll = { 0, 0 };
+
+    if (lwip_select(pendingSocket + 1, nullptr, &writable, nullptr, &poll) <= 0) {
+        if (millis() - lastConnectAttempt < MODBUS_TCP_TIMEOUT) {
+            return false;  // Still connecting
+        }
+        DEBUG_PRINTF("ModbusTCPTransport: Connect to %s:%d timed out\n", host.c_str(), port);
+        lwip_close(pendingSocket);
+        pendingSocket = -1;
+        return false;
+    }
+
+    int error = 0;
+    socklen_t length = sizeof(error);
+    lwip_getsockopt(pendingSocket, SOL_SOCKET, SO_ERROR, &error, &length);
+    if (error != 0) {
+        DEBUG_PRINTF("ModbusTCPTransport: Connect to %s:%d failed (%d)\n", host.c_str(), port, error);
+        lwip_close(pendingSocket);
+        pendingSocket = -1;
+        return false;
+    }
+
+    // Back to blocking with timeouts, the way WiFiClient::connect leaves
+    // its sockets, then hand the socket over
+    int fd = pendingSocket;
+    pendingSocket = -1;
+    lwip_fcntl(fd, F_SETFL, lwip_fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+    struct timeval timeout = { MODBUS_TCP_TIMEOUT / 1000, (MODBUS_TCP_TIMEOUT % 1000) * 1000 };
+    lwip_setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    lwip_setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    client = WiFiClient(fd);
+    client.setNoDelay(true);
+    DEBUG_PRINTF("ModbusTCPTransport: Connected to %s:%d\n", host.c_str(), port);
+    return true;
+}
+
+void ModbusTCPTransport::disconnect() {
+    if (pendingSocket >= 0) {
+        lwip_close(pendingSocket);
+        pendingSocket = -1;
+    }
+    if (client) {
+        client.stop();
+    }
+}
+
+uint8_t ModbusTCPTransport::readRegisters(uint8_t slaveId, uint16_t address, uint16_t count,
+                                          uint16_t* dest, bool inputRegisters) {
+    ModbusReadRequest request = { address, count, dest, inputRegisters, MODBUS_ERR_TIMEOUT };
+    readBatch(slaveId, &request, 1);
+    return request.result;
+}
+
+uint8_t ModbusTCPTransport::writeSingleRegister(uint8_t slaveId, uint16_t address, uint16_t value) {
+    uint8_t pdu[5] = {
+        MODBUS_FC_WRITE_SINGLE,
+        (uint8_t)(address >> 8), (uint8_t)(address & 0xFF),
+        (uint8_t)(value >> 8), (uint8_t)(value & 0xFF)
+    };
+
+    uint8_t response[MODBUS_TCP_MAX_PDU];
+    size_t responseLength = 0;
+    uint8_t result = transact(slaveId, pdu, sizeof(pdu), response, responseLength);
+    if (result != MODBUS_OK || slaveId == MODBUS_BROADCAST_ID) return result;
+
+    return checkWritePDU(response, responseLength, MODBUS_FC_WRITE_SINGLE);
+}
+
+uint8_t ModbusTCPTransport::writeMultipleRegisters(uint8_t slaveId, uint16_t address,
+                                                   const uint16_t* values, uint16_t count) {
+    if (count == 0 || count > 123) return MODBUS_ERR_TOO_LONG;
+
+    uint8_t pdu[MODBUS_TCP_MAX_PDU];
+    pdu[0] = MODBUS_FC_WRITE_MULTIPLE;
+    pdu[1] = address >> 8;
+    pdu[2] = address & 0xFF;
+    pdu[3] = count >> 8;
+    pdu[4] = count & 0xFF;
+    pdu[5] = count * 2;
+    for (uint16_t i = 0; i < count; i++) {
+        pdu[6 + i * 2] = values[i] >> 8;
+        pdu[7 + i * 2] = values[i] & 0xFF;
+    }
+
+    uint8_t response[MODBUS_TCP_MAX_PDU];
+    size_t responseLength = 0;
+    uint8_t result = transact(slaveId, pdu, 6 + count * 2, response, responseLength);
+    if (result != MODBUS_OK || slaveId == MODBUS_BROADCAST_ID) return result;
+
+    return checkWritePDU(response, responseLength, MODBUS_FC_WRITE_MULTIPLE);
+}
+
+void ModbusTCPTransport::readBatch(uint8_t slaveId, ModbusReadRequest* requests, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        requests[i].result = MODBUS_ERR_TIMEOUT;
+    }
+
+    if (!ensureConnected()) {
+        for (size_t i = 0; i < count; i++) {
+            requests[i].result = MODBUS_ERR_NOT_CONNECTED;
+        }
+        return;
+    }
+
+    // Requests currently on the wire
+    struct InFlight {
+        uint16_t transactionId;
+        size_t index;
+    };
+    InFlight window[MODBUS_TCP_MAX_IN_FLIGHT];
+    size_t inFlight = 0;
+    size_t nextToSend = 0;
+    size_t completed = 0;
+
+    uint8_t pdu[MODBUS_TCP_MAX_PDU];
+    unsigned long deadline = millis() + MODBUS_TCP_TIMEOUT;
+
+    while (completed < count) {
+        // Keep the window full
+        while (inFlight < MODBUS_TCP_MAX_IN_FLIGHT && nextToSend < count) {
+            size_t pduLength = buildReadPDU(requests[nextToSend], pdu);
+            uint16_t transactionId = sendRequest(slaveId, pdu, pduLength);
+            if (transactionId == 0) {
+                disconnect();
+                return;  // Everything left keeps its timeout result
+            }
+            window[inFlight++] = { transactionId, nextToSend++ };
+        }
+
+        uint16_t transactionId = 0;
+        size_t pduLength = 0;
+        uint8_t result = receiveResponse(transactionId, pdu, pduLength, deadline);
+        if (result != MODBUS_OK) {
+            // Stream position is unknown now - start over on a fresh connection
+            DEBUG_PRINTF("ModbusTCPTransport: Batch aborted (0x%02X), %d of %d done\n",
+                         result, completed, count);
+            disconnect();
+            return;
+        }
+
+        // Match the response to its request; late replies to abandoned
+        // requests simply find no match and are dropped
+        for (size_t i = 0; i < inFlight; i++) {
+            if (window[i].transactionId != transactionId) continue;
+
+            ModbusReadRequest& request = requests[window[i].index];
+            request.result = parseReadPDU(pdu, pduLength, request);
+            completed++;
+
+            window[i] = window[--inFlight];
+            deadline = millis() + MODBUS_TCP_TIMEOUT;
+            break;
+        }
+    }
+}
+
+size_t ModbusTCPTransport::transactRaw(const uint8_t* request, size_t length,
+                                       uint8_t* response, size_t maxLength) {
+    if (length < 4 || !modbusCheckCRC(request, length)) return 0;
+
+    uint8_t unitId = request[0];
+    const uint8_t* pdu = request + 1;
+    size_t pduLength = length - 3;
+
+    // Unit 0 is forwarded as a broadcast by gateways - no reply to wait for
+    if (unitId == MODBUS_BROADCAST_ID) {
+        if (ensureConnected()) {
+            sendRequest(unitId, pdu, pduLength);
+        }
+        return 0;
+    }
+
+    uint8_t responsePdu[MODBUS_TCP_MAX_PDU];
+    size_t responseLength = 0;
+    if (transact(unitId, pdu, pduLength, responsePdu, responseLength) != MODBUS_OK) {
+        return 0;
+    }
+
+    // Re-wrap as an RTU frame
+    if (responseLength + 3 > maxLength) return 0;
+    response[0] = unitId;
+    memcpy(response + 1, responsePdu, responseLength);
+    return modbusAppendCRC(response, responseLength + 1);
+}
+
+uint16_t ModbusTCPTransport::sendRequest(uint8_t unitId, const uint8_t* pdu, size_t pduLength) {
+    if (pduLength > MODBUS_TCP_MAX_PDU) return 0;
+
+    uint16_t transactionId = nextTransactionId++;
+    if (nextTransactionId == 0) nextTransactionId = 1;  // 0 means failure
+
+    uint8_t adu[MODBUS_TCP_HEADER_SIZE + MODBUS_TCP_MAX_PDU];
+    adu[0] = transactionId >> 8;
+    adu[1] = transactionId & 0xFF;
+    adu[2] = 0;  // Protocol id
+    adu[3] = 0;
+    adu[4] = (pduLength + 1) >> 8;
+    adu[5] = (pduLength + 1) & 0xFF;
+    adu[6] = unitId;
+    memcpy(adu + MODBUS_TCP_HEADER_SIZE, pdu, pduLength);
+
+    // One write per request keeps each ADU in a single segment
+    size_t total = MODBUS_TCP_HEADER_SIZE + pduLength;
+    if (client.write(adu, total) != total) {
+        DEBUG_PRINTLN("ModbusTCPTransport: Write failed");
+        return 0;
+    }
+    return transactionId;
+}
+
+uint8_t ModbusTCPTransport::receiveResponse(uint16_t& transactionId, uint8_t* pdu,
+                                            size_t& pduLength, unsigned long deadline) {
+    uint8_t header[MODBUS_TCP_HEADER_SIZE];
+    if (!readExact(header, sizeof(header), deadline)) {
+        return client.connected() ? MODBUS_ERR_TIMEOUT : MODBUS_ERR_NOT_CONNECTED;
+    }
+
+    uint16_t protocolId = (header[2] << 8) | header[3];
+    uint16_t length = (header[4] << 8) | header[5];
+    if (protocolId != 0 || length < 2 || length - 1 > MODBUS_TCP_MAX_PDU) {
+        return MODBUS_ERR_INVALID_RESPONSE;
+    }
+
+    pduLength = length - 1;
+    if (!readExact(pdu, pduLength, deadline)) {
+        return MODBUS_ERR_TIMEOUT;
+    }
+
+    transactionId = (header[0] << 8) | header[1];
+    return MODBUS_OK;
+}
+
+uint8_t ModbusTCPTransport::transact(uint8_t unitId, const uint8_t* pdu, size_t pduLength,
+                                     uint8_t* responsePdu, size_t& responseLength) {
+    if (!ensureConnected()) return MODBUS_ERR_NOT_CONNECTED;
+
+    uint16_t transactionId = sendRequest(unitId, pdu, pduLength);
+    if (transactionId == 0) {
+        disconnect();
+        return MODBUS_ERR_NOT_CONNECTED;
+    }
+
+    // The gateway sends broadcasts on without answering
+    if (unitId == MODBUS_BROADCAST_ID) {
+        responseLength = 0;
+        return MODBUS_OK;
+    }
+
+    unsigned long deadline = millis() + MODBUS_TCP_TIMEOUT;
+    while (true) {
+        uint16_t receivedId = 0;
+        uint8_t result = receiveResponse(receivedId, responsePdu, responseLength, deadline);
+        if (result != MODBUS_OK) {
+            disconnect();
+            return result;
+        }
+        // Skip late replies to earlier, abandoned requests
+        if (receivedId == transactionId) return MODBUS_OK;
+    }
+}
+
+bool ModbusTCPTransport::readExact(uint8_t* buffer, size_t length, unsigned long deadline) {
+    size_t received = 0;
+    while (received < length) {
+        int available = client.available();
+        if (available > 0) {
+            size_t chunk = min((size_t)available, length - received);
+            received += client.read(buffer + received, chunk);
+            continue;
+        }
+        if (!client.connected() || (long)(millis() - deadline) >= 0) {
+            return false;
+        }
+        delay(1);
+    }
+    return true;
+}
+
+size_t ModbusTCPTransport::buildReadPDU(const ModbusReadRequest& request, uint8_t* pdu) {
+    pdu[0] = request.inputRegisters ? MODBUS_FC_READ_INPUT : MODBUS_FC_READ_HOLDING;
+    pdu[1] = request.address >> 8;
+    pdu[2] = request.address & 0xFF;
+    pdu[3] = request.count >> 8;
+    pdu[4] = request.count & 0xFF;
+    return 5;
+}
+
+uint8_t ModbusTCPTransport::parseReadPDU(const uint8_t* pdu, size_t pduLength,
+                                         ModbusReadRequest& request) {
+    uint8_t function = request.inputRegisters ? MODBUS_FC_READ_INPUT : MODBUS_FC_READ_HOLDING;
+
+    if (pduLength >= 2 && pdu[0] == (function | 0x80)) {
+        return pdu[1];  // Exception code from the slave
+    }
+    if (pduLength < 2 || pdu[0] != function || pdu[1] != request.count * 2 ||
+        pduLength != (size_t)(2 + pdu[1])) {
+        return MODBUS_ERR_INVALID_RESPONSE;
+    }
+
+    for (uint16_t i = 0; i < request.count; i++) {
+        request.dest[i] = (pdu[2 + i * 2] << 8) | pdu[3 + i * 2];
+    }
+    return MODBUS_OK;
+}
+
+uint8_t ModbusTCPTransport::checkWritePDU(const uint8_t* pdu, size_t pduLength, uint8_t function) {
+    if (pduLength >= 2 && pdu[0] == (function | 0x80)) {
+        return pdu[1];
+    }
+    if (pduLength != 5 || pdu[0] != function) {
+        return MODBUS_ERR_INVALID_RESPONSE;
+    }
+    return MODBUS_OK;
+}
@@ -0,0 +1,74 @@
+// ModbusTCPTransport.h
+// Modbus TCP client for drives behind RTU-to-TCP gateways
+
+#ifndef MODBUS_TCP_TRANSPORT_H
+#define MODBUS_TCP_TRANSPORT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "Config.h"
+#include "ModbusRTU.h"
+#include "ModbusTransport.h"
+
+// MBAP header: transaction id, protocol id, length, unit id
+#define MODBUS_TCP_HEADER_SIZE  7
+#define MODBUS_TCP_MAX_PDU      253
+
+class ModbusTCPTransport : public ModbusTransport {
+public:
+    ModbusTCPTransport(const char* host, uint16_t port = VFD_TCP_PORT);
+    ~ModbusTCPTransport();
+
+    // Connects lazily - the network may not be up yet. The TCP handshake
+    // runs in the background; requests fail as not connected until it's done
+    bool begin() override;
+    const char* name() const override { return "tcp"; }
+
+    uint8_t readRegisters(uint8_t slaveId, uint16_t address, uint16_t count,
+                          uint16_t* dest, bool inputRegisters = false) override;
+    uint8_t writeSingleRegister(uint8_t slaveId, uint16_t address, uint16_t value) override;
+    uint8_t writeMultipleRegisters(uint8_t slaveId, uint16_t address,
+                                   const uint16_t* values, uint16_t count) override;
+
+    // Pipelined: keeps up to MODBUS_TCP_MAX_IN_FLIGHT requests outstanding
+    // and matches responses by transaction id
+    void readBatch(uint8_t slaveId, ModbusReadRequest* requests, size_t count) override;
+
+    // RTU frames are re-wrapped as MBAP requests for the bridge
+    size_t transactRaw(const uint8_t* request, size_t length,
+                       uint8_t* response, size_t maxLength) override;
+
+    bool isConnected() { return client.connected(); }
+
+private:
+    WiFiClient client;
+    String host;
+    uint16_t port;
+    uint16_t nextTransactionId;
+    unsigned long lastConnectAttempt;
+    int pendingSocket;                  // Non-blocking connect in progress, -1 if none
+
+    bool ensureConnected();
+    bool startConnect();
+    bool finishConnect();
+    void disconnect();
+
+    // Send one request, returns its transaction id (0 on failure)
+    uint16_t sendRequest(uint8_t unitId, const uint8_t* pdu, size_t pduLength);
+
+    // Read the next response ADU from the stream
+    uint8_t receiveResponse(uint16_t& transactionId, uint8_t* pdu, size_t& pduLength,
+                            unsigned long deadline);
+
+    // Send and wait for the matching response
+    uint8_t transact(uint8_t unitId, const uint8_t* pdu, size_t pduLength,
+                     uint8_t* responsePdu, size_t& responseLength);
+
+    bool readExact(uint8_t* buffer, size_t length, unsigned long deadline);
+
+    static size_t buildReadPDU(const ModbusReadRequest& request, uint8_t* pdu);
+    static uint8_t parseReadPDU(const uint8_t* pdu, size_t pduLength, ModbusReadRequest& request);
+    static uint8_t checkWritePDU(const uint8_t* pdu, size_t pduLength, uint8_t function);
+};
+
+#endif // MODBUS_TCP_TRANSPORT_H
@@ -0,0 +1,11 @@
+// ModbusTransport.cpp
+// Link layer under ModbusVFD
+
+#include "ModbusTransport.h"
+
+void ModbusTransport::readBatch(uint8_t slaveId, ModbusReadRequest* requests, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        requests[i].result = readRegisters(slaveId, requests[i].address, requests[i].count,
+                                           requests[i].dest, requests[i].inputRegisters);
+    }
+}
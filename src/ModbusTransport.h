@@ -0,0 +1,57 @@
+// ModbusTransport.h
+// Link layer under ModbusVFD: RTU over RS485 or Modbus TCP through a gateway
+
+#ifndef MODBUS_TRANSPORT_H
+#define MODBUS_TRANSPORT_H
+
+#include <Arduino.h>
+#include "BusArbiter.h"
+
+// Result codes follow ModbusMaster: 0 = success, 0x01-0x04 = exception
+// returned by the slave, 0xE0 and up = local errors
+#define MODBUS_OK                   0x00
+#define MODBUS_ERR_TIMEOUT          0xE2
+#define MODBUS_ERR_INVALID_RESPONSE 0xE3
+#define MODBUS_ERR_NOT_CONNECTED    0xE4
+#define MODBUS_ERR_TOO_LONG         0xE5
+
+// One register block read, used for batched polling
+struct ModbusReadRequest {
+    uint16_t address;
+    uint16_t count;
+    uint16_t* dest;
+    bool inputRegisters;    // FC04 instead of FC03
+    uint8_t result;         // Filled in by the transport
+};
+
+class ModbusTransport {
+public:
+    virtual ~ModbusTransport() {}
+
+    // Safe to call more than once (several drives may share a transport)
+    virtual bool begin() = 0;
+    virtual const char* name() const = 0;
+
+    virtual uint8_t readRegisters(uint8_t slaveId, uint16_t address, uint16_t count,
+                                  uint16_t* dest, bool inputRegisters = false) = 0;
+    virtual uint8_t writeSingleRegister(uint8_t slaveId, uint16_t address, uint16_t value) = 0;
+    virtual uint8_t writeMultipleRegisters(uint8_t slaveId, uint16_t address,
+                                           const uint16_t* values, uint16_t count) = 0;
+
+    // Several reads from one slave. The default issues them one after the
+    // other; transports that can keep requests in flight override it.
+    virtual void readBatch(uint8_t slaveId, ModbusReadRequest* requests, size_t count);
+
+    // Raw RTU frame exchange - request and response include the CRC.
+    // Returns response length, 0 on timeout or for broadcast requests.
+    virtual size_t transactRaw(const uint8_t* request, size_t length,
+                               uint8_t* response, size_t maxLength) = 0;
+
+    // Every user of this link shares one arbiter
+    BusArbiter& getArbiter() { return arbiter; }
+
+protected:
+    BusArbiter arbiter;
+};
+
+#endif // MODBUS_TRANSPORT_H
@@ -1,16 +1,23 @@
 #include "ModbusVFD.h"
+#include "ModbusRTU.h"
 
-// Static member initialization
-ModbusVFD* ModbusVFD::instance = nullptr;
-
-ModbusVFD::ModbusVFD() :
+ModbusVFD::ModbusVFD(ModbusTransport& transport) :
+    transport(transport),
+    arbiter(transport.getArbiter()),
     connected(false),
     debugEnabled(false),
     slaveId(MODBUS_SLAVE_ID),
     lastCommandTime(0),
-    lastSetFrequency(0.0)
+    lastSetFrequency(0.0),
+    frequencyPending(false),
+    commandPending(false),
+    pendingFrequency(0.0),
+    pendingCommand(0),
+    pendingFrequencySince(0),
+    lastFrequencyLatencyUs(0),
+    maxFrequencyLatencyUs(0)
 {
-    instance = this;
+    serviceMutex = xSemaphoreCreateMutex();
 
     // Initialize status
     memset(&status, 0, sizeof(status));
@@ -23,31 +30,18 @@ ModbusVFD::ModbusVFD() :
 }
 
 ModbusVFD::~ModbusVFD() {
-    instance = nullptr;
+    vSemaphoreDelete(serviceMutex);
 }
 
 bool ModbusVFD::begin(uint8_t slaveId) {
     this->slaveId = slaveId;
 
-    // Initialize RS485 serial port
-    RS485_SERIAL.begin(RS485_BAUD_RATE, RS485_CONFIG, RS485_RX_PIN, RS485_TX_PIN);
-
-    // Initialize direction control pin
-    pinMode(RS485_DE_PIN, OUTPUT);
-    digitalWrite(RS485_DE_PIN, LOW); // Receive mode by default
-
-    // Initialize Modbus
-    modbus.begin(slaveId, RS485_SERIAL);
-
-    // Set callbacks for RS485 direction control
-    modbus.preTransmission(preTransmissionCallback);
-    modbus.postTransmission(postTransmissionCallback);
+    // Bring up the link (no-op if another drive already did)
+    transport.begin();
 
     DEBUG_PRINTLN("ModbusVFD: Initialized");
     DEBUG_PRINTF("  Slave ID: %d\n", slaveId);
-    DEBUG_PRINTF("  Baud Rate: %d\n", RS485_BAUD_RATE);
-    DEBUG_PRINTF("  TX Pin: %d, RX Pin: %d, DE Pin: %d\n",
-                 RS485_TX_PIN, RS485_RX_PIN, RS485_DE_PIN);
+    DEBUG_PRINTF("  Transport: %s\n", transport.name());
 
     // Try to read status to check connection
     delay(100);
@@ -121,14 +115,71 @@ bool ModbusVFD::jog(bool reverse) {
     return sendCommand(command);
 }
 
+void ModbusVFD::requestFrequency(float frequencyHz) {
+    portENTER_CRITICAL(&pendingLock);
+    if (!frequencyPending) {
+        pendingFrequencySince = micros();
+    }
+    pendingFrequency = frequencyHz;
+    frequencyPending = true;
+    portEXIT_CRITICAL(&pendingLock);
+}
+
+void ModbusVFD::requestCommand(uint16_t command) {
+    portENTER_CRITICAL(&pendingLock);
+    pendingCommand = command;
+    commandPending = true;
+    portEXIT_CRITICAL(&pendingLock);
+}
+
+void ModbusVFD::serviceCommands() {
+    // Hold queued writes until the drive answers again
+    if (!connected || !hasPendingCommands()) return;
+
+    // loop() and the polling task both service the queue. The snapshot
+    // and its bus write go together, or one caller could write a value
+    // older than the one the other just wrote. Whoever finds the mutex
+    // taken leaves the newer value queued for its next pass.
+    if (xSemaphoreTake(serviceMutex, 0) != pdTRUE) return;
+
+    // Take a consistent copy, then release before touching the bus
+    portENTER_CRITICAL(&pendingLock);
+    bool doFrequency = frequencyPending;
+    bool doCommand = commandPending;
+    float frequency = pendingFrequency;
+    uint16_t command = pendingCommand;
+    uint32_t queuedSince = pendingFrequencySince;
+    frequencyPending = false;
+    commandPending = false;
+    portEXIT_CRITICAL(&pendingLock);
+
+    // Setpoint first so a queued start runs at the new frequency
+    if (doFrequency) {
+        if (setFrequency(frequency)) {
+            lastFrequencyLatencyUs = micros() - queuedSince;
+            if (lastFrequencyLatencyUs > maxFrequencyLatencyUs) {
+                maxFrequencyLatencyUs = lastFrequencyLatencyUs;
+            }
+        } else if (debugEnabled) {
+            DEBUG_PRINTF("ModbusVFD: Queued frequency %.2f Hz failed\n", frequency);
+        }
+    }
+    if (doCommand && !sendCommand(command) && debugEnabled) {
+        DEBUG_PRINTF("ModbusVFD: Queued command 0x%04X failed\n", command);
+    }
+
+    xSemaphoreGive(serviceMutex);
+}
+
 bool ModbusVFD::updateStatus() {
-    uint16_t buffer[4];
+    uint16_t buffer[2];
     bool readSuccess = false;
 
-    // Read actual status register (0x2101) - contains run/stop/direction
-    if (!readRegisters(REG_STATUS_READ, 1, &buffer[0])) {
+    // Error/warning (0x2100) and drive status (0x2101) are adjacent, so
+    // both come in one read - fault detection needs 0x2100 every poll
+    if (!readRegisters(REG_ERROR_STATUS, 2, buffer)) {
         if (debugEnabled) {
-            DEBUG_PRINTLN("ModbusVFD: Failed to read status register");
+            DEBUG_PRINTLN("ModbusVFD: Failed to read status registers");
         }
         connected = false;
         return false;
@@ -140,31 +191,31 @@ bool ModbusVFD::updateStatus() {
     status.lastUpdateTime = millis();
 
     // Parse status word
-    status.statusWord = buffer[0];
+    status.errorStatus = buffer[0];
+    status.statusWord = buffer[1];
     parseStatusWord(status.statusWord);
 
-    // Also read error/warning status at 0x2100
     if (debugEnabled) {
-        uint16_t errorStatus = 0;
-        if (readRegisters(REG_ERROR_STATUS, 1, &errorStatus)) {
-            DEBUG_PRINTF("ModbusVFD: Error/Warning status (0x2100) = 0x%04X\n", errorStatus);
-            if (errorStatus != 0) {
-                DEBUG_PRINTF("  High byte (Warning): 0x%02X, Low byte (Error): 0x%02X\n",
-                             (errorStatus >> 8) & 0xFF, errorStatus & 0xFF);
-            }
+        DEBUG_PRINTF("ModbusVFD: Error/Warning status (0x2100) = 0x%04X\n", status.errorStatus);
+        if (status.errorStatus != 0) {
+            DEBUG_PRINTF("  High byte (Warning): 0x%02X, Low byte (Error): 0x%02X %s\n",
+                         (status.errorStatus >> 8) & 0xFF, status.errorStatus & 0xFF,
+                         errorName(status.errorStatus & 0xFF));
         }
     }
 
     // Read additional registers based on manual
-    // Note: We need to read them separately as they're not consecutive
-    // RTU timing is handled in pre/postTransmission
+    // They're not consecutive, so issue them as one batch - the TCP
+    // transport pipelines the requests, RTU sends them back to back
     uint16_t freqOut = 0, current = 0, voltage = 0;
-
-    // Try to read output frequency (0x2103)
-    if (debugEnabled) {
-        DEBUG_PRINTF("Attempting to read frequency at 0x%04X\n", REG_FREQ_OUT_READ);
-    }
-    if (readRegisters(REG_FREQ_OUT_READ, 1, &freqOut)) {
+    ModbusReadRequest requests[3] = {
+        { REG_FREQ_OUT_READ, 1, &freqOut, false, MODBUS_ERR_TIMEOUT },
+        { REG_CURRENT_READ, 1, &current, false, MODBUS_ERR_TIMEOUT },
+        { REG_VOLTAGE_READ, 1, &voltage, false, MODBUS_ERR_TIMEOUT }
+    };
+    readBatch(requests, 3);
+
+    if (requests[0].result == MODBUS_OK) {
         status.actualFrequency = freqOut / 100.0;  // XXX.XX Hz format
         if (debugEnabled) {
             DEBUG_PRINTF("  Read frequency: %d (%.2f Hz)\n", freqOut, status.actualFrequency);
@@ -186,34 +237,22 @@ bool ModbusVFD::updateStatus() {
         }
     }
 
-    // Try to read output current (0x2104)
-    if (debugEnabled) {
-        DEBUG_PRINTF("Attempting to read current at 0x%04X\n", REG_CURRENT_READ);
-    }
-    if (readRegisters(REG_CURRENT_READ, 1, &current)) {
+    if (requests[1].result == MODBUS_OK) {
         status.outputCurrent = current / 100.0;  // XX.XX A format
         if (debugEnabled) {
             DEBUG_PRINTF("  Read current: %d (%.2f A)\n", current, status.outputCurrent);
         }
-    } else {
-        if (debugEnabled) {
-            DEBUG_PRINTLN("  Failed to read current");
-        }
+    } else if (debugEnabled) {
+        DEBUG_PRINTLN("  Failed to read current");
     }
 
-    // Try to read output voltage (0x2106)
-    if (debugEnabled) {
-        DEBUG_PRINTF("Attempting to read voltage at 0x%04X\n", REG_VOLTAGE_READ);
-    }
-    if (readRegisters(REG_VOLTAGE_READ, 1, &voltage)) {
+    if (requests[2].result == MODBUS_OK) {
         status.outputVoltage = voltage / 10.0;  // XXX.X V format
         if (debugEnabled) {
             DEBUG_PRINTF("  Read voltage: %d (%.1f V)\n", voltage, status.outputVoltage);
         }
-    } else {
-        if (debugEnabled) {
-            DEBUG_PRINTLN("  Failed to read voltage");
-        }
+    } else if (debugEnabled) {
+        DEBUG_PRINTLN("  Failed to read voltage");
     }
 
     if (debugEnabled) {
@@ -244,28 +283,120 @@ uint16_t ModbusVFD::getStatusWord() {
     return status.statusWord;
 }
 
+const char* ModbusVFD::errorName(uint8_t code) {
+    // Error codes of status monitor 1 (0x2100 low byte, manual ch. 5),
+    // same list as the P06.17 fault record
+    static const char* const names[] = {
+        "No error",
+        "ocA Overcurrent during accel",
+        "ocd Overcurrent during decel",
+        "ocn Overcurrent at normal speed",
+        "GFF Ground fault",
+        "occ IGBT short circuit",
+        "ocS Overcurrent at stop",
+        "ovA Overvoltage during accel",
+        "ovd Overvoltage during decel",
+        "ovn Overvoltage at normal speed",
+        "ovS Overvoltage at stop",                      // 10
+        "LvA Low voltage during accel",
+        "Lvd Low voltage during decel",
+        "Lvn Low voltage at normal speed",
+        "LvS Low voltage at stop",
+        "OrP Input phase loss",
+        "oH1 IGBT overheat",
+        "oH2 Capacitor overheat",
+        "tH1o Thermistor 1 open",
+        "tH2o Thermistor 2 open",
+        "PWR Power reset off",                          // 20
+        "oL Drive overload",
+        "EoL1 Motor 1 thermal overload",
+        "EoL2 Motor 2 thermal overload",
+        "oH3 Motor overheat (PTC)",
+        nullptr,
+        "ot1 Over torque 1",
+        "ot2 Over torque 2",
+        "uc Under current",
+        nullptr,
+        "cF1 EEPROM write error",                       // 30
+        "cF2 EEPROM read error",
+        nullptr,
+        "cd1 U phase current sensor error",
+        "cd2 V phase current sensor error",
+        "cd3 W phase current sensor error",
+        "Hd0 CC hardware logic error",
+        "Hd1 OC hardware logic error",
+        "Hd2 OV hardware logic error",
+        "Hd3 OCC hardware logic error",
+        "AuE Motor auto tune error",                    // 40
+        "AFE PID feedback loss",
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        "ACE Analog input signal loss",
+        "EF External fault",
+        "EF1 Emergency stop",                           // 50
+        "bb Base block",
+        "Pcod Password error",
+        "ccod Software code lock",
+        "CE1 PC command error",
+        "CE2 PC address error",
+        "CE3 PC data error",
+        "CE4 PC slave error",
+        "CE10 PC communication timeout",
+        "CP10 PC keypad timeout",
+        "bf Braking transistor fault",                  // 60
+        "ydc Y-delta connection error",
+        "dEb Decel energy backup error",
+        "oSL Over slip error",
+        "ryF Electromagnet switch error",
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        "STL1 STO loss 1",
+        "S1 ES1 emergency stop",
+        "Fire In fire mode",
+        nullptr,
+        "STO Safe torque off active",
+        "STL2 STO loss 2",
+        "STL3 STO loss 3",
+        "Uoc U phase short",
+        "Voc V phase short",                            // 80
+        "Woc W phase short",
+        "UPHL U phase loss",
+        "VPHL V phase loss",
+        "WPHL W phase loss",
+        nullptr, nullptr, nullptr, nullptr, nullptr,
+        "FStp PLC force stop",                          // 90
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        "CD10 Ethernet card timeout",
+        nullptr,
+        "TRAP CPU command error"
+    };
+
+    if (code >= sizeof(names) / sizeof(names[0])) return "Unknown error";
+    return names[code] ? names[code] : "Reserved error";
+}
+
 bool ModbusVFD::setParameters(const VFDParams& params) {
     parameters = params;
     return true;
 }
 
-// Private helper functions
+bool ModbusVFD::applyRampTimes() {
+    if (!connected) return false;
 
-void ModbusVFD::preTransmission() {
-    // RTU mode requires >10ms silent interval before transmission
-    delay(15);  // 15ms to be safe
-    digitalWrite(RS485_DE_PIN, HIGH);  // Enable transmit mode
-    delayMicroseconds(100);  // Small delay for direction change
-}
+    // Accel/decel time 1 are adjacent (P01.12/P01.13) - one FC16 write
+    uint16_t times[2] = {
+        (uint16_t)(constrain(parameters.rampUpTime, 0.0, 600.0) * 100 + 0.5),
+        (uint16_t)(constrain(parameters.rampDownTime, 0.0, 600.0) * 100 + 0.5)
+    };
+
+    if (debugEnabled) {
+        DEBUG_PRINTF("ModbusVFD: Writing accel %.2f s / decel %.2f s\n",
+                     parameters.rampUpTime, parameters.rampDownTime);
+    }
 
-void ModbusVFD::postTransmission() {
-    // Wait for last byte to transmit (at 9600 baud, ~1ms per byte)
-    delay(2);
-    digitalWrite(RS485_DE_PIN, LOW);   // Enable receive mode
-    // RTU mode requires >10ms silent interval after transmission
-    delay(15);  // 15ms to be safe
+    return writeRegisters(REG_ACCEL_TIME, times, 2);
 }
 
+// Private helper functions
+
 bool ModbusVFD::sendCommand(uint16_t command) {
     return writeRegister(REG_CONTROL_WRITE, command);
 }
@@ -273,10 +404,15 @@ bool ModbusVFD::sendCommand(uint16_t command) {
 bool ModbusVFD::writeRegister(uint16_t address, uint16_t value) {
     uint8_t result;
 
+    // Let tunneled traffic in before we take the bus
+    arbiter.frameBoundary();
+    arbiter.beginFrame(BusSource::COMMAND);
+
     // Try primary address first
-    result = modbus.writeSingleRegister(address, value);
-    if (result == modbus.ku8MBSuccess) {
+    result = transport.writeSingleRegister(slaveId, address, value);
+    if (result == MODBUS_OK) {
         lastCommandTime = millis();
+        arbiter.endFrame(true);
         if (debugEnabled) {
             DEBUG_PRINTF("ModbusVFD: Write success at 0x%04X\n", address);
         }
@@ -295,9 +431,10 @@ bool ModbusVFD::writeRegister(uint16_t address, uint16_t value) {
         if (debugEnabled) {
             DEBUG_PRINTF("ModbusVFD: Trying alternative address 0x%04X\n", altAddress);
         }
-        result = modbus.writeSingleRegister(altAddress, value);
-        if (result == modbus.ku8MBSuccess) {
+        result = transport.writeSingleRegister(slaveId, altAddress, value);
+        if (result == MODBUS_OK) {
             lastCommandTime = millis();
+            arbiter.endFrame(true);
             return true;
         }
     }
@@ -306,14 +443,16 @@ bool ModbusVFD::writeRegister(uint16_t address, uint16_t value) {
     if (debugEnabled) {
         DEBUG_PRINTF("ModbusVFD: Trying multiple register write\n");
     }
-    modbus.setTransmitBuffer(0, value);
-    result = modbus.writeMultipleRegisters(altAddress, 1);
+    result = transport.writeMultipleRegisters(slaveId, altAddress, &value, 1);
 
-    if (result == modbus.ku8MBSuccess) {
+    if (result == MODBUS_OK) {
         lastCommandTime = millis();
+        arbiter.endFrame(true);
         return true;
     }
 
+    arbiter.endFrame(false);
+
     if (debugEnabled) {
         DEBUG_PRINTF("ModbusVFD: Write failed at addresses 0x%04X and 0x%04X, error: 0x%02X\n",
                      address, altAddress, result);
@@ -324,19 +463,40 @@ bool ModbusVFD::writeRegister(uint16_t address, uint16_t value) {
     return false;
 }
 
+bool ModbusVFD::writeRegisters(uint16_t address, const uint16_t* values, uint16_t count) {
+    arbiter.frameBoundary();
+    arbiter.beginFrame(BusSource::COMMAND);
+
+    uint8_t result = transport.writeMultipleRegisters(slaveId, address, values, count);
+    arbiter.endFrame(result == MODBUS_OK);
+
+    if (result != MODBUS_OK) {
+        if (debugEnabled) {
+            DEBUG_PRINTF("ModbusVFD: Block write of %d registers at 0x%04X failed, error: 0x%02X\n",
+                         count, address, result);
+        }
+        return false;
+    }
+
+    lastCommandTime = millis();
+    return true;
+}
+
 bool ModbusVFD::readRegisters(uint16_t address, uint16_t count, uint16_t* buffer) {
     // Debug: Show what we're trying to read
     if (debugEnabled) {
         DEBUG_PRINTF("ModbusVFD: Reading %d registers from 0x%04X\n", count, address);
     }
 
+    // Let tunneled traffic in before we take the bus
+    arbiter.frameBoundary();
+    arbiter.beginFrame(BusSource::POLLER);
+
     // Try holding registers first (Function 03)
-    uint8_t result = modbus.readHoldingRegisters(address, count);
+    uint8_t result = transport.readRegisters(slaveId, address, count, buffer);
 
-    if (result == modbus.ku8MBSuccess) {
-        for (uint16_t i = 0; i < count; i++) {
-            buffer[i] = modbus.getResponseBuffer(i);
-        }
+    if (result == MODBUS_OK) {
+        arbiter.endFrame(true);
         return true;
     }
 
@@ -345,15 +505,15 @@ bool ModbusVFD::readRegisters(uint16_t address, uint16_t count, uint16_t* buffer
         DEBUG_PRINTF("ModbusVFD: FC03 failed (0x%02X), trying FC04 for address 0x%04X\n", result, address);
     }
 
-    result = modbus.readInputRegisters(address, count);
+    result = transport.readRegisters(slaveId, address, count, buffer, true);
 
-    if (result == modbus.ku8MBSuccess) {
-        for (uint16_t i = 0; i < count; i++) {
-            buffer[i] = modbus.getResponseBuffer(i);
-        }
+    if (result == MODBUS_OK) {
+        arbiter.endFrame(true);
         return true;
     }
 
+    arbiter.endFrame(false);
+
     if (debugEnabled) {
         DEBUG_PRINTF("ModbusVFD: Read registers 0x%04X failed, error: 0x%02X\n",
                      address, result);
@@ -363,6 +523,54 @@ bool ModbusVFD::readRegisters(uint16_t address, uint16_t count, uint16_t* buffer
     return false;
 }
 
+void ModbusVFD::readBatch(ModbusReadRequest* requests, size_t count) {
+    arbiter.frameBoundary();
+    arbiter.beginFrame(BusSource::POLLER);
+
+    transport.readBatch(slaveId, requests, count);
+
+    // Same FC03 -> FC04 fallback as readRegisters, per entry
+    bool allOk = true;
+    for (size_t i = 0; i < count; i++) {
+        if (requests[i].result == MODBUS_OK || requests[i].inputRegisters) continue;
+
+        requests[i].result = transport.readRegisters(slaveId, requests[i].address, requests[i].count,
+                                                     requests[i].dest, true);
+        if (requests[i].result != MODBUS_OK) {
+            allOk = false;
+        }
+    }
+
+    arbiter.endFrame(allOk);
+}
+
+size_t ModbusVFD::transactRaw(const uint8_t* request, size_t length,
+                              uint8_t* response, size_t maxLength,
+                              BusSource source) {
+    if (length < 4 || length > MODBUS_RTU_MAX_FRAME) return 0;
+
+    arbiter.beginFrame(source);
+
+    size_t received = transport.transactRaw(request, length, response, maxLength);
+
+    // Broadcast requests never get a reply
+    if (request[0] == MODBUS_BROADCAST_ID) {
+        arbiter.endFrame(true);
+        return 0;
+    }
+
+    bool valid = received > 0 && modbusCheckCRC(response, received);
+    arbiter.endFrame(valid);
+
+    if (debugEnabled) {
+        DEBUG_PRINTF("ModbusVFD: Raw frame FC 0x%02X from %s, %d bytes back%s\n",
+                     request[1], BusArbiter::sourceName(source), received,
+                     valid ? "" : " (invalid)");
+    }
+
+    return received;
+}
+
 void ModbusVFD::parseStatusWord(uint16_t statusWord) {
     // Parse status bits from register 0x2101 according to manual
     // Bits 1-0: Drive status (00=Stop, 01=Decelerating, 10=Standby, 11=Operating)
@@ -397,7 +605,7 @@ void ModbusVFD::parseStatusWord(uint16_t statusWord) {
 
     // Set derived status
     status.isReady = (driveStatus == 0x02);  // 10B = Standby
-    status.isFaulted = false;  // Fault info is in register 0x2100
+    status.isFaulted = (status.errorStatus & 0xFF) != 0;  // Error code from 0x2100
 
     if (debugEnabled) {
         DEBUG_PRINTF("  Status Word Details: 0x%04X\n", statusWord);
@@ -423,18 +631,4 @@ void ModbusVFD::parseStatusWord(uint16_t statusWord) {
                      cmdByComm ? "Comm" : "Terminal",
                      paramLocked ? "Locked" : "Unlocked");
     }
-}
-
-// Static callback implementations
-
-void ModbusVFD::preTransmissionCallback() {
-    if (instance) {
-        instance->preTransmission();
-    }
-}
-
-void ModbusVFD::postTransmissionCallback() {
-    if (instance) {
-        instance->postTransmission();
-    }
 }
\ No newline at end of file
@@ -2,11 +2,13 @@
 #define MODBUS_VFD_H
 
 #include <Arduino.h>
-#include <ModbusMaster.h>
 #include "Config.h"
+#include "BusArbiter.h"
+#include "ModbusTransport.h"
 
 // VFD Status structure
 struct VFDStatus {
+    uint16_t errorStatus;       // 0x2100: warning code (high byte), error code (low byte)
     uint16_t statusWord;
     float actualFrequency;
     float outputCurrent;
@@ -27,7 +29,7 @@ struct VFDParams {
 
 class ModbusVFD {
 public:
-    ModbusVFD();
+    ModbusVFD(ModbusTransport& transport);
     ~ModbusVFD();
 
     // Initialize the Modbus communication
@@ -40,6 +42,19 @@ public:
     bool reset();
     bool jog(bool reverse = false);
 
+    // Queued control - safe from any task, coalesced (latest value wins)
+    // and written to the drive by serviceCommands() from the main loop
+    void requestFrequency(float frequencyHz);
+    void requestCommand(uint16_t command);
+    bool hasPendingCommands() const { return frequencyPending || commandPending; }
+    void serviceCommands();
+
+    // Queue-to-drive latency of queued setpoints, measured from the first
+    // request of a coalesced batch to the completed write
+    uint32_t getFrequencyLatency() const { return lastFrequencyLatencyUs; }
+    uint32_t getMaxFrequencyLatency() const { return maxFrequencyLatencyUs; }
+    void resetFrequencyLatency() { maxFrequencyLatencyUs = 0; }
+
     // Read functions
     bool updateStatus();
     float getFrequency();
@@ -57,15 +72,33 @@ public:
     // Get full status
     const VFDStatus& getStatus() const { return status; }
 
+    // Name of an error code (low byte of 0x2100), e.g. "ocA Overcurrent during accel"
+    static const char* errorName(uint8_t code);
+
     // Parameter functions
     bool setParameters(const VFDParams& params);
     const VFDParams& getParameters() const { return parameters; }
 
+    // Push rampUpTime/rampDownTime to the drive's accel/decel time 1
+    bool applyRampTimes();
+
+    // Raw RTU pass-through (request includes CRC). Returns the number of
+    // response bytes received, 0 on timeout or for broadcast requests.
+    size_t transactRaw(const uint8_t* request, size_t length,
+                       uint8_t* response, size_t maxLength,
+                       BusSource source = BusSource::BRIDGE);
+
+    // Bus sharing and per-source accounting (shared by all drives on the link)
+    BusArbiter& getArbiter() { return arbiter; }
+    ModbusTransport& getTransport() { return transport; }
+    uint8_t getSlaveId() const { return slaveId; }
+
     // Debug functions
     void enableDebug(bool enable) { debugEnabled = enable; }
 
 private:
-    ModbusMaster modbus;
+    ModbusTransport& transport;
+    BusArbiter& arbiter;
     VFDStatus status;
     VFDParams parameters;
 
@@ -75,20 +108,24 @@ private:
     uint32_t lastCommandTime;
     float lastSetFrequency;
 
+    // Pending queued writes
+    portMUX_TYPE pendingLock = portMUX_INITIALIZER_UNLOCKED;
+    volatile bool frequencyPending;
+    volatile bool commandPending;
+    float pendingFrequency;
+    uint16_t pendingCommand;
+    uint32_t pendingFrequencySince;
+    SemaphoreHandle_t serviceMutex;     // Snapshot to bus write, one consumer at a time
+    volatile uint32_t lastFrequencyLatencyUs;
+    volatile uint32_t maxFrequencyLatencyUs;
+
     // Helper functions
-    void preTransmission();
-    void postTransmission();
     bool sendCommand(uint16_t command);
     bool writeRegister(uint16_t address, uint16_t value);
+    bool writeRegisters(uint16_t address, const uint16_t* values, uint16_t count);
     bool readRegisters(uint16_t address, uint16_t count, uint16_t* buffer);
+    void readBatch(ModbusReadRequest* requests, size_t count);
     void parseStatusWord(uint16_t statusWord);
-
-    // Static callback functions for ModbusMaster
-    static void preTransmissionCallback();
-    static void postTransmissionCallback();
-
-    // Instance pointer for callbacks
-    static ModbusVFD* instance;
 };
 
 #endif // MODBUS_VFD_H
\ No newline at end of file
@@ -0,0 +1,178 @@
+// PCF85063.cpp
+// PCF85063 real-time clock on the board's I2C bus
+
+#include "PCF85063.h"
+
+// Registers
+#define PCF85063_CTRL_1         0x00
+#define PCF85063_SECONDS        0x04    // Seconds..years are consecutive
+
+// Control 1 bits
+#define PCF85063_CTRL_1_STOP    0x20
+#define PCF85063_CTRL_1_CAP_SEL 0x01    // 12.5 pF crystal load
+
+// Seconds register bit 7: oscillator stopped since the time was last set
+#define PCF85063_OS_FLAG        0x80
+
+PCF85063::PCF85063(TwoWire& wire) :
+    wire(wire),
+    timeValid(false)
+{
+}
+
+bool PCF85063::begin() {
+    wire.begin(RTC_SDA_PIN, RTC_SCL_PIN);
+
+    // Clock running, 24 h mode, 12.5 pF load as on the board
+    uint8_t control = PCF85063_CTRL_1_CAP_SEL;
+    if (!writeRegisters(PCF85063_CTRL_1, &control, 1) ||
+        !readRegisters(PCF85063_CTRL_1, &control, 1)) {
+        DEBUG_PRINTLN("PCF85063: Not responding");
+        return false;
+    }
+    if (control & PCF85063_CTRL_1_STOP) {
+        DEBUG_PRINTLN("PCF85063: Clock is stopped");
+        return false;
+    }
+
+    RTCDateTime time;
+    if (readTime(time)) {
+        char text[20];
+        format(time, text, sizeof(text));
+        DEBUG_PRINTF("PCF85063: %s%s\n", text, timeValid ? "" : " (not set)");
+    }
+    return true;
+}
+
+bool PCF85063::readTime(RTCDateTime& time) {
+    uint8_t data[7];
+    if (!readRegisters(PCF85063_SECONDS, data, sizeof(data))) return false;
+
+    timeValid = !(data[0] & PCF85063_OS_FLAG);
+    time.second = fromBcd(data[0] & 0x7F);
+    time.minute = fromBcd(data[1] & 0x7F);
+    time.hour = fromBcd(data[2] & 0x3F);
+    time.day = fromBcd(data[3] & 0x3F);
+    time.weekday = data[4] & 0x07;
+    time.month = fromBcd(data[5] & 0x1F);
+    time.year = fromBcd(data[6]) + RTC_YEAR_OFFSET;
+    return true;
+}
+
+bool PCF85063::setTime(const RTCDateTime& time) {
+    if (time.year < RTC_YEAR_OFFSET || time.year > RTC_YEAR_OFFSET + 99) return false;
+
+    // Weekday is derived so the register always agrees with the date
+    RTCDateTime normalized;
+    fromEpoch(toEpoch(time), normalized);
+
+    // Writing the seconds register also clears the OS flag
+    uint8_t data[7] = {
+        toBcd(normalized.second),
+        toBcd(normalized.minute),
+        toBcd(normalized.hour),
+        toBcd(normalized.day),
+        normalized.weekday,
+        toBcd(normalized.month),
+        toBcd(normalized.year - RTC_YEAR_OFFSET)
+    };
+    if (!writeRegisters(PCF85063_SECONDS, data, sizeof(data))) return false;
+
+    timeValid = true;
+    return true;
+}
+
+uint32_t PCF85063::now() {
+    RTCDateTime time;
+    if (!readTime(time)) return 0;
+    return toEpoch(time);
+}
+
+bool PCF85063::setEpoch(uint32_t epoch) {
+    RTCDateTime time;
+    fromEpoch(epoch, time);
+    return setTime(time);
+}
+
+uint32_t PCF85063::toEpoch(const RTCDateTime& time) {
+    // Days since 1970-01-01 for the proleptic Gregorian calendar
+    int32_t y = time.year - (time.month <= 2 ? 1 : 0);
+    int32_t era = y / 400;
+    int32_t yoe = y - era * 400;
+    int32_t doy = (153 * (time.month + (time.month > 2 ? -3 : 9)) + 2) / 5 + time.day - 1;
+    int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int32_t days = era * 146097 + doe - 719468;
+
+    return (uint32_t)days * 86400 + time.hour * 3600 + time.minute * 60 + time.second;
+}
+
+void PCF85063::fromEpoch(uint32_t epoch, RTCDateTime& time) {
+    uint32_t days = epoch / 86400;
+    uint32_t seconds = epoch % 86400;
+
+    time.hour = seconds / 3600;
+    time.minute = (seconds / 60) % 60;
+    time.second = seconds % 60;
+    time.weekday = (days + 4) % 7;  // 1970-01-01 was a Thursday
+
+    int32_t z = days + 719468;
+    int32_t era = z / 146097;
+    int32_t doe = z - era * 146097;
+    int32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int32_t mp = (5 * doy + 2) / 153;
+
+    time.day = doy - (153 * mp + 2) / 5 + 1;
+    time.month = mp < 10 ? mp + 3 : mp - 9;
+    time.year = yoe + era * 400 + (time.month <= 2 ? 1 : 0);
+}
+
+uint8_t PCF85063::daysInMonth(uint16_t year, uint8_t month) {
+    static const uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2 && ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0)) return 29;
+    return days[(month - 1) % 12];
+}
+
+bool PCF85063::parse(const char* text, RTCDateTime& time) {
+    unsigned year, month, day, hour = 0, minute = 0, second = 0;
+
+    // Date with an optional time; 'T' or space separated
+    int fields = sscanf(text, "%u-%u-%u%*[ T]%u:%u:%u", &year, &month, &day, &hour, &minute, &second);
+    if (fields != 3 && fields < 5) return false;
+    if (year < 1970 || year > 2105 || month < 1 || month > 12) return false;
+    if (day < 1 || day > daysInMonth(year, month)) return false;
+    if (hour > 23 || minute > 59 || second > 59) return false;
+
+    time.year = year;
+    time.month = month;
+    time.day = day;
+    time.hour = hour;
+    time.minute = minute;
+    time.second = second;
+    time.weekday = (toEpoch(time) / 86400 + 4) % 7;
+    return true;
+}
+
+void PCF85063::format(const RTCDateTime& time, char* buffer, size_t size) {
+    snprintf(buffer, size, "%04u-%02u-%02u %02u:%02u:%02u",
+             time.year, time.month, time.day, time.hour, time.minute, time.second);
+}
+
+bool PCF85063::readRegisters(uint8_t reg, uint8_t* data, size_t length) {
+    wire.beginTransmission(RTC_I2C_ADDRESS);
+    wire.write(reg);
+    if (wire.endTransmission(false) != 0) return false;
+
+    if (wire.requestFrom((uint8_t)RTC_I2C_ADDRESS, length) != length) return false;
+    for (size_t i = 0; i < length; i++) {
+        data[i] = wire.read();
+    }
+    return true;
+}
+
+bool PCF85063::writeRegisters(uint8_t reg, const uint8_t* data, size_t length) {
+    wire.beginTransmission(RTC_I2C_ADDRESS);
+    wire.write(reg);
+    wire.write(data, length);
+    return wire.endTransmission(true) == 0;
+}
@@ -0,0 +1,57 @@
+// PCF85063.h
+// PCF85063 real-time clock on the board's I2C bus
+
+#ifndef PCF85063_H
+#define PCF85063_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "Config.h"
+
+// Calendar time as kept by the RTC (local time, no time zone)
+struct RTCDateTime {
+    uint16_t year;
+    uint8_t month;      // 1-12
+    uint8_t day;        // 1-31
+    uint8_t weekday;    // 0 = Sunday
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+};
+
+class PCF85063 {
+public:
+    PCF85063(TwoWire& wire = Wire);
+
+    bool begin();
+
+    // Returns false on a bus error
+    bool readTime(RTCDateTime& time);
+    bool setTime(const RTCDateTime& time);
+
+    // Seconds since 1970-01-01 in the RTC's local time, 0 on error
+    uint32_t now();
+    bool setEpoch(uint32_t epoch);
+
+    // False after power loss until the time is set again (OS flag)
+    bool isTimeValid() const { return timeValid; }
+
+    // Calendar helpers
+    static uint32_t toEpoch(const RTCDateTime& time);
+    static void fromEpoch(uint32_t epoch, RTCDateTime& time);
+    static uint8_t daysInMonth(uint16_t year, uint8_t month);
+    static bool parse(const char* text, RTCDateTime& time);     // "YYYY-MM-DD HH:MM:SS"
+    static void format(const RTCDateTime& time, char* buffer, size_t size);
+
+private:
+    TwoWire& wire;
+    bool timeValid;
+
+    bool readRegisters(uint8_t reg, uint8_t* data, size_t length);
+    bool writeRegisters(uint8_t reg, const uint8_t* data, size_t length);
+
+    static uint8_t toBcd(uint8_t value) { return ((value / 10) << 4) | (value % 10); }
+    static uint8_t fromBcd(uint8_t value) { return (value >> 4) * 10 + (value & 0x0F); }
+};
+
+#endif // PCF85063_H
@@ -0,0 +1,288 @@
+// PIDAutotuner.cpp
+// Relay-method autotune for the drive's internal PID (P08.01-P08.03)
+
+#include "PIDAutotuner.h"
+
+PIDAutotuner::PIDAutotuner(ModbusTransport& transport) :
+    transport(transport),
+    task(nullptr),
+    state(TuneState::IDLE),
+    abortRequested(false),
+    message("")
+{
+    memset(&config, 0, sizeof(config));
+    memset(&result, 0, sizeof(result));
+}
+
+PIDAutotuner::~PIDAutotuner() {
+    if (task) {
+        vTaskDelete(task);
+    }
+}
+
+bool PIDAutotuner::start(const AutotuneConfig& newConfig) {
+    if (state == TuneState::RUNNING) return false;
+    if (newConfig.amplitude <= 0 || newConfig.pvScale == 0 || newConfig.maxFrequency <= 0) return false;
+
+    config = newConfig;
+    memset(&result, 0, sizeof(result));
+    abortRequested = false;
+    message = "Running";
+    state = TuneState::RUNNING;
+
+    // Sampling runs on its own task so web traffic can't disturb it
+    BaseType_t created = xTaskCreatePinnedToCore(
+        taskEntry,
+        "PIDAutotuner",
+        VFD_CONTROL_TASK_STACK,
+        this,
+        VFD_CONTROL_TASK_PRIORITY,
+        &task,
+        VFD_CONTROL_TASK_CORE
+    );
+    if (created != pdPASS) {
+        task = nullptr;
+        finish(TuneState::FAILED, "Could not create task");
+        return false;
+    }
+
+    DEBUG_PRINTF("PIDAutotuner: Started on drive %d, %.1f +/- %.1f Hz around %.1f %%\n",
+                 config.slaveId, config.bias, config.amplitude, config.setpoint);
+    return true;
+}
+
+AutotuneResult PIDAutotuner::getResult() {
+    portENTER_CRITICAL(&lock);
+    AutotuneResult copy = result;
+    portEXIT_CRITICAL(&lock);
+    return copy;
+}
+
+const char* PIDAutotuner::stateName(TuneState state) {
+    switch (state) {
+        case TuneState::IDLE: return "idle";
+        case TuneState::RUNNING: return "running";
+        case TuneState::DONE: return "done";
+        case TuneState::FAILED: return "failed";
+        default: return "unknown";
+    }
+}
+
+void PIDAutotuner::taskEntry(void* param) {
+    PIDAutotuner* tuner = static_cast<PIDAutotuner*>(param);
+    tuner->run();
+    tuner->task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+void PIDAutotuner::run() {
+    BusArbiter& arbiter = transport.getArbiter();
+
+    // P08.00-P08.03 as one block: feedback selection and the gains
+    uint16_t params[4];
+    arbiter.beginFrame(BusSource::CONTROL);
+    uint8_t status = transport.readRegisters(config.slaveId, REG_PID_FEEDBACK_SEL, 4, params);
+    arbiter.endFrame(status == MODBUS_OK);
+    if (status != MODBUS_OK) {
+        finish(TuneState::FAILED, "Could not read P08.00-P08.03");
+        return;
+    }
+
+    // Open the drive's loop while we excite the process ourselves
+    arbiter.beginFrame(BusSource::CONTROL);
+    status = transport.writeSingleRegister(config.slaveId, REG_PID_FEEDBACK_SEL, 0);
+    arbiter.endFrame(status == MODBUS_OK);
+    if (status != MODBUS_OK) {
+        finish(TuneState::FAILED, "Could not disable the drive PID");
+        return;
+    }
+
+    bool tuned = experiment();
+
+    // Leave the drive at the bias point
+    writeFrequency(config.bias);
+
+    // One batched write restores the feedback selection (params[0] as
+    // read) and, when tuned, sets all three gains
+    bool apply = tuned && config.apply;
+    if (apply) {
+        AutotuneResult computed = getResult();
+        params[1] = (uint16_t)(computed.kp * 10 + 0.5);     // XXX.X
+        params[2] = (uint16_t)(computed.ti * 100 + 0.5);    // XX.XX s
+        params[3] = (uint16_t)(computed.td * 100 + 0.5);    // X.XX s
+    }
+
+    arbiter.beginFrame(BusSource::CONTROL);
+    status = transport.writeMultipleRegisters(config.slaveId, REG_PID_FEEDBACK_SEL, params, 4);
+    arbiter.endFrame(status == MODBUS_OK);
+    if (status != MODBUS_OK) {
+        finish(TuneState::FAILED, "Could not write P08.00-P08.03 - check the drive PID setup");
+        return;
+    }
+
+    if (!tuned) {
+        finish(TuneState::FAILED, message);
+        return;
+    }
+
+    portENTER_CRITICAL(&lock);
+    result.applied = apply;
+    portEXIT_CRITICAL(&lock);
+    finish(TuneState::DONE, apply ? "Gains written to P08.01-P08.03" : "Dry run - gains not written");
+}
+
+bool PIDAutotuner::experiment() {
+    BusArbiter& arbiter = transport.getArbiter();
+
+    bool high = true;
+    if (!writeFrequency(config.bias + config.amplitude)) {
+        message = "Could not write the frequency command";
+        return false;
+    }
+
+    unsigned long startMs = millis();
+    uint32_t lastSample = 0;
+    uint32_t lastGood = micros();
+    uint64_t intervalSum = 0;
+    uint32_t samples = 0, maxInterval = 0;
+
+    uint32_t lastDownSwitch = 0;
+    bool settled = false;       // First full cycle is dropped
+    float peakMax = -1e9, peakMin = 1e9;
+    float periodSum = 0, amplitudeSum = 0;
+    uint8_t cycles = 0;
+
+    while (cycles < AUTOTUNE_CYCLES) {
+        if (abortRequested) {
+            message = "Aborted";
+            return false;
+        }
+        if (millis() - startMs > AUTOTUNE_TIMEOUT_MS) {
+            message = "No sustained oscillation before timeout";
+            return false;
+        }
+
+        // Back to back block reads - the bus sets the sample rate
+        uint16_t raw = 0;
+        arbiter.beginFrame(BusSource::CONTROL);
+        uint8_t status = transport.readRegisters(config.slaveId, config.pvRegister, 1, &raw);
+        arbiter.endFrame(status == MODBUS_OK);
+        uint32_t now = micros();
+
+        if (status != MODBUS_OK) {
+            if (now - lastGood > (uint32_t)AUTOTUNE_MAX_SAMPLES_GAP * 1000) {
+                message = "Feedback read failed";
+                return false;
+            }
+            vTaskDelay(1);
+            continue;
+        }
+        lastGood = now;
+
+        if (lastSample) {
+            uint32_t interval = now - lastSample;
+            intervalSum += interval;
+            if (interval > maxInterval) maxInterval = interval;
+        }
+        lastSample = now;
+        samples++;
+
+        float pv = (int16_t)raw * config.pvScale;
+        if (pv > peakMax) peakMax = pv;
+        if (pv < peakMin) peakMin = pv;
+
+        if (high && pv > config.setpoint + config.hysteresis) {
+            high = false;
+            writeFrequency(config.bias - config.amplitude);
+
+            // A cycle runs from one downward switch to the next
+            if (lastDownSwitch) {
+                if (settled) {
+                    periodSum += (now - lastDownSwitch) / 1000000.0;
+                    amplitudeSum += (peakMax - peakMin) / 2;
+                    cycles++;
+                }
+                settled = true;
+            }
+            lastDownSwitch = now;
+            peakMax = pv;
+            peakMin = pv;
+        } else if (!high && pv < config.setpoint - config.hysteresis) {
+            high = true;
+            writeFrequency(config.bias + config.amplitude);
+        }
+
+        portENTER_CRITICAL(&lock);
+        result.samples = samples;
+        result.cycles = cycles;
+        result.meanSampleUs = samples > 1 ? intervalSum / (samples - 1) : 0;
+        result.maxSampleUs = maxInterval;
+        portEXIT_CRITICAL(&lock);
+
+        // Let loop() on this core run between frames
+        vTaskDelay(1);
+    }
+
+    computeGains(periodSum, amplitudeSum, cycles);
+    return true;
+}
+
+void PIDAutotuner::computeGains(float periodSum, float amplitudeSum, uint8_t cycles) {
+    float tu = periodSum / cycles;
+    float a = amplitudeSum / cycles;
+
+    // Describing function of an ideal relay: Ku = 4d / (pi a), with the
+    // relay step d in % of the drive's frequency range like the feedback
+    float d = config.amplitude * 100.0 / config.maxFrequency;
+    float ku = a > 0 ? 4 * d / (PI * a) : 0;
+
+    float kp, ti, td;
+    switch (config.rule) {
+        case TuneRule::ZIEGLER_NICHOLS_PI:
+            kp = 0.45 * ku;
+            ti = tu / 1.2;
+            td = 0;
+            break;
+        case TuneRule::TYREUS_LUYBEN:
+            kp = ku / 2.2;
+            ti = 2.2 * tu;
+            td = tu / 6.3;
+            break;
+        case TuneRule::ZIEGLER_NICHOLS_PID:
+        default:
+            kp = 0.6 * ku;
+            ti = tu / 2;
+            td = tu / 8;
+            break;
+    }
+
+    // Parameter ranges of P08.01-P08.03
+    portENTER_CRITICAL(&lock);
+    result.ultimateGain = ku;
+    result.ultimatePeriod = tu;
+    result.amplitude = a;
+    result.kp = constrain(kp, 0.0f, 1000.0f);
+    result.ti = constrain(ti, 0.0f, 100.0f);
+    result.td = constrain(td, 0.0f, 1.0f);
+    portEXIT_CRITICAL(&lock);
+
+    DEBUG_PRINTF("PIDAutotuner: Ku=%.3f Tu=%.2f s a=%.2f %% -> Kp=%.1f Ti=%.2f Td=%.2f\n",
+                 ku, tu, a, result.kp, result.ti, result.td);
+}
+
+bool PIDAutotuner::writeFrequency(float frequency) {
+    frequency = constrain(frequency, 0.0f, config.maxFrequency);
+    uint16_t value = (uint16_t)(frequency * 100 + 0.5);
+
+    BusArbiter& arbiter = transport.getArbiter();
+    arbiter.beginFrame(BusSource::CONTROL);
+    uint8_t status = transport.writeSingleRegister(config.slaveId, REG_FREQUENCY_WRITE, value);
+    arbiter.endFrame(status == MODBUS_OK);
+    return status == MODBUS_OK;
+}
+
+void PIDAutotuner::finish(TuneState finalState, const char* text) {
+    message = text;
+    state = finalState;
+    DEBUG_PRINTF("PIDAutotuner: %s\n", text);
+}
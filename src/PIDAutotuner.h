@@ -0,0 +1,89 @@
+// PIDAutotuner.h
+// Relay-method autotune for the drive's internal PID (P08.01-P08.03)
+
+#ifndef PID_AUTOTUNER_H
+#define PID_AUTOTUNER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "Config.h"
+#include "ModbusTransport.h"
+
+enum class TuneRule : uint8_t {
+    ZIEGLER_NICHOLS_PID = 0,
+    ZIEGLER_NICHOLS_PI,
+    TYREUS_LUYBEN           // Less overshoot, better for pumps and fans
+};
+
+enum class TuneState : uint8_t {
+    IDLE = 0,
+    RUNNING,
+    DONE,
+    FAILED
+};
+
+// Experiment: the frequency command toggles between bias +/- amplitude
+// whenever the feedback crosses setpoint +/- hysteresis
+struct AutotuneConfig {
+    uint8_t slaveId;
+    uint16_t pvRegister;    // Feedback as the drive's PID sees it
+    float pvScale;          // Raw to % of feedback range
+    float setpoint;         // %
+    float hysteresis;       // %
+    float bias;             // Hz
+    float amplitude;        // Hz
+    float maxFrequency;     // Hz, for converting to the drive's % units
+    TuneRule rule;
+    bool apply;             // Write the gains back (false = dry run)
+};
+
+struct AutotuneResult {
+    float ultimateGain;     // Ku, % output per % feedback
+    float ultimatePeriod;   // Tu, seconds
+    float amplitude;        // Feedback oscillation amplitude, %
+    float kp;               // As written to P08.01-P08.03
+    float ti;
+    float td;
+    uint8_t cycles;
+    uint32_t samples;
+    uint32_t meanSampleUs;  // Achieved block-read interval
+    uint32_t maxSampleUs;
+    bool applied;
+};
+
+class PIDAutotuner {
+public:
+    PIDAutotuner(ModbusTransport& transport);
+    ~PIDAutotuner();
+
+    // Runs the experiment on its own task; returns false if one is running
+    bool start(const AutotuneConfig& config);
+    void abort() { abortRequested = true; }
+
+    TuneState getState() const { return state; }
+    const char* getMessage() const { return message; }
+    AutotuneResult getResult();
+
+    static const char* stateName(TuneState state);
+
+private:
+    ModbusTransport& transport;
+    TaskHandle_t task;
+    volatile TuneState state;
+    volatile bool abortRequested;
+    const char* volatile message;
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    AutotuneConfig config;
+    AutotuneResult result;
+
+    static void taskEntry(void* param);
+    void run();
+    bool experiment();
+    void computeGains(float periodSum, float amplitudeSum, uint8_t cycles);
+    bool writeFrequency(float frequency);
+    void finish(TuneState finalState, const char* text);
+};
+
+#endif // PID_AUTOTUNER_H
@@ -0,0 +1,284 @@
+// PIDLoop.cpp
+// Fixed-rate process PID: PV from drive AI or local ADC, output = speed setpoint
+
+#include "PIDLoop.h"
+
+PIDLoop::PIDLoop(ModbusVFD& vfd, PollScheduler& scheduler) :
+    vfd(vfd),
+    scheduler(scheduler),
+    task(nullptr),
+    engaged(false),
+    restart(true),
+    configChanged(false),
+    pollId(-1),
+    integral(0.0),
+    lastPv(0.0),
+    lastError(0.0),
+    output(0.0),
+    lastTickMicros(0)
+{
+    config.kp = 1.0;
+    config.ki = 0.1;
+    config.kd = 0.0;
+    config.setpoint = 0.0;
+    config.reverseActing = false;
+    config.periodMs = PID_PERIOD_MS;
+    config.source = PVSource::DRIVE;
+    config.slaveId = MODBUS_SLAVE_ID;
+    config.pvRegister = REG_AI1_READ;
+    config.adcPin = PID_ADC_PIN;
+    config.pvScale = 0.1;       // AI register is XXX.X %
+    config.pvOffset = 0.0;
+    config.outMin = 0.0;
+    config.outMax = 60.0;
+
+    active = config;
+    memset(&stats, 0, sizeof(stats));
+}
+
+PIDLoop::~PIDLoop() {
+    if (task) {
+        vTaskDelete(task);
+    }
+}
+
+bool PIDLoop::begin() {
+    if (task) return true;
+
+    active = getConfig();
+
+    BaseType_t created = xTaskCreatePinnedToCore(
+        taskEntry,
+        "PIDLoop",
+        VFD_CONTROL_TASK_STACK,
+        this,
+        VFD_CONTROL_TASK_PRIORITY,
+        &task,
+        VFD_CONTROL_TASK_CORE
+    );
+    if (created != pdPASS) {
+        task = nullptr;
+        DEBUG_PRINTLN("PIDLoop: Failed to create task");
+        return false;
+    }
+
+    DEBUG_PRINTLN("PIDLoop: Initialized");
+    DEBUG_PRINTF("  PV: %s, Period: %d ms\n",
+                 active.source == PVSource::DRIVE ? "drive register" : "local ADC", active.periodMs);
+    return true;
+}
+
+void PIDLoop::engage() {
+    if (engaged) return;
+
+    restart = true;
+    lastTickMicros = 0;
+    engaged = true;
+    DEBUG_PRINTLN("PIDLoop: Engaged");
+}
+
+void PIDLoop::disengage() {
+    if (!engaged) return;
+
+    // The drive holds the last setpoint written
+    engaged = false;
+    DEBUG_PRINTLN("PIDLoop: Disengaged");
+}
+
+void PIDLoop::setConfig(const PIDConfig& newConfig) {
+    portENTER_CRITICAL(&lock);
+    config = newConfig;
+    if (config.periodMs < 10) config.periodMs = 10;
+    configChanged = true;
+    portEXIT_CRITICAL(&lock);
+}
+
+PIDConfig PIDLoop::getConfig() {
+    portENTER_CRITICAL(&lock);
+    PIDConfig copy = config;
+    portEXIT_CRITICAL(&lock);
+    return copy;
+}
+
+PIDStats PIDLoop::getStats() {
+    portENTER_CRITICAL(&lock);
+    PIDStats copy = stats;
+    portEXIT_CRITICAL(&lock);
+    return copy;
+}
+
+void PIDLoop::resetStats() {
+    portENTER_CRITICAL(&lock);
+    memset(&stats, 0, sizeof(stats));
+    portEXIT_CRITICAL(&lock);
+    vfd.resetFrequencyLatency();
+}
+
+void PIDLoop::taskEntry(void* param) {
+    static_cast<PIDLoop*>(param)->run();
+}
+
+void PIDLoop::run() {
+    TickType_t lastWake = xTaskGetTickCount();
+
+    while (true) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(active.periodMs));
+
+        if (configChanged) {
+            portENTER_CRITICAL(&lock);
+            PIDConfig next = config;
+            configChanged = false;
+            portEXIT_CRITICAL(&lock);
+            applyConfig(next);
+        }
+
+        // The PV poll only takes bus time while the loop is engaged
+        bool wantPoll = engaged && active.source == PVSource::DRIVE;
+        if (wantPoll != (pollId >= 0)) {
+            updatePolling(active);
+            if (wantPoll) continue;  // No sample yet - start on the next tick
+        }
+
+        if (!engaged) {
+            lastTickMicros = 0;
+            continue;
+        }
+        tick();
+    }
+}
+
+void PIDLoop::applyConfig(const PIDConfig& next) {
+    // Bumpless retune: the integral absorbs the change in the P term so
+    // the output is continuous (ki already sits inside the integral)
+    integral += (active.kp - next.kp) * lastError;
+
+    if (next.source != active.source || next.slaveId != active.slaveId ||
+        next.pvRegister != active.pvRegister || next.periodMs != active.periodMs) {
+        updatePolling(next);
+        restart = true;  // PV may jump - don't differentiate across it
+    }
+
+    active = next;
+}
+
+void PIDLoop::updatePolling(const PIDConfig& next) {
+    if (pollId >= 0) {
+        scheduler.remove(pollId);
+        pollId = -1;
+    }
+    if (engaged && next.source == PVSource::DRIVE) {
+        pollId = scheduler.add(next.slaveId, next.pvRegister, 1, next.periodMs);
+        if (pollId < 0) {
+            DEBUG_PRINTLN("PIDLoop: Polling scheduler is full");
+        }
+    }
+}
+
+bool PIDLoop::readPV(float& pv, uint32_t& ageUs) {
+    float raw;
+
+    if (active.source == PVSource::ADC) {
+        raw = analogReadMilliVolts(active.adcPin);
+        ageUs = 0;
+    } else {
+        PollSample sample;
+        if (!scheduler.getSample(pollId, sample) || sample.sequence == 0) return false;
+
+        ageUs = micros() - sample.timestamp;
+        raw = (int16_t)sample.values[0];
+
+        // A sample older than two periods means the bus isn't keeping up
+        if (sample.result != MODBUS_OK || ageUs > (uint32_t)active.periodMs * 2000) {
+            return false;
+        }
+    }
+
+    pv = raw * active.pvScale + active.pvOffset;
+    return true;
+}
+
+void PIDLoop::tick() {
+    uint32_t start = micros();
+    uint32_t interval = lastTickMicros ? start - lastTickMicros : 0;
+    lastTickMicros = start;
+    uint32_t periodUs = (uint32_t)active.periodMs * 1000;
+
+    float pv = 0;
+    uint32_t pvAge = 0;
+    bool havePv = readPV(pv, pvAge);
+
+    float error = 0, pTerm = 0, dTerm = 0;
+    bool saturated = false;
+
+    if (havePv) {
+        error = active.setpoint - pv;
+        if (active.reverseActing) error = -error;
+
+        // Bumpless start: make the integral reproduce the drive's setpoint
+        if (restart) {
+            output = constrain(vfd.getTargetFrequency(), active.outMin, active.outMax);
+            integral = output - active.kp * error;
+            lastPv = pv;
+            restart = false;
+        }
+
+        float dt = active.periodMs / 1000.0;
+        pTerm = active.kp * error;
+
+        // Derivative on measurement - no kick on setpoint changes
+        dTerm = -active.kd * (pv - lastPv) / dt;
+        if (active.reverseActing) dTerm = -dTerm;
+
+        // Conditional integration: stop integrating into the limit
+        float candidate = integral + active.ki * error * dt;
+        float unclamped = pTerm + candidate + dTerm;
+        if ((unclamped > active.outMax && error > 0) || (unclamped < active.outMin && error < 0)) {
+            saturated = true;
+        } else {
+            integral = candidate;
+        }
+
+        float next = pTerm + integral + dTerm;
+        if (next > active.outMax) { next = active.outMax; saturated = true; }
+        if (next < active.outMin) { next = active.outMin; saturated = true; }
+        output = next;
+
+        lastPv = pv;
+        lastError = error;
+
+        // Through the command queue; the bus task writes it
+        vfd.requestFrequency(output);
+    }
+
+    uint32_t exec = micros() - start;
+
+    portENTER_CRITICAL(&lock);
+    stats.ticks++;
+    if (exec > periodUs) stats.overruns++;
+    stats.lastExecUs = exec;
+    if (exec > stats.maxExecUs) stats.maxExecUs = exec;
+
+    if (interval) {
+        if (stats.minPeriodUs == 0 || interval < stats.minPeriodUs) stats.minPeriodUs = interval;
+        if (interval > stats.maxPeriodUs) stats.maxPeriodUs = interval;
+        uint32_t jitter = interval > periodUs ? interval - periodUs : periodUs - interval;
+        if (jitter > stats.maxJitterUs) stats.maxJitterUs = jitter;
+    }
+
+    if (havePv) {
+        stats.pv = pv;
+        stats.error = error;
+        stats.output = output;
+        stats.pTerm = pTerm;
+        stats.iTerm = integral;
+        stats.dTerm = dTerm;
+        stats.saturated = saturated;
+        stats.pvAgeUs = pvAge;
+        if (pvAge > stats.maxPvAgeUs) stats.maxPvAgeUs = pvAge;
+    } else {
+        stats.pvErrors++;
+    }
+    stats.writeLatencyUs = vfd.getFrequencyLatency();
+    stats.maxWriteLatencyUs = vfd.getMaxFrequencyLatency();
+    portEXIT_CRITICAL(&lock);
+}
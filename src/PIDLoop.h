@@ -0,0 +1,113 @@
+// PIDLoop.h
+// Fixed-rate process PID: PV from drive AI or local ADC, output = speed setpoint
+
+#ifndef PID_LOOP_H
+#define PID_LOOP_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "Config.h"
+#include "ModbusVFD.h"
+#include "PollScheduler.h"
+
+enum class PVSource : uint8_t {
+    DRIVE = 0,      // Drive register via the polling scheduler
+    ADC             // Local ADC channel (millivolts)
+};
+
+// PV = raw x pvScale + pvOffset, in process units
+struct PIDConfig {
+    float kp;
+    float ki;               // 1/s
+    float kd;               // s
+    float setpoint;         // Process units
+    bool reverseActing;     // Output rises when PV is above setpoint
+    uint16_t periodMs;
+
+    PVSource source;
+    uint8_t slaveId;        // DRIVE: which drive and register
+    uint16_t pvRegister;
+    uint8_t adcPin;         // ADC: GPIO
+    float pvScale;
+    float pvOffset;
+
+    float outMin;           // Hz
+    float outMax;
+};
+
+struct PIDStats {
+    uint32_t ticks;
+    uint32_t overruns;
+    uint32_t pvErrors;          // Ticks skipped for a missing or stale PV
+
+    float pv;
+    float error;
+    float output;               // Hz
+    float pTerm;
+    float iTerm;
+    float dTerm;
+    bool saturated;
+
+    uint32_t minPeriodUs;
+    uint32_t maxPeriodUs;
+    uint32_t maxJitterUs;
+    uint32_t lastExecUs;
+    uint32_t maxExecUs;
+    uint32_t pvAgeUs;           // Age of the sample used in the last tick
+    uint32_t maxPvAgeUs;
+    uint32_t writeLatencyUs;    // Queue to drive, from ModbusVFD
+    uint32_t maxWriteLatencyUs;
+};
+
+class PIDLoop {
+public:
+    PIDLoop(ModbusVFD& vfd, PollScheduler& scheduler);
+    ~PIDLoop();
+
+    // Starts the loop task (idle until engaged)
+    bool begin();
+
+    // Engaging picks up the drive's current setpoint (bumpless). The PV
+    // poll is scheduled on engage and removed on disengage.
+    void engage();
+    void disengage();
+    bool isEngaged() const { return engaged; }
+
+    // Gain changes take effect without a step in the output
+    void setConfig(const PIDConfig& config);
+    PIDConfig getConfig();
+
+    PIDStats getStats();
+    void resetStats();
+
+private:
+    ModbusVFD& vfd;
+    PollScheduler& scheduler;
+    TaskHandle_t task;
+    volatile bool engaged;
+    volatile bool restart;          // Re-initialize from the drive on the next tick
+    volatile bool configChanged;
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    PIDConfig config;
+    PIDStats stats;
+    int pollId;                     // Scheduler entry while engaged, -1 otherwise
+
+    // Task-local controller state
+    PIDConfig active;
+    float integral;
+    float lastPv;
+    float lastError;
+    float output;
+    uint32_t lastTickMicros;
+
+    static void taskEntry(void* param);
+    void run();
+    void tick();
+    void applyConfig(const PIDConfig& next);
+    bool readPV(float& pv, uint32_t& ageUs);
+    void updatePolling(const PIDConfig& next);
+};
+
+#endif // PID_LOOP_H
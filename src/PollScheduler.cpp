@@ -0,0 +1,164 @@
+// PollScheduler.cpp
+// Periodic block reads on a bus task; control loops take the latest sample
+
+#include "PollScheduler.h"
+
+PollScheduler::PollScheduler(ModbusVFD& vfd) :
+    vfd(vfd),
+    transport(vfd.getTransport()),
+    task(nullptr),
+    maxLateMs(0)
+{
+    memset(entries, 0, sizeof(entries));
+}
+
+PollScheduler::~PollScheduler() {
+    if (task) {
+        vTaskDelete(task);
+    }
+}
+
+bool PollScheduler::begin() {
+    if (task) return true;
+
+    BaseType_t created = xTaskCreatePinnedToCore(
+        taskEntry,
+        "PollScheduler",
+        VFD_CONTROL_TASK_STACK,
+        this,
+        VFD_CONTROL_TASK_PRIORITY,
+        &task,
+        VFD_CONTROL_TASK_CORE
+    );
+    if (created != pdPASS) {
+        task = nullptr;
+        DEBUG_PRINTLN("PollScheduler: Failed to create task");
+        return false;
+    }
+
+    DEBUG_PRINTLN("PollScheduler: Initialized");
+    return true;
+}
+
+int PollScheduler::add(uint8_t slaveId, uint16_t address, uint16_t count, uint16_t periodMs,
+                       bool inputRegisters) {
+    if (count == 0 || count > POLL_MAX_REGISTERS || periodMs == 0) return -1;
+
+    portENTER_CRITICAL(&lock);
+    int id = -1;
+    for (int i = 0; i < POLL_MAX_ENTRIES; i++) {
+        if (entries[i].used) continue;
+
+        Entry& entry = entries[i];
+        memset(&entry, 0, sizeof(entry));
+        entry.used = true;
+        entry.slaveId = slaveId;
+        entry.address = address;
+        entry.count = count;
+        entry.inputRegisters = inputRegisters;
+        entry.periodMs = periodMs;
+        entry.nextDue = millis();
+        entry.sample.result = MODBUS_ERR_TIMEOUT;  // Nothing read yet
+        id = i;
+        break;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    return id;
+}
+
+void PollScheduler::remove(int id) {
+    if (id < 0 || id >= POLL_MAX_ENTRIES) return;
+
+    portENTER_CRITICAL(&lock);
+    entries[id].used = false;
+    portEXIT_CRITICAL(&lock);
+}
+
+bool PollScheduler::setPeriod(int id, uint16_t periodMs) {
+    if (id < 0 || id >= POLL_MAX_ENTRIES || periodMs == 0) return false;
+
+    portENTER_CRITICAL(&lock);
+    bool used = entries[id].used;
+    if (used) {
+        entries[id].periodMs = periodMs;
+    }
+    portEXIT_CRITICAL(&lock);
+    return used;
+}
+
+bool PollScheduler::getSample(int id, PollSample& sample) {
+    if (id < 0 || id >= POLL_MAX_ENTRIES) return false;
+
+    portENTER_CRITICAL(&lock);
+    bool used = entries[id].used;
+    if (used) {
+        sample = entries[id].sample;
+    }
+    portEXIT_CRITICAL(&lock);
+    return used;
+}
+
+void PollScheduler::taskEntry(void* param) {
+    static_cast<PollScheduler*>(param)->run();
+}
+
+void PollScheduler::run() {
+    while (true) {
+        // Queued setpoints go out first - they don't wait for loop()
+        vfd.serviceCommands();
+
+        // Most overdue entry next
+        unsigned long now = millis();
+        int due = -1;
+        long mostLate = -1;
+        for (int i = 0; i < POLL_MAX_ENTRIES; i++) {
+            if (!entries[i].used) continue;
+            long late = (long)(now - entries[i].nextDue);
+            if (late > mostLate) {
+                mostLate = late;
+                due = i;
+            }
+        }
+
+        if (due < 0) {
+            vTaskDelay(1);
+            continue;
+        }
+
+        if ((uint32_t)mostLate > maxLateMs) maxLateMs = mostLate;
+        poll(due);
+    }
+}
+
+void PollScheduler::poll(int id) {
+    // Copy the request so add/remove can run meanwhile
+    portENTER_CRITICAL(&lock);
+    Entry entry = entries[id];
+    portEXIT_CRITICAL(&lock);
+
+    uint16_t values[POLL_MAX_REGISTERS];
+    BusArbiter& arbiter = transport.getArbiter();
+    arbiter.beginFrame(BusSource::CONTROL);
+    uint8_t result = transport.readRegisters(entry.slaveId, entry.address, entry.count,
+                                             values, entry.inputRegisters);
+    arbiter.endFrame(result == MODBUS_OK);
+    uint32_t timestamp = micros();
+
+    portENTER_CRITICAL(&lock);
+    Entry& live = entries[id];
+    if (live.used && live.address == entry.address && live.slaveId == entry.slaveId) {
+        live.sample.result = result;
+        if (result == MODBUS_OK) {
+            memcpy(live.sample.values, values, entry.count * sizeof(uint16_t));
+            live.sample.timestamp = timestamp;
+            live.sample.sequence++;
+        }
+        // Fixed grid, but never schedule into the past after a stall
+        live.nextDue += live.periodMs;
+        if ((long)(millis() - live.nextDue) > 0) {
+            live.nextDue = millis();
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+}
@@ -0,0 +1,67 @@
+// PollScheduler.h
+// Periodic block reads on a bus task; control loops take the latest sample
+
+#ifndef POLL_SCHEDULER_H
+#define POLL_SCHEDULER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "Config.h"
+#include "ModbusVFD.h"
+
+// Latest result of one scheduled read
+struct PollSample {
+    uint16_t values[POLL_MAX_REGISTERS];
+    uint8_t result;             // MODBUS_OK or error of the last read
+    uint32_t timestamp;         // micros() when the response arrived
+    uint32_t sequence;          // Increments on every successful read
+};
+
+class PollScheduler {
+public:
+    PollScheduler(ModbusVFD& vfd);
+    ~PollScheduler();
+
+    // Starts the bus task
+    bool begin();
+
+    // Schedule a block read every periodMs. Returns the entry id, -1 if
+    // the table is full or the block is too long.
+    int add(uint8_t slaveId, uint16_t address, uint16_t count, uint16_t periodMs,
+            bool inputRegisters = false);
+    void remove(int id);
+    bool setPeriod(int id, uint16_t periodMs);
+
+    // Latest sample of an entry (false for an unused id)
+    bool getSample(int id, PollSample& sample);
+
+    // Reads that finished after their due time (ms), worst case
+    uint32_t getMaxLateMs() const { return maxLateMs; }
+
+private:
+    struct Entry {
+        bool used;
+        uint8_t slaveId;
+        uint16_t address;
+        uint16_t count;
+        bool inputRegisters;
+        uint16_t periodMs;
+        unsigned long nextDue;
+        PollSample sample;
+    };
+
+    ModbusVFD& vfd;
+    ModbusTransport& transport;
+    TaskHandle_t task;
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    Entry entries[POLL_MAX_ENTRIES];
+    volatile uint32_t maxLateMs;
+
+    static void taskEntry(void* param);
+    void run();
+    void poll(int id);
+};
+
+#endif // POLL_SCHEDULER_H
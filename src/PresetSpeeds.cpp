@@ -0,0 +1,138 @@
+// PresetSpeeds.cpp
+// Multi-step speed table (P04.00-P04.14) upload, verify and step selection
+
+#include "PresetSpeeds.h"
+
+PresetSpeeds::PresetSpeeds(ModbusTransport& transport) :
+    transport(transport)
+{
+}
+
+uint8_t PresetSpeeds::readTable(uint8_t slaveId, uint16_t* values) {
+    // Split at the drive's per-request limit, all blocks in one batch so
+    // a pipelining transport can keep them in flight together
+    ModbusReadRequest requests[(PRESET_STEPS + MODBUS_MAX_BLOCK_REGISTERS - 1) / MODBUS_MAX_BLOCK_REGISTERS];
+    size_t count = 0;
+    for (uint16_t offset = 0; offset < PRESET_STEPS; offset += MODBUS_MAX_BLOCK_REGISTERS) {
+        ModbusReadRequest& request = requests[count++];
+        request.address = REG_MULTI_STEP_SPEED + offset;
+        request.count = min(PRESET_STEPS - offset, MODBUS_MAX_BLOCK_REGISTERS);
+        request.dest = values + offset;
+        request.inputRegisters = false;
+        request.result = MODBUS_OK;
+    }
+
+    BusArbiter& arbiter = transport.getArbiter();
+    arbiter.frameBoundary();
+    arbiter.beginFrame(BusSource::COMMAND);
+    transport.readBatch(slaveId, requests, count);
+
+    uint8_t status = MODBUS_OK;
+    for (size_t i = 0; i < count && status == MODBUS_OK; i++) {
+        status = requests[i].result;
+    }
+    arbiter.endFrame(status == MODBUS_OK);
+    return status;
+}
+
+bool PresetSpeeds::upload(uint8_t slaveId, const uint16_t* values, PresetResult& result) {
+    memset(&result, 0, sizeof(result));
+    result.slaveId = slaveId;
+
+    uint16_t current[PRESET_STEPS];
+    result.error = readTable(slaveId, current);
+    result.blockReads = (PRESET_STEPS + MODBUS_MAX_BLOCK_REGISTERS - 1) / MODBUS_MAX_BLOCK_REGISTERS;
+    if (result.error != MODBUS_OK) return false;
+
+    uint16_t target[PRESET_STEPS];
+    for (uint8_t i = 0; i < PRESET_STEPS; i++) {
+        target[i] = values[i] == PRESET_KEEP ? current[i] : values[i];
+    }
+
+    // Greedy ranges: extend over unchanged entries while the gap is short
+    // and the block stays within the drive's register limit
+    BusArbiter& arbiter = transport.getArbiter();
+    uint8_t i = 0;
+    while (i < PRESET_STEPS) {
+        if (target[i] == current[i]) {
+            i++;
+            continue;
+        }
+
+        uint8_t start = i;
+        uint8_t end = i;    // Last changed entry in this block
+        for (uint8_t j = i + 1; j < PRESET_STEPS && j - start < MODBUS_MAX_BLOCK_REGISTERS; j++) {
+            if (target[j] == current[j]) continue;
+            if (j - end - 1 > PRESET_MERGE_GAP) break;
+            end = j;
+        }
+
+        uint8_t count = end - start + 1;
+        arbiter.beginFrame(BusSource::COMMAND);
+        uint8_t status = transport.writeMultipleRegisters(slaveId, REG_MULTI_STEP_SPEED + start,
+                                                          target + start, count);
+        arbiter.endFrame(status == MODBUS_OK);
+
+        result.blockWrites++;
+        result.registersWritten += count;
+        if (status != MODBUS_OK) {
+            result.error = status;
+            DEBUG_PRINTF("PresetSpeeds: Write of P04.%02d-P04.%02d to drive %d failed (0x%02X)\n",
+                         start, end, slaveId, status);
+            return false;
+        }
+        i = end + 1;
+    }
+
+    // Nothing written - the first read already shows the table in place
+    if (result.blockWrites == 0) {
+        result.verified = true;
+        return true;
+    }
+
+    result.error = readTable(slaveId, current);
+    result.blockReads *= 2;
+    if (result.error != MODBUS_OK) return false;
+
+    result.verified = memcmp(current, target, sizeof(target)) == 0;
+
+    DEBUG_PRINTF("PresetSpeeds: Drive %d table %s (%d block writes, %d registers)\n",
+                 slaveId, result.verified ? "verified" : "MISMATCH",
+                 result.blockWrites, result.registersWritten);
+    return result.verified;
+}
+
+bool PresetSpeeds::selectStep(const uint8_t* slaveIds, size_t count, uint8_t step) {
+    if (count == 0 || step > PRESET_STEPS) return false;
+
+    bool ok = true;
+    for (size_t i = 0; i < count; i++) {
+        if (!writeStep(slaveIds[i], step)) ok = false;
+    }
+    return ok;
+}
+
+bool PresetSpeeds::selectStepAll(uint8_t step) {
+    if (step > PRESET_STEPS) return false;
+    return writeStep(MODBUS_BROADCAST_ID, step);
+}
+
+bool PresetSpeeds::writeStep(uint8_t slaveId, uint8_t step) {
+    BusArbiter& arbiter = transport.getArbiter();
+    arbiter.frameBoundary();
+    arbiter.beginFrame(BusSource::COMMAND);
+    uint8_t status = transport.writeSingleRegister(slaveId, REG_CONTROL_WRITE, stepCommand(step));
+    arbiter.endFrame(status == MODBUS_OK);
+
+    if (status != MODBUS_OK) {
+        DEBUG_PRINTF("PresetSpeeds: Step select on drive %d failed (0x%02X)\n", slaveId, status);
+        return false;
+    }
+    return true;
+}
+
+uint16_t PresetSpeeds::stepCommand(uint8_t step) {
+    // Run/stop and direction bits stay 00 (no function), so the selection
+    // doesn't disturb whatever the drive is doing
+    return CMD_STEP_ENABLE | ((uint16_t)(step & 0x0F) << CMD_STEP_SHIFT);
+}
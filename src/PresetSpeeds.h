@@ -0,0 +1,50 @@
+// PresetSpeeds.h
+// Multi-step speed table (P04.00-P04.14) upload, verify and step selection
+
+#ifndef PRESET_SPEEDS_H
+#define PRESET_SPEEDS_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "ModbusRTU.h"
+#include "ModbusTransport.h"
+
+#define PRESET_KEEP     0xFFFF  // Table entry left as the drive has it
+
+// Outcome of an upload to one drive
+struct PresetResult {
+    uint8_t slaveId;
+    uint8_t blockReads;         // Including the verification read
+    uint8_t blockWrites;
+    uint8_t registersWritten;   // Changed entries plus merged-over gaps
+    bool verified;              // Read back matches the requested table
+    uint8_t error;              // First Modbus error, MODBUS_OK if none
+};
+
+class PresetSpeeds {
+public:
+    PresetSpeeds(ModbusTransport& transport);
+
+    // Read the whole table in as few block reads as the drive allows
+    uint8_t readTable(uint8_t slaveId, uint16_t* values);
+
+    // Brings the drive's table to `values` (Hz x100, PRESET_KEEP to skip).
+    // Reads first, writes only the ranges that differ - merged where a
+    // short unchanged gap is cheaper than another frame - then verifies.
+    bool upload(uint8_t slaveId, const uint16_t* values, PresetResult& result);
+
+    // Step 1-15 runs the drive at that table entry, 0 back to the master
+    // frequency. One write per listed drive; selectStepAll() sends a
+    // single broadcast that switches every drive on the link.
+    bool selectStep(const uint8_t* slaveIds, size_t count, uint8_t step);
+    bool selectStepAll(uint8_t step);
+
+    static uint16_t stepCommand(uint8_t step);
+
+private:
+    ModbusTransport& transport;
+
+    bool writeStep(uint8_t slaveId, uint8_t step);
+};
+
+#endif // PRESET_SPEEDS_H
@@ -0,0 +1,147 @@
+// RTUBridge.cpp
+// Transparent RTU-over-TCP bridge to the RS485 drive bus
+
+#include "RTUBridge.h"
+
+RTUBridge::RTUBridge(ModbusVFD& vfd) :
+    server(RTU_BRIDGE_PORT),
+    vfd(vfd),
+    running(false),
+    requestLength(0),
+    framePending(false),
+    lastByteTime(0),
+    lastActivity(0),
+    framesForwarded(0),
+    framesDropped(0),
+    timeouts(0)
+{
+}
+
+RTUBridge::~RTUBridge() {
+    stop();
+}
+
+bool RTUBridge::begin(uint16_t port) {
+    server = WiFiServer(port);
+    server.begin();
+    server.setNoDelay(true);
+    running = true;
+
+    // Forward tunneled frames between the poller's own frames
+    vfd.getArbiter().onFrameBoundary([this]() {
+        service();
+    });
+
+    DEBUG_PRINTF("RTUBridge: Listening on port %d\n", port);
+    return true;
+}
+
+void RTUBridge::stop() {
+    if (running) {
+        vfd.getArbiter().onFrameBoundary(nullptr);
+        if (client) {
+            client.stop();
+        }
+        server.stop();
+        running = false;
+        DEBUG_PRINTLN("RTUBridge: Stopped");
+    }
+}
+
+void RTUBridge::handle() {
+    if (!running) return;
+
+    acceptClient();
+    service();
+
+    // Drop clients that went silent without closing
+    if (hasClient() && millis() - lastActivity > RTU_BRIDGE_CLIENT_TIMEOUT) {
+        DEBUG_PRINTLN("RTUBridge: Client idle timeout");
+        client.stop();
+    }
+}
+
+void RTUBridge::service() {
+    if (!hasClient()) return;
+
+    readClient();
+    forwardPending();
+}
+
+void RTUBridge::acceptClient() {
+    WiFiClient newClient = server.available();
+    if (!newClient) return;
+
+    // One configuration session at a time - the newest one wins
+    if (hasClient()) {
+        DEBUG_PRINTLN("RTUBridge: Replacing existing client");
+        client.stop();
+    }
+
+    client = newClient;
+    client.setNoDelay(true);
+    requestLength = 0;
+    framePending = false;
+    lastActivity = millis();
+
+    DEBUG_PRINTF("RTUBridge: Client connected from %s\n",
+                 client.remoteIP().toString().c_str());
+}
+
+void RTUBridge::readClient() {
+    // Keep frames strictly in order: one in flight at a time
+    while (!framePending && client.available()) {
+        requestBuffer[requestLength++] = client.read();
+        lastByteTime = millis();
+        lastActivity = lastByteTime;
+
+        int expected = modbusRequestLength(requestBuffer, requestLength);
+        if ((expected > 0 && requestLength >= (size_t)expected) ||
+            requestLength >= sizeof(requestBuffer)) {
+            completeFrame();
+        }
+    }
+
+    if (framePending || requestLength == 0) return;
+
+    // Unknown function codes end on an idle gap; known ones that stall are dropped
+    unsigned long idle = millis() - lastByteTime;
+    int expected = modbusRequestLength(requestBuffer, requestLength);
+    if (expected < 0 && idle >= RTU_BRIDGE_IDLE_MS) {
+        completeFrame();
+    } else if (idle >= RTU_RAW_TIMEOUT) {
+        DEBUG_PRINTF("RTUBridge: Dropping stalled partial frame (%d bytes)\n", requestLength);
+        framesDropped++;
+        requestLength = 0;
+    }
+}
+
+void RTUBridge::completeFrame() {
+    if (!modbusCheckCRC(requestBuffer, requestLength)) {
+        DEBUG_PRINTF("RTUBridge: Bad CRC, dropping %d byte frame\n", requestLength);
+        framesDropped++;
+        requestLength = 0;
+        return;
+    }
+
+    framePending = true;
+}
+
+void RTUBridge::forwardPending() {
+    if (!framePending) return;
+
+    size_t responseLength = vfd.transactRaw(requestBuffer, requestLength,
+                                            responseBuffer, sizeof(responseBuffer),
+                                            BusSource::BRIDGE);
+    framesForwarded++;
+
+    if (responseLength > 0) {
+        client.write(responseBuffer, responseLength);
+    } else if (requestBuffer[0] != MODBUS_BROADCAST_ID) {
+        // Let the master's own timeout handle it, as on a real bus
+        timeouts++;
+    }
+
+    requestLength = 0;
+    framePending = false;
+}
@@ -0,0 +1,61 @@
+// RTUBridge.h
+// Transparent RTU-over-TCP bridge to the RS485 drive bus
+
+#ifndef RTU_BRIDGE_H
+#define RTU_BRIDGE_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "Config.h"
+#include "ModbusRTU.h"
+#include "ModbusVFD.h"
+
+// Tunnels raw RTU frames (with CRC) from one TCP client to the RS485 bus.
+// Frames are slipped in between the poller's own frames via the bus
+// arbiter, so status monitoring keeps running while a laptop is attached.
+class RTUBridge {
+public:
+    RTUBridge(ModbusVFD& vfd);
+    ~RTUBridge();
+
+    bool begin(uint16_t port = RTU_BRIDGE_PORT);
+    void stop();
+
+    // Accept clients and forward frames (call from loop)
+    void handle();
+
+    bool isRunning() const { return running; }
+    bool hasClient() { return client && client.connected(); }
+
+    // Counters
+    uint32_t getFramesForwarded() const { return framesForwarded; }
+    uint32_t getFramesDropped() const { return framesDropped; }
+    uint32_t getTimeouts() const { return timeouts; }
+
+private:
+    WiFiServer server;
+    WiFiClient client;
+    ModbusVFD& vfd;
+    bool running;
+
+    uint8_t requestBuffer[MODBUS_RTU_MAX_FRAME];
+    uint8_t responseBuffer[MODBUS_RTU_MAX_FRAME];
+    size_t requestLength;
+    bool framePending;
+    unsigned long lastByteTime;
+    unsigned long lastActivity;
+
+    uint32_t framesForwarded;
+    uint32_t framesDropped;
+    uint32_t timeouts;
+
+    void acceptClient();
+    void readClient();
+    void completeFrame();
+    void forwardPending();
+
+    // Called at every bus frame boundary
+    void service();
+};
+
+#endif // RTU_BRIDGE_H
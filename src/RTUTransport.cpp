@@ -0,0 +1,183 @@
+// RTUTransport.cpp
+// Modbus RTU over the RS485 port (ModbusMaster based)
+
+#include "RTUTransport.h"
+#include "ModbusRTU.h"
+
+// Static member initialization
+RTUTransport* RTUTransport::instance = nullptr;
+
+RTUTransport::RTUTransport() :
+    started(false)
+{
+    instance = this;
+}
+
+RTUTransport::~RTUTransport() {
+    instance = nullptr;
+}
+
+bool RTUTransport::begin() {
+    if (started) return true;
+
+    // Initialize RS485 serial port
+    RS485_SERIAL.begin(RS485_BAUD_RATE, RS485_CONFIG, RS485_RX_PIN, RS485_TX_PIN);
+
+    // Initialize direction control pin
+    pinMode(RS485_DE_PIN, OUTPUT);
+    digitalWrite(RS485_DE_PIN, LOW); // Receive mode by default
+
+    // Initialize Modbus (slave ID is set per request)
+    modbus.begin(MODBUS_SLAVE_ID, RS485_SERIAL);
+
+    // Set callbacks for RS485 direction control
+    modbus.preTransmission(preTransmissionCallback);
+    modbus.postTransmission(postTransmissionCallback);
+
+    // Start bus accounting from a clean window
+    arbiter.resetStats();
+    started = true;
+
+    DEBUG_PRINTLN("RTUTransport: Initialized");
+    DEBUG_PRINTF("  Baud Rate: %d\n", RS485_BAUD_RATE);
+    DEBUG_PRINTF("  TX Pin: %d, RX Pin: %d, DE Pin: %d\n",
+                 RS485_TX_PIN, RS485_RX_PIN, RS485_DE_PIN);
+
+    return true;
+}
+
+uint8_t RTUTransport::readRegisters(uint8_t slaveId, uint16_t address, uint16_t count,
+                                    uint16_t* dest, bool inputRegisters) {
+    modbus.begin(slaveId, RS485_SERIAL);
+
+    uint8_t result = inputRegisters ? modbus.readInputRegisters(address, count)
+                                    : modbus.readHoldingRegisters(address, count);
+
+    if (result == modbus.ku8MBSuccess) {
+        for (uint16_t i = 0; i < count; i++) {
+            dest[i] = modbus.getResponseBuffer(i);
+        }
+    }
+    return result;
+}
+
+uint8_t RTUTransport::writeSingleRegister(uint8_t slaveId, uint16_t address, uint16_t value) {
+    if (slaveId == MODBUS_BROADCAST_ID) {
+        uint8_t frame[8] = {
+            MODBUS_BROADCAST_ID, MODBUS_FC_WRITE_SINGLE,
+            (uint8_t)(address >> 8), (uint8_t)(address & 0xFF),
+            (uint8_t)(value >> 8), (uint8_t)(value & 0xFF)
+        };
+        return sendBroadcast(frame, modbusAppendCRC(frame, 6));
+    }
+
+    modbus.begin(slaveId, RS485_SERIAL);
+    return modbus.writeSingleRegister(address, value);
+}
+
+uint8_t RTUTransport::writeMultipleRegisters(uint8_t slaveId, uint16_t address,
+                                             const uint16_t* values, uint16_t count) {
+    // ModbusMaster's transmit buffer holds 64 words
+    if (count == 0 || count > 64) return MODBUS_ERR_TOO_LONG;
+
+    if (slaveId == MODBUS_BROADCAST_ID) {
+        uint8_t frame[MODBUS_RTU_MAX_FRAME];
+        frame[0] = MODBUS_BROADCAST_ID;
+        frame[1] = MODBUS_FC_WRITE_MULTIPLE;
+        frame[2] = address >> 8;
+        frame[3] = address & 0xFF;
+        frame[4] = count >> 8;
+        frame[5] = count & 0xFF;
+        frame[6] = count * 2;
+        for (uint16_t i = 0; i < count; i++) {
+            frame[7 + i * 2] = values[i] >> 8;
+            frame[8 + i * 2] = values[i] & 0xFF;
+        }
+        return sendBroadcast(frame, modbusAppendCRC(frame, 7 + count * 2));
+    }
+
+    modbus.begin(slaveId, RS485_SERIAL);
+    for (uint16_t i = 0; i < count; i++) {
+        modbus.setTransmitBuffer(i, values[i]);
+    }
+    return modbus.writeMultipleRegisters(address, count);
+}
+
+uint8_t RTUTransport::sendBroadcast(const uint8_t* frame, size_t length) {
+    transactRaw(frame, length, nullptr, 0);
+    return MODBUS_OK;
+}
+
+size_t RTUTransport::transactRaw(const uint8_t* request, size_t length,
+                                 uint8_t* response, size_t maxLength) {
+    if (length < 4 || length > MODBUS_RTU_MAX_FRAME) return 0;
+
+    // Drop anything left over from a previous exchange
+    while (RS485_SERIAL.read() != -1) {
+    }
+
+    preTransmission();
+    RS485_SERIAL.write(request, length);
+    RS485_SERIAL.flush();
+    postTransmission();
+
+    // Broadcast requests never get a reply
+    if (request[0] == MODBUS_BROADCAST_ID) {
+        return 0;
+    }
+
+    // The UART driver hands bytes over in bursts, so allow some slack on
+    // top of the 3.5 character gap before declaring the frame finished
+    uint32_t silenceMicros = modbusFrameGapMicros(RS485_BAUD_RATE) + RTU_FRAME_SLACK_US;
+    unsigned long start = millis();
+    uint32_t lastByteMicros = 0;
+    size_t received = 0;
+
+    while (received < maxLength) {
+        if (RS485_SERIAL.available()) {
+            response[received++] = RS485_SERIAL.read();
+            lastByteMicros = micros();
+
+            int expected = modbusResponseLength(response, received);
+            if (expected > 0 && received >= (size_t)expected) break;
+            continue;
+        }
+
+        if (received > 0) {
+            if (micros() - lastByteMicros > silenceMicros) break;
+        } else if (millis() - start > RTU_RAW_TIMEOUT) {
+            break;
+        }
+    }
+
+    return received;
+}
+
+void RTUTransport::preTransmission() {
+    // RTU mode requires >10ms silent interval before transmission
+    delay(15);  // 15ms to be safe
+    digitalWrite(RS485_DE_PIN, HIGH);  // Enable transmit mode
+    delayMicroseconds(100);  // Small delay for direction change
+}
+
+void RTUTransport::postTransmission() {
+    // Wait for last byte to transmit (at 9600 baud, ~1ms per byte)
+    delay(2);
+    digitalWrite(RS485_DE_PIN, LOW);   // Enable receive mode
+    // RTU mode requires >10ms silent interval after transmission
+    delay(15);  // 15ms to be safe
+}
+
+// Static callback implementations
+
+void RTUTransport::preTransmissionCallback() {
+    if (instance) {
+        instance->preTransmission();
+    }
+}
+
+void RTUTransport::postTransmissionCallback() {
+    if (instance) {
+        instance->postTransmission();
+    }
+}
@@ -0,0 +1,48 @@
+// RTUTransport.h
+// Modbus RTU over the RS485 port (ModbusMaster based)
+
+#ifndef RTU_TRANSPORT_H
+#define RTU_TRANSPORT_H
+
+#include <Arduino.h>
+#include <ModbusMaster.h>
+#include "Config.h"
+#include "ModbusTransport.h"
+
+class RTUTransport : public ModbusTransport {
+public:
+    RTUTransport();
+    ~RTUTransport();
+
+    bool begin() override;
+    const char* name() const override { return "rtu"; }
+
+    uint8_t readRegisters(uint8_t slaveId, uint16_t address, uint16_t count,
+                          uint16_t* dest, bool inputRegisters = false) override;
+    uint8_t writeSingleRegister(uint8_t slaveId, uint16_t address, uint16_t value) override;
+    uint8_t writeMultipleRegisters(uint8_t slaveId, uint16_t address,
+                                   const uint16_t* values, uint16_t count) override;
+
+    size_t transactRaw(const uint8_t* request, size_t length,
+                       uint8_t* response, size_t maxLength) override;
+
+private:
+    ModbusMaster modbus;
+    bool started;
+
+    // Broadcast writes go out raw - ModbusMaster would wait for a reply
+    uint8_t sendBroadcast(const uint8_t* frame, size_t length);
+
+    // RS485 direction control and RTU silent intervals
+    void preTransmission();
+    void postTransmission();
+
+    // Static callback functions for ModbusMaster
+    static void preTransmissionCallback();
+    static void postTransmissionCallback();
+
+    // Instance pointer for callbacks
+    static RTUTransport* instance;
+};
+
+#endif // RTU_TRANSPORT_H
@@ -0,0 +1,171 @@
+// RampGenerator.cpp
+// Trapezoidal / S-curve setpoint profiles streamed at a fixed rate
+
+#include "RampGenerator.h"
+
+// Closer than this counts as arrived (register resolution is 0.01 Hz)
+#define RAMP_ARRIVE_HZ  0.005
+
+RampGenerator::RampGenerator(ModbusVFD& vfd) :
+    vfd(vfd),
+    task(nullptr),
+    active(false),
+    restart(false),
+    target(0.0),
+    profile(RampProfile::TRAPEZOID),
+    sCurveTime(RAMP_SCURVE_TIME),
+    setpoint(0.0),
+    rate(0.0),
+    lastTickMicros(0)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+RampGenerator::~RampGenerator() {
+    if (task) {
+        vTaskDelete(task);
+    }
+}
+
+bool RampGenerator::begin() {
+    if (task) return true;
+
+    BaseType_t created = xTaskCreatePinnedToCore(
+        taskEntry,
+        "RampGenerator",
+        VFD_CONTROL_TASK_STACK,
+        this,
+        VFD_CONTROL_TASK_PRIORITY,
+        &task,
+        VFD_CONTROL_TASK_CORE
+    );
+    if (created != pdPASS) {
+        task = nullptr;
+        DEBUG_PRINTLN("RampGenerator: Failed to create task");
+        return false;
+    }
+
+    DEBUG_PRINTLN("RampGenerator: Initialized");
+    DEBUG_PRINTF("  Update period: %d ms\n", RAMP_UPDATE_MS);
+    return true;
+}
+
+void RampGenerator::setTarget(float frequencyHz) {
+    const VFDParams& params = vfd.getParameters();
+    target = constrain(frequencyHz, params.minFrequency, params.maxFrequency);
+
+    // A running ramp bends toward the new target; otherwise start fresh
+    if (!active) {
+        restart = true;
+        active = true;
+    }
+}
+
+void RampGenerator::cancel() {
+    // Leaves the drive at the last streamed setpoint
+    active = false;
+}
+
+RampStats RampGenerator::getStats() {
+    portENTER_CRITICAL(&lock);
+    RampStats copy = stats;
+    portEXIT_CRITICAL(&lock);
+    return copy;
+}
+
+void RampGenerator::taskEntry(void* param) {
+    static_cast<RampGenerator*>(param)->run();
+}
+
+void RampGenerator::run() {
+    TickType_t lastWake = xTaskGetTickCount();
+    const float dt = RAMP_UPDATE_MS / 1000.0;
+
+    while (true) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(RAMP_UPDATE_MS));
+
+        if (!active) {
+            lastTickMicros = 0;
+            continue;
+        }
+        tick(dt);
+    }
+}
+
+void RampGenerator::tick(float dt) {
+    uint32_t now = micros();
+    uint32_t interval = lastTickMicros ? now - lastTickMicros : 0;
+    lastTickMicros = now;
+
+    if (restart) {
+        setpoint = vfd.getTargetFrequency();
+        rate = 0;
+        restart = false;
+    }
+
+    float goal = target;
+    float error = goal - setpoint;
+    float direction = error >= 0 ? 1 : -1;
+
+    // Peak slope for this direction; a zero ramp time means step
+    const VFDParams& params = vfd.getParameters();
+    float rampTime = error >= 0 ? params.rampUpTime : params.rampDownTime;
+    float limit = rampTime > 0 ? params.maxFrequency / rampTime : 0;
+
+    bool arrived = false;
+    if (limit == 0) {
+        arrived = true;
+    } else if (profile == RampProfile::TRAPEZOID) {
+        rate = direction * limit;
+        arrived = fabs(error) <= limit * dt;
+    } else {
+        // Jerk limited: slope changes by at most jerk * dt per tick, and
+        // starts easing off once the remaining distance is what it takes
+        // to bring the slope back to zero (rate^2 / 2 jerk)
+        float jerk = limit / sCurveTime;
+        float step = jerk * dt;
+
+        if (rate * direction < 0) {
+            // Still moving away after a retarget - unwind first
+            rate += direction * min(step, fabsf(rate));
+        } else {
+            float stopDistance = rate * rate / (2 * jerk) + fabs(rate) * dt;
+            if (fabs(error) <= stopDistance) {
+                rate -= direction * min(step, fabsf(rate));
+            } else {
+                rate += direction * step;
+                if (fabs(rate) > limit) rate = direction * limit;
+            }
+            // Slope died out just short of the goal - creep the rest
+            if (rate == 0 && fabs(error) > RAMP_ARRIVE_HZ) {
+                rate = direction * step;
+            }
+        }
+
+        float next = setpoint + rate * dt;
+        arrived = (goal - next) * direction <= RAMP_ARRIVE_HZ;
+        if (!arrived) setpoint = next;
+    }
+
+    if (arrived) {
+        setpoint = goal;
+        rate = 0;
+        active = false;
+    } else if (profile == RampProfile::TRAPEZOID) {
+        setpoint += rate * dt;
+    }
+
+    // Coalesces with anything still queued - only the latest value is written
+    vfd.requestFrequency(setpoint);
+
+    portENTER_CRITICAL(&lock);
+    stats.ticks++;
+    stats.setpoint = setpoint;
+    stats.rate = rate;
+    if (interval) {
+        uint32_t periodUs = RAMP_UPDATE_MS * 1000;
+        uint32_t jitter = interval > periodUs ? interval - periodUs : periodUs - interval;
+        if (jitter > stats.maxJitterUs) stats.maxJitterUs = jitter;
+    }
+    portEXIT_CRITICAL(&lock);
+}
@@ -0,0 +1,71 @@
+// RampGenerator.h
+// Trapezoidal / S-curve setpoint profiles streamed at a fixed rate
+
+#ifndef RAMP_GENERATOR_H
+#define RAMP_GENERATOR_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "Config.h"
+#include "ModbusVFD.h"
+
+enum class RampProfile : uint8_t {
+    TRAPEZOID = 0,  // Constant rate: maxFrequency per rampUp/DownTime
+    SCURVE          // Same peak rate, reached over sCurveTime (jerk limited)
+};
+
+struct RampStats {
+    uint32_t ticks;             // Each one queues a setpoint
+    uint32_t maxJitterUs;
+    float setpoint;             // Last streamed value (Hz)
+    float rate;                 // Current slope (Hz/s)
+};
+
+// Rates come from the drive's VFDParams (rampUpTime/rampDownTime for
+// 0 -> maxFrequency). Set the drive's own accel/decel shorter than the
+// profile, or it will add its own ramp on top.
+class RampGenerator {
+public:
+    RampGenerator(ModbusVFD& vfd);
+    ~RampGenerator();
+
+    bool begin();
+
+    // Starts from wherever the drive's setpoint is now
+    void setTarget(float frequencyHz);
+    float getTarget() const { return target; }
+    void cancel();
+    bool isRamping() const { return active; }
+
+    void setProfile(RampProfile profile) { this->profile = profile; }
+    RampProfile getProfile() const { return profile; }
+    void setSCurveTime(float seconds) { sCurveTime = seconds > 0 ? seconds : 0.01; }
+    float getSCurveTime() const { return sCurveTime; }
+
+    RampStats getStats();
+
+private:
+    ModbusVFD& vfd;
+    TaskHandle_t task;
+
+    volatile bool active;
+    volatile bool restart;
+    volatile float target;
+    volatile RampProfile profile;
+    volatile float sCurveTime;
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    RampStats stats;
+
+    // Task-local profile state
+    float setpoint;
+    float rate;
+    uint32_t lastTickMicros;
+
+    static void taskEntry(void* param);
+    void run();
+    void tick(float dt);
+};
+
+#endif // RAMP_GENERATOR_H
@@ -0,0 +1,391 @@
+// RecipeEngine.cpp
+// Timed multi-step speed programs stored as binary blobs on SPIFFS
+
+#include "RecipeEngine.h"
+#include <SPIFFS.h>
+
+RecipeEngine::RecipeEngine(ModbusVFD& vfd, RampGenerator& ramp) :
+    vfd(vfd),
+    ramp(ramp),
+    task(nullptr),
+    state(RecipeState::IDLE),
+    abortRequested(false),
+    message(""),
+    stepStartTick(0)
+{
+    memset(&program, 0, sizeof(program));
+    memset(&status, 0, sizeof(status));
+}
+
+RecipeEngine::~RecipeEngine() {
+    if (task) {
+        vTaskDelete(task);
+    }
+}
+
+bool RecipeEngine::begin() {
+    if (task) return true;
+
+    // The task sleeps until a program starts, then wakes exactly at each
+    // step deadline - WiFi and web traffic live on the other core
+    BaseType_t created = xTaskCreatePinnedToCore(
+        taskEntry,
+        "RecipeEngine",
+        VFD_CONTROL_TASK_STACK,
+        this,
+        VFD_CONTROL_TASK_PRIORITY,
+        &task,
+        VFD_CONTROL_TASK_CORE
+    );
+    if (created != pdPASS) {
+        task = nullptr;
+        DEBUG_PRINTLN("RecipeEngine: Failed to create task");
+        return false;
+    }
+
+    DEBUG_PRINTLN("RecipeEngine: Initialized");
+    return true;
+}
+
+bool RecipeEngine::start(const char* name) {
+    RecipeProgram loaded;
+    if (!load(name, loaded)) {
+        DEBUG_PRINTF("RecipeEngine: Could not load '%s'\n", name);
+        return false;
+    }
+    return start(name, loaded);
+}
+
+bool RecipeEngine::start(const char* name, const RecipeProgram& newProgram) {
+    if (!task || state == RecipeState::RUNNING) return false;
+    if (!validate(newProgram)) return false;
+
+    portENTER_CRITICAL(&lock);
+    program = newProgram;
+    memset(&status, 0, sizeof(status));
+    strncpy(status.name, name, RECIPE_NAME_LEN - 1);
+    status.stepCount = program.stepCount;
+    portEXIT_CRITICAL(&lock);
+
+    abortRequested = false;
+    message = "Running";
+    state = RecipeState::RUNNING;
+    xTaskNotifyGive(task);
+
+    DEBUG_PRINTF("RecipeEngine: Started '%s' (%d steps)\n", name, newProgram.stepCount);
+    return true;
+}
+
+void RecipeEngine::abort() {
+    if (state != RecipeState::RUNNING) return;
+
+    abortRequested = true;
+    xTaskNotifyGive(task);
+}
+
+RecipeStatus RecipeEngine::getStatus() {
+    portENTER_CRITICAL(&lock);
+    RecipeStatus copy = status;
+    TickType_t since = stepStartTick;
+    portEXIT_CRITICAL(&lock);
+
+    copy.state = state;
+    if (copy.state == RecipeState::RUNNING) {
+        copy.stepElapsedMs = (xTaskGetTickCount() - since) * portTICK_PERIOD_MS;
+    }
+    return copy;
+}
+
+void RecipeEngine::taskEntry(void* param) {
+    static_cast<RecipeEngine*>(param)->run();
+}
+
+void RecipeEngine::run() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (state == RecipeState::RUNNING) {
+            execute();
+        }
+    }
+}
+
+void RecipeEngine::execute() {
+    uint8_t index = 0;
+    TickType_t start = xTaskGetTickCount();
+    uint32_t startMicros = micros();
+
+    while (true) {
+        const RecipeStep& step = program.steps[index];
+
+        portENTER_CRITICAL(&lock);
+        status.step = index;
+        stepStartTick = start;
+        portEXIT_CRITICAL(&lock);
+
+        enterStep(step);
+        StepEnd end = waitStep(step);
+
+        if (end == StepEnd::ABORT) {
+            ramp.cancel();
+            vfd.requestCommand(CMD_STOP);
+            finish(RecipeState::ABORTED, "Aborted - drive stopped");
+            return;
+        }
+        if (end == StepEnd::FAULT) {
+            ramp.cancel();
+            finish(RecipeState::FAILED, "Drive faulted");
+            return;
+        }
+        if (end == StepEnd::TIMEOUT && (step.flags & RECIPE_STEP_ABORT_ON_TIMEOUT)) {
+            ramp.cancel();
+            vfd.requestCommand(CMD_STOP);
+            finish(RecipeState::FAILED, "Step condition timed out - drive stopped");
+            return;
+        }
+
+        // Timed steps chain off the scheduled deadline rather than the
+        // wake-up, so lateness never accumulates over a long program
+        if (end == StepEnd::ELAPSED || end == StepEnd::TIMEOUT) {
+            start += pdMS_TO_TICKS(step.durationMs);
+            startMicros += step.durationMs * 1000;
+            uint32_t late = micros() - startMicros;
+
+            portENTER_CRITICAL(&lock);
+            status.lastLatenessUs = late;
+            if (late > status.maxLatenessUs) status.maxLatenessUs = late;
+            portEXIT_CRITICAL(&lock);
+        } else {
+            start = xTaskGetTickCount();
+            startMicros = micros();
+        }
+
+        portENTER_CRITICAL(&lock);
+        status.transitions++;
+        portEXIT_CRITICAL(&lock);
+
+        if (++index >= program.stepCount) {
+            if (!(program.flags & RECIPE_PROGRAM_LOOP)) {
+                finish(RecipeState::DONE, "Completed");
+                return;
+            }
+            index = 0;
+            portENTER_CRITICAL(&lock);
+            status.loops++;
+            portEXIT_CRITICAL(&lock);
+        }
+    }
+}
+
+void RecipeEngine::enterStep(const RecipeStep& step) {
+    // Both go through the command queue; the setpoint is written before
+    // the run command so a start takes off at the new frequency
+    if (step.frequency != RECIPE_KEEP_FREQUENCY) {
+        float frequency = step.frequency / 100.0;
+        if (step.flags & RECIPE_STEP_RAMP) {
+            ramp.setTarget(frequency);
+        } else {
+            ramp.cancel();
+            vfd.requestFrequency(frequency);
+        }
+    }
+
+    switch ((RecipeDirection)step.direction) {
+        case RecipeDirection::FORWARD:
+            vfd.requestCommand(CMD_RUN_FWD);
+            break;
+        case RecipeDirection::REVERSE:
+            vfd.requestCommand(CMD_RUN_REV);
+            break;
+        case RecipeDirection::STOP:
+            ramp.cancel();
+            vfd.requestCommand(CMD_STOP);
+            break;
+        default:
+            break;
+    }
+}
+
+RecipeEngine::StepEnd RecipeEngine::waitStep(const RecipeStep& step) {
+    bool hasCondition = step.condition != (uint8_t)RecipeCondition::NONE;
+    bool hasDeadline = step.durationMs > 0;
+    TickType_t deadline = stepStartTick + pdMS_TO_TICKS(step.durationMs);
+
+    // A step with neither is just its entry actions. validate() keeps a
+    // loop from being made only of these, so this never spins
+    if (!hasCondition && !hasDeadline) {
+        if (abortRequested) return StepEnd::ABORT;
+        taskYIELD();
+        return StepEnd::ELAPSED;
+    }
+
+    while (true) {
+        if (abortRequested) return StepEnd::ABORT;
+        if (vfd.isFaulted()) return StepEnd::FAULT;
+        if (hasCondition && conditionMet(step)) return StepEnd::CONDITION;
+
+        TickType_t wait = pdMS_TO_TICKS(RECIPE_CONDITION_POLL_MS);
+        if (hasDeadline) {
+            int32_t remaining = (int32_t)(deadline - xTaskGetTickCount());
+            if (remaining <= 0) return hasCondition ? StepEnd::TIMEOUT : StepEnd::ELAPSED;
+            if (!hasCondition || (TickType_t)remaining < wait) wait = remaining;
+        }
+
+        // abort() wakes us early
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+bool RecipeEngine::conditionMet(const RecipeStep& step) {
+    const VFDStatus& vfdStatus = vfd.getStatus();
+    float value;
+
+    switch ((RecipeCondition)step.condition) {
+        case RecipeCondition::FREQUENCY: value = vfdStatus.actualFrequency; break;
+        case RecipeCondition::CURRENT:   value = vfdStatus.outputCurrent; break;
+        case RecipeCondition::VOLTAGE:   value = vfdStatus.outputVoltage; break;
+        case RecipeCondition::RUNNING:   return vfd.isRunning();
+        case RecipeCondition::STOPPED:   return !vfd.isRunning();
+        case RecipeCondition::RAMP_DONE: return !ramp.isRamping();
+        default: return false;
+    }
+
+    float threshold = step.threshold / 10.0;
+    if ((RecipeCompare)step.compare == RecipeCompare::AT_MOST) {
+        return value <= threshold;
+    }
+    return value >= threshold;
+}
+
+void RecipeEngine::finish(RecipeState finalState, const char* text) {
+    message = text;
+    state = finalState;
+    DEBUG_PRINTF("RecipeEngine: %s\n", text);
+}
+
+String RecipeEngine::path(const char* name) {
+    return String(RECIPE_DIR) + "/" + name + ".rcp";
+}
+
+bool RecipeEngine::validName(const char* name) {
+    size_t length = strlen(name);
+    if (length == 0 || length >= RECIPE_NAME_LEN) return false;
+
+    for (size_t i = 0; i < length; i++) {
+        char c = name[i];
+        if (!isalnum(c) && c != '-' && c != '_') return false;
+    }
+    return true;
+}
+
+bool RecipeEngine::validate(const RecipeProgram& program) {
+    if (program.stepCount == 0 || program.stepCount > RECIPE_MAX_STEPS) return false;
+
+    bool waits = false;
+    for (uint8_t i = 0; i < program.stepCount; i++) {
+        const RecipeStep& step = program.steps[i];
+        if (step.direction > (uint8_t)RecipeDirection::STOP) return false;
+        if (step.condition > (uint8_t)RecipeCondition::RAMP_DONE) return false;
+        if (step.compare > (uint8_t)RecipeCompare::AT_MOST) return false;
+        if (step.durationMs > 0 || step.condition != (uint8_t)RecipeCondition::NONE) waits = true;
+    }
+
+    // A loop with nothing to wait on would spin the task at full speed
+    if ((program.flags & RECIPE_PROGRAM_LOOP) && !waits) return false;
+    return true;
+}
+
+bool RecipeEngine::save(const char* name, const RecipeProgram& program) {
+    if (!validName(name) || !validate(program)) return false;
+
+    RecipeFileHeader header;
+    header.magic = RECIPE_MAGIC;
+    header.version = RECIPE_VERSION;
+    header.stepCount = program.stepCount;
+    header.flags = program.flags;
+    header.reserved = 0;
+
+    File file = SPIFFS.open(path(name), FILE_WRITE);
+    if (!file) return false;
+
+    size_t stepBytes = program.stepCount * sizeof(RecipeStep);
+    bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              file.write((const uint8_t*)program.steps, stepBytes) == stepBytes;
+    file.close();
+
+    if (!ok) {
+        SPIFFS.remove(path(name));
+    }
+    return ok;
+}
+
+bool RecipeEngine::load(const char* name, RecipeProgram& program) {
+    if (!validName(name)) return false;
+
+    File file = SPIFFS.open(path(name), FILE_READ);
+    if (!file) return false;
+
+    RecipeFileHeader header;
+    bool ok = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              header.magic == RECIPE_MAGIC && header.version == RECIPE_VERSION &&
+              header.stepCount > 0 && header.stepCount <= RECIPE_MAX_STEPS &&
+              file.size() == sizeof(header) + header.stepCount * sizeof(RecipeStep);
+
+    if (ok) {
+        size_t stepBytes = header.stepCount * sizeof(RecipeStep);
+        program.stepCount = header.stepCount;
+        program.flags = header.flags;
+        ok = file.read((uint8_t*)program.steps, stepBytes) == stepBytes && validate(program);
+    }
+    file.close();
+    return ok;
+}
+
+bool RecipeEngine::remove(const char* name) {
+    if (!validName(name)) return false;
+    return SPIFFS.remove(path(name));
+}
+
+const char* RecipeEngine::stateName(RecipeState state) {
+    switch (state) {
+        case RecipeState::IDLE: return "idle";
+        case RecipeState::RUNNING: return "running";
+        case RecipeState::DONE: return "done";
+        case RecipeState::ABORTED: return "aborted";
+        case RecipeState::FAILED: return "failed";
+        default: return "unknown";
+    }
+}
+
+static const char* const directionNames[] = {"keep", "fwd", "rev", "stop"};
+static const char* const conditionNames[] = {"none", "frequency", "current", "voltage",
+                                             "running", "stopped", "ramp_done"};
+
+const char* RecipeEngine::directionName(RecipeDirection direction) {
+    uint8_t index = (uint8_t)direction;
+    return index <= (uint8_t)RecipeDirection::STOP ? directionNames[index] : "unknown";
+}
+
+const char* RecipeEngine::conditionName(RecipeCondition condition) {
+    uint8_t index = (uint8_t)condition;
+    return index <= (uint8_t)RecipeCondition::RAMP_DONE ? conditionNames[index] : "unknown";
+}
+
+bool RecipeEngine::parseDirection(const char* text, RecipeDirection& direction) {
+    for (uint8_t i = 0; i <= (uint8_t)RecipeDirection::STOP; i++) {
+        if (strcmp(text, directionNames[i]) == 0) {
+            direction = (RecipeDirection)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RecipeEngine::parseCondition(const char* text, RecipeCondition& condition) {
+    for (uint8_t i = 0; i <= (uint8_t)RecipeCondition::RAMP_DONE; i++) {
+        if (strcmp(text, conditionNames[i]) == 0) {
+            condition = (RecipeCondition)i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,156 @@
+// RecipeEngine.h
+// Timed multi-step speed programs stored as binary blobs on SPIFFS
+
+#ifndef RECIPE_ENGINE_H
+#define RECIPE_ENGINE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "Config.h"
+#include "ModbusVFD.h"
+#include "RampGenerator.h"
+
+#define RECIPE_MAGIC            0x31504352  // "RCP1"
+#define RECIPE_VERSION          1
+#define RECIPE_KEEP_FREQUENCY   0xFFFF      // Step leaves the setpoint alone
+
+// Step flags
+#define RECIPE_STEP_RAMP              0x01  // Reach the setpoint via the ramp generator
+#define RECIPE_STEP_ABORT_ON_TIMEOUT  0x02  // Condition timeout aborts instead of advancing
+
+// Program flags
+#define RECIPE_PROGRAM_LOOP           0x01  // Start over after the last step
+
+enum class RecipeDirection : uint8_t {
+    KEEP = 0,
+    FORWARD,
+    REVERSE,
+    STOP
+};
+
+// What ends a step early. With a condition, the duration is a timeout
+// (0 = wait forever); without one the step simply holds for the duration.
+enum class RecipeCondition : uint8_t {
+    NONE = 0,
+    FREQUENCY,      // Output frequency vs threshold (Hz)
+    CURRENT,        // Output current vs threshold (A)
+    VOLTAGE,        // Output voltage vs threshold (V)
+    RUNNING,
+    STOPPED,
+    RAMP_DONE
+};
+
+enum class RecipeCompare : uint8_t {
+    AT_LEAST = 0,
+    AT_MOST
+};
+
+enum class RecipeState : uint8_t {
+    IDLE = 0,
+    RUNNING,
+    DONE,
+    ABORTED,
+    FAILED
+};
+
+// File layout: header, then stepCount steps, little endian as in memory
+struct __attribute__((packed)) RecipeFileHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t stepCount;
+    uint8_t flags;
+    uint8_t reserved;
+};
+
+struct __attribute__((packed)) RecipeStep {
+    uint16_t frequency;     // Hz x100, or RECIPE_KEEP_FREQUENCY
+    uint8_t direction;      // RecipeDirection
+    uint8_t flags;
+    uint32_t durationMs;
+    uint8_t condition;      // RecipeCondition
+    uint8_t compare;        // RecipeCompare
+    int16_t threshold;      // x10
+};
+
+struct RecipeProgram {
+    uint8_t stepCount;
+    uint8_t flags;
+    RecipeStep steps[RECIPE_MAX_STEPS];
+};
+
+struct RecipeStatus {
+    char name[RECIPE_NAME_LEN];
+    RecipeState state;
+    uint8_t step;
+    uint8_t stepCount;
+    uint32_t stepElapsedMs;
+    uint32_t loops;
+    uint32_t transitions;
+    uint32_t lastLatenessUs;    // Timed transition vs its scheduled instant
+    uint32_t maxLatenessUs;
+};
+
+class RecipeEngine {
+public:
+    RecipeEngine(ModbusVFD& vfd, RampGenerator& ramp);
+    ~RecipeEngine();
+
+    bool begin();
+
+    // Returns false if a program is running or the program is invalid
+    bool start(const char* name);
+    bool start(const char* name, const RecipeProgram& program);
+
+    // Ends the program and stops the drive
+    void abort();
+
+    RecipeState getState() const { return state; }
+    const char* getMessage() const { return message; }
+    RecipeStatus getStatus();
+
+    // Program storage (RECIPE_DIR/<name>.rcp)
+    static bool save(const char* name, const RecipeProgram& program);
+    static bool load(const char* name, RecipeProgram& program);
+    static bool remove(const char* name);
+    static bool validName(const char* name);
+    static bool validate(const RecipeProgram& program);
+
+    static const char* stateName(RecipeState state);
+    static const char* directionName(RecipeDirection direction);
+    static const char* conditionName(RecipeCondition condition);
+    static bool parseDirection(const char* text, RecipeDirection& direction);
+    static bool parseCondition(const char* text, RecipeCondition& condition);
+
+private:
+    enum class StepEnd : uint8_t {
+        ELAPSED,
+        CONDITION,
+        TIMEOUT,
+        ABORT,
+        FAULT
+    };
+
+    ModbusVFD& vfd;
+    RampGenerator& ramp;
+    TaskHandle_t task;
+    volatile RecipeState state;
+    volatile bool abortRequested;
+    const char* volatile message;
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    RecipeProgram program;
+    RecipeStatus status;
+    TickType_t stepStartTick;
+
+    static void taskEntry(void* param);
+    void run();
+    void execute();
+    void enterStep(const RecipeStep& step);
+    StepEnd waitStep(const RecipeStep& step);
+    bool conditionMet(const RecipeStep& step);
+    void finish(RecipeState finalState, const char* text);
+    static String path(const char* name);
+};
+
+#endif // RECIPE_ENGINE_H
@@ -4,21 +4,491 @@
 #include "SimpleHTTPServer.h"
 #include "Config.h"
 #include <SPIFFS.h>
+#include <lwip/sockets.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <algorithm>
 
-SimpleHTTPServer::SimpleHTTPServer() : server(80), serverPort(80), running(false) {
+HTTPConnection* SimpleHTTPServer::current = nullptr;
+std::vector<StaticAsset> SimpleHTTPServer::assets;
+AssetBundle* SimpleHTTPServer::assetBundle = nullptr;
+
+// Neither kind of held socket may take every slot on its own; together
+// they are capped at runtime (see heldConnections())
+static_assert(HTTP_MAX_KEEPALIVE < HTTP_MAX_CONNECTIONS, "keep-alive sockets must leave a slot free");
+static_assert(HTTP_MAX_EVENT_STREAMS < HTTP_MAX_CONNECTIONS, "event streams must leave a slot free");
+
+HTTPConnection::HTTPConnection() :
+    state(HTTPConnectionState::FREE),
+    deadline(0),
+    acceptedAt(0),
+    served(0),
+    keepAlive(false),
+    persist(false),
+    streaming(false),
+    eventInterval(0),
+    lastEvent(0),
+    requestLength(0),
+    headLength(0),
+    parsed(0),
+    pattern(nullptr),
+    paramCount(0),
+    bodyPosition(0),
+    largeBody(nullptr),
+    largeReceived(0),
+    responseLength(0),
+    responseSent(0),
+    spill(nullptr),
+    spillLength(0),
+    spillSent(0),
+    spillCapacity(0),
+    spilled(false),
+    cut(false),
+    external(nullptr),
+    externalLength(0),
+    externalSent(0),
+    writes(0)
+{
+    memset(&head, 0, sizeof(head));
+}
+
+HTTPConnection::~HTTPConnection() {
+    heap_caps_free(spill);
+    heap_caps_free(largeBody);
+}
+
+int HTTPConnection::available() {
+    if (headLength == 0 || bodyPosition >= head.contentLength) return 0;
+    return head.contentLength - bodyPosition;
+}
+
+int HTTPConnection::read() {
+    if (available() <= 0) return -1;
+    return (uint8_t)getBody()[bodyPosition++];
+}
+
+int HTTPConnection::read(uint8_t* buffer, size_t size) {
+    size_t count = min(size, (size_t)available());
+    memcpy(buffer, getBody() + bodyPosition, count);
+    bodyPosition += count;
+    return count;
+}
+
+int HTTPConnection::peek() {
+    if (available() <= 0) return -1;
+    return (uint8_t)getBody()[bodyPosition];
+}
+
+bool HTTPConnection::equals(const HTTPSlice& slice, const char* value) const {
+    return strlen(value) == slice.length && strncasecmp(text(slice), value, slice.length) == 0;
+}
+
+bool HTTPConnection::contains(const HTTPSlice& slice, const char* token) const {
+    size_t length = strlen(token);
+    const char* value = text(slice);
+    for (size_t i = 0; i + length <= slice.length; i++) {
+        if (strncasecmp(value + i, token, length) == 0) return true;
+    }
+    return false;
+}
+
+bool HTTPConnection::getParam(const char* name, HTTPSlice& value) const {
+    if (!pattern) return false;
+
+    // Position of {name} among the pattern's parameters
+    size_t nameLength = strlen(name);
+    uint8_t index = 0;
+    for (const char* brace = strchr(pattern, '{'); brace; brace = strchr(brace + 1, '{')) {
+        if (strncmp(brace + 1, name, nameLength) == 0 && brace[nameLength + 1] == '}') {
+            if (index >= paramCount) return false;
+            value = params[index];
+            return true;
+        }
+        index++;
+    }
+    return false;
+}
+
+long HTTPConnection::getParamInt(const char* name, long fallback) const {
+    HTTPSlice value;
+    if (!getParam(name, value) || value.length == 0) return fallback;
+
+    long result = 0;
+    const char* digits = text(value);
+    for (uint16_t i = 0; i < value.length; i++) {
+        if (digits[i] < '0' || digits[i] > '9') return fallback;
+        result = result * 10 + (digits[i] - '0');
+    }
+    return result;
+}
+
+size_t HTTPConnection::write(uint8_t value) {
+    return write(&value, 1);
+}
+
+size_t HTTPConnection::write(const uint8_t* buffer, size_t size) {
+    // An external body goes out last, nothing can follow it
+    if (externalLength > 0 || cut) return 0;
+
+    // The queue only while nothing has spilled, so bytes stay in order
+    size_t count = 0;
+    if (spillLength == 0) {
+        count = min(size, sizeof(response) - responseLength);
+        memcpy(response + responseLength, buffer, count);
+        responseLength += count;
+    }
+    if (count < size && !addSpill(buffer + count, size - count)) {
+        return count;
+    }
+    return size;
+}
+
+uint8_t HTTPConnection::connected() {
+    return !cut && WiFiClient::connected();
+}
+
+void HTTPConnection::attach(const WiFiClient& client) {
+    WiFiClient::operator=(client);
+    state = HTTPConnectionState::READING_HEADERS;
+    acceptedAt = millis();
+    deadline = acceptedAt + HTTP_HEADER_TIMEOUT_MS;
+    served = 0;
+    keepAlive = false;
+    persist = false;
+    streaming = false;
+    requestLength = 0;
+    headLength = 0;
+    parsed = 0;
+    memset(&head, 0, sizeof(head));
+    bodyPosition = 0;
+    freeBody();
+    resetResponse();
+}
+
+void HTTPConnection::release() {
+    resetResponse();
+    freeBody();
+    WiFiClient::stop();
+    WiFiClient::operator=(WiFiClient());
+    state = HTTPConnectionState::FREE;
+}
+
+void HTTPConnection::nextRequest() {
+    // Pipelined bytes already received belong to the next request
+    size_t used = headLength + (largeBody ? 0 : head.contentLength);
+    requestLength -= used;
+    memmove(request, request + used, requestLength);
+    freeBody();
+
+    state = HTTPConnectionState::READING_HEADERS;
+    deadline = millis() + HTTP_KEEPALIVE_TIMEOUT_MS;
+    headLength = 0;
+    parsed = 0;
+    memset(&head, 0, sizeof(head));
+    bodyPosition = 0;
+    resetResponse();
+}
+
+void HTTPConnection::resetResponse() {
+    // The producer first: dropping its state may still write (a stream's end)
+    producer = nullptr;
+    responseLength = 0;
+    responseSent = 0;
+    heap_caps_free(spill);
+    spill = nullptr;
+    spillLength = 0;
+    spillSent = 0;
+    spillCapacity = 0;
+    spilled = false;
+    cut = false;
+    external = nullptr;
+    externalLength = 0;
+    externalSent = 0;
+    writes = 0;
+}
+
+void HTTPConnection::sendExternal(const uint8_t* data, size_t length) {
+    external = data;
+    externalLength = length;
+    externalSent = 0;
+}
+
+bool HTTPConnection::allocateBody() {
+    largeBody = (char*)heap_caps_malloc(head.contentLength, MALLOC_CAP_SPIRAM);
+    if (!largeBody) {
+        largeBody = (char*)heap_caps_malloc(head.contentLength, MALLOC_CAP_8BIT);
+    }
+    if (!largeBody) return false;
+
+    // What already came in behind the head moves over; `request` keeps
+    // the head only
+    largeReceived = requestLength - headLength;
+    memcpy(largeBody, request + headLength, largeReceived);
+    requestLength = headLength;
+    return true;
+}
+
+void HTTPConnection::freeBody() {
+    heap_caps_free(largeBody);
+    largeBody = nullptr;
+    largeReceived = 0;
+}
+
+bool HTTPConnection::bodyComplete() const {
+    if (largeBody) return largeReceived == head.contentLength;
+    return requestLength >= headLength + head.contentLength;
+}
+
+bool HTTPConnection::writeResponse(const uint8_t* head, size_t headLength,
+                                   const uint8_t* body, size_t bodyLength, bool stable) {
+    // Head and a copied body are queued, spilling what the queue can't
+    // take; a stable body is sent from where it is, after them
+    if (write(head, headLength) != headLength) return false;
+    if (stable) {
+        sendExternal(body, bodyLength);
+        return true;
+    }
+    return bodyLength == 0 || write(body, bodyLength) == bodyLength;
+}
+
+bool HTTPConnection::addSpill(const uint8_t* data, size_t length) {
+    size_t needed = spillLength + length;
+    if (needed > spillCapacity) {
+        // Doubling, PSRAM first; a response past the limit is cut and the
+        // connection closed after what was sent, as it can't be completed
+        size_t capacity = spillCapacity > 0 ? spillCapacity : sizeof(response);
+        while (capacity < needed) capacity *= 2;
+        capacity = min(capacity, (size_t)HTTP_SPILL_LIMIT);
+
+        uint8_t* grown = nullptr;
+        if (needed <= capacity) {
+            grown = (uint8_t*)heap_caps_realloc(spill, capacity, MALLOC_CAP_SPIRAM);
+            if (!grown) {
+                grown = (uint8_t*)heap_caps_realloc(spill, capacity, MALLOC_CAP_8BIT);
+            }
+        }
+        if (!grown) {
+            DEBUG_PRINTF("HTTPConnection: Response over %u bytes queued, cut\n", (unsigned)needed);
+            cut = true;
+            persist = false;
+            return false;
+        }
+        spill = grown;
+        spillCapacity = capacity;
+    }
+
+    memcpy(spill + spillLength, data, length);
+    spillLength += length;
+    spilled = true;
+    return true;
+}
+
+void HTTPConnection::push() {
+    // Start on what is queued without waiting for the handler to return
+    while (responseSent < responseLength) {
+        int count = lwip_send(fd(), response + responseSent, responseLength - responseSent, MSG_DONTWAIT);
+        if (count <= 0) break;
+        responseSent += count;
+        writes++;
+    }
+    if (responseSent == responseLength) {
+        responseLength = 0;
+        responseSent = 0;
+    }
+}
+
+HTTPResponse::HTTPResponse(WiFiClient& client, int code) : client(client), length(0) {
+    append("HTTP/1.1 %d %s\r\n", code, SimpleHTTPServer::statusText(code));
+}
+
+HTTPResponse& HTTPResponse::header(const char* name, const char* value) {
+    if (!append("%s: %s\r\n", name, value)) {
+        DEBUG_PRINTF("HTTPResponse: Head full, %s dropped\n", name);
+    }
+    return *this;
+}
+
+HTTPResponse& HTTPResponse::header(const char* name, unsigned long value) {
+    if (!append("%s: %lu\r\n", name, value)) {
+        DEBUG_PRINTF("HTTPResponse: Head full, %s dropped\n", name);
+    }
+    return *this;
+}
+
+bool HTTPResponse::send(const uint8_t* body, size_t bodyLength) {
+    header("Content-Length", (unsigned long)bodyLength);
+    return write(body, bodyLength, false);
+}
+
+bool HTTPResponse::send(const String& body) {
+    return send((const uint8_t*)body.c_str(), body.length());
+}
+
+bool HTTPResponse::sendStatic(const uint8_t* body, size_t bodyLength) {
+    header("Content-Length", (unsigned long)bodyLength);
+    return write(body, bodyLength, true);
+}
+
+bool HTTPResponse::sendHead() {
+    return write(nullptr, 0, false);
+}
+
+bool HTTPResponse::sendChunked() {
+    HTTPConnection* connection = SimpleHTTPServer::connectionOf(client);
+    if (connection && connection->getRequest().http11) {
+        header("Transfer-Encoding", "chunked");
+        write(nullptr, 0, false);
+        return true;
+    }
+
+    // HTTP/1.0 has no chunks: the body ends when the socket closes
+    if (connection) {
+        connection->keepAlive = false;
+    }
+    write(nullptr, 0, false);
+    return false;
+}
+
+bool HTTPResponse::append(const char* format, ...) {
+    // The last two bytes are kept for the blank line ending the head
+    size_t space = sizeof(head) - 2 - length;
+    va_list args;
+    va_start(args, format);
+    int count = vsnprintf(head + length, space, format, args);
+    va_end(args);
+
+    // Keep the head well-formed: a line that does not fit is left out
+    if (count < 0 || (size_t)count >= space) {
+        head[length] = '\0';
+        return false;
+    }
+    length += count;
+    return true;
+}
+
+bool HTTPResponse::write(const uint8_t* body, size_t bodyLength, bool stable) {
+    // Connection last, connectionHeader() decides it for the whole response
+    header("Connection", SimpleHTTPServer::connectionHeader(client));
+    head[length++] = '\r';
+    head[length++] = '\n';
+
+    HTTPConnection* connection = SimpleHTTPServer::connectionOf(client);
+    if (connection) {
+        return connection->writeResponse((const uint8_t*)head, length, body, bodyLength, stable);
+    }
+
+    // Not one of ours - at least keep the head in one write
+    bool ok = client.write((const uint8_t*)head, length) == length;
+    if (ok && bodyLength > 0) {
+        ok = client.write(body, bodyLength) == bodyLength;
+    }
+    return ok;
+}
+
+HTTPStream::HTTPStream(HTTPResponse& response) :
+    client(response.client),
+    chunked(false),
+    ended(false),
+    used(0)
+{
+    chunked = response.sendChunked();
+
+    // The head leaves now, not when the whole body has been produced
+    HTTPConnection* connection = SimpleHTTPServer::connectionOf(client);
+    if (connection) {
+        connection->push();
+    }
+}
+
+HTTPStream::~HTTPStream() {
+    end();
+}
+
+size_t HTTPStream::write(uint8_t value) {
+    return write(&value, 1);
+}
+
+size_t HTTPStream::write(const uint8_t* data, size_t size) {
+    if (ended) return 0;
+
+    size_t written = 0;
+    while (written < size) {
+        if (used == HTTP_CHUNK_BUFFER) {
+            sendChunk();
+        }
+        size_t count = min(size - written, (size_t)HTTP_CHUNK_BUFFER - used);
+        memcpy(buffer + HTTP_CHUNK_RESERVE + used, data + written, count);
+        used += count;
+        written += count;
+    }
+    return written;
+}
+
+bool HTTPStream::connected() {
+    return client.connected();
+}
+
+bool HTTPStream::writable() {
+    HTTPConnection* connection = SimpleHTTPServer::connectionOf(client);
+    return !connection || connection->writable() >= sizeof(buffer);
+}
+
+void HTTPStream::end() {
+    if (ended) return;
+
+    sendChunk();
+    if (chunked) {
+        client.write((const uint8_t*)"0\r\n\r\n", 5);
+    }
+    ended = true;
+}
+
+void HTTPStream::sendChunk() {
+    if (used == 0) return;
+
+    // Size line in front of the data and CRLF after it, so each chunk is
+    // a single write
+    uint8_t* start = buffer + HTTP_CHUNK_RESERVE;
+    size_t length = used;
+    if (chunked) {
+        char line[HTTP_CHUNK_RESERVE + 1];
+        int digits = snprintf(line, sizeof(line), "%x\r\n", (unsigned)used);
+        start -= digits;
+        memcpy(start, line, digits);
+        start[digits + used] = '\r';
+        start[digits + used + 1] = '\n';
+        length += digits + 2;
+    }
+    client.write(start, length);
+    used = 0;
+
+    HTTPConnection* connection = SimpleHTTPServer::connectionOf(client);
+    if (connection) {
+        connection->push();
+    }
+}
+
+SimpleHTTPServer::SimpleHTTPServer() : server(80), serverPort(80), running(false), connections(nullptr) {
+    memset(&stats, 0, sizeof(stats));
 }
 
 SimpleHTTPServer::~SimpleHTTPServer() {
     stop();
+    delete[] connections;
 }
 
 bool SimpleHTTPServer::begin(uint16_t port) {
+    if (!connections) {
+        connections = new HTTPConnection[HTTP_MAX_CONNECTIONS];
+    }
+    buildRoutes();
+
     serverPort = port;
-    server = WiFiServer(port);
+    server = WiFiServer(port, HTTP_MAX_CONNECTIONS);
     server.begin();
     running = true;
 
-    DEBUG_PRINTF("SimpleHTTPServer: Started on port %d\n", port);
+    DEBUG_PRINTF("SimpleHTTPServer: Started on port %d, %d connections\n", port, HTTP_MAX_CONNECTIONS);
 
     // Initialize SPIFFS if not already done
     if (!SPIFFS.begin(true)) {
@@ -26,11 +496,17 @@ bool SimpleHTTPServer::begin(uint16_t port) {
         return false;
     }
 
+    indexAssets();
     return true;
 }
 
 void SimpleHTTPServer::stop() {
     if (running) {
+        for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+            if (connections[i].state != HTTPConnectionState::FREE) {
+                close(connections[i]);
+            }
+        }
         server.stop();
         running = false;
         DEBUG_PRINTLN("SimpleHTTPServer: Stopped");
@@ -40,105 +516,670 @@ void SimpleHTTPServer::stop() {
 void SimpleHTTPServer::handleClient() {
     if (!running) return;
 
-    WiFiClient client = server.available();
-    if (!client) return;
+    uint32_t started = micros();
+    acceptClients();
+
+    uint16_t open = 0;
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        if (connections[i].state == HTTPConnectionState::FREE) continue;
+        service(connections[i]);
+        if (connections[i].state != HTTPConnectionState::FREE) open++;
+    }
+
+    uint32_t elapsed = micros() - started;
+    stats.open = open;
+    if (open > stats.maxOpen) stats.maxOpen = open;
+    if (elapsed > stats.maxServiceUs) stats.maxServiceUs = elapsed;
+}
+
+void SimpleHTTPServer::on(const String& path, HTTPHandler handler) {
+    on(HTTPMethod::ANY, path, handler);
+}
+
+void SimpleHTTPServer::on(HTTPMethod methods, const String& path, HTTPHandler handler) {
+    routes.push_back({path, methods, handler});
+    DEBUG_PRINTF("SimpleHTTPServer: Route added: %s\n", path.c_str());
 
-    // Wait for data with timeout
-    unsigned long timeout = millis() + 5000;
-    while (!client.available() && millis() < timeout) {
-        delay(1);
+    // Late registrations still get found
+    if (running) {
+        buildRoutes();
     }
+}
+
+void SimpleHTTPServer::acceptClients() {
+    // Only as many as there are free slots; the rest wait in the backlog
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        if (connections[i].state != HTTPConnectionState::FREE) continue;
+
+        WiFiClient client = server.available();
+        if (!client) return;
 
-    if (!client.available()) {
-        client.stop();
+        client.setNoDelay(true);
+        connections[i].attach(client);
+        stats.accepted++;
+    }
+}
+
+void SimpleHTTPServer::service(HTTPConnection& connection) {
+    bool expired = (int32_t)(millis() - connection.deadline) > 0;
+
+    if (connection.state == HTTPConnectionState::STREAMING) {
+        serviceStream(connection, expired);
         return;
     }
 
-    String method, path, query;
-    if (!parseRequest(client, method, path, query)) {
-        client.stop();
+    if (connection.state == HTTPConnectionState::WRITING) {
+        uint32_t writes = connection.writes;
+        if (drain(connection)) {
+            stats.writes += connection.writes;
+            if (connection.spilled) stats.spilled++;
+            if (connection.persist) {
+                connection.nextRequest();
+            } else {
+                close(connection);
+            }
+        } else if (connection.writes != writes) {
+            // A long body takes many passes; only a client that stops
+            // taking data runs into the timeout
+            connection.deadline = millis() + HTTP_WRITE_TIMEOUT_MS;
+        } else if (expired) {
+            stats.timeouts++;
+            stats.writes += connection.writes;
+            if (connection.spilled) stats.spilled++;
+            close(connection);
+        }
         return;
     }
 
-    DEBUG_PRINTF("SimpleHTTPServer: %s %s\n", method.c_str(), path.c_str());
+    if (!receive(connection)) {
+        // Peer went away before sending a whole request
+        close(connection);
+        return;
+    }
+
+    if (connection.state == HTTPConnectionState::READING_HEADERS) {
+        if (!parseHead(connection)) return;
+        if (connection.headLength == 0) {
+            if (expired && connection.requestLength == 0 && connection.served > 0) {
+                // Idle keep-alive socket, nothing to answer
+                close(connection);
+            } else if (expired) {
+                stats.timeouts++;
+                fail(connection, 408);
+            }
+            return;
+        }
+        connection.state = HTTPConnectionState::READING_BODY;
+        connection.deadline = millis() + HTTP_BODY_TIMEOUT_MS;
+        expired = false;
+    }
+
+    if (!connection.bodyComplete()) {
+        if (expired) {
+            stats.timeouts++;
+            fail(connection, 408);
+        }
+        return;
+    }
+
+    dispatch(connection);
+}
+
+bool SimpleHTTPServer::receive(HTTPConnection& connection) {
+    int waiting = connection.WiFiClient::available();
+    if (waiting <= 0) {
+        // Requests pipelined before a half-close still get answered
+        return connection.requestLength > 0 || connection.WiFiClient::connected();
+    }
+
+    if (connection.largeBody) {
+        // Only up to its end; a pipelined request waits in the socket
+        size_t space = connection.head.contentLength - connection.largeReceived;
+        if (space == 0) return true;
+
+        int count = connection.WiFiClient::read((uint8_t*)connection.largeBody + connection.largeReceived,
+                                                min((size_t)waiting, space));
+        if (count > 0) {
+            connection.largeReceived += count;
+        }
+        return true;
+    }
+
+    size_t space = sizeof(connection.request) - connection.requestLength;
+    if (space == 0) return true;
+
+    int count = connection.WiFiClient::read((uint8_t*)connection.request + connection.requestLength,
+                                            min((size_t)waiting, space));
+    if (count > 0) {
+        connection.requestLength += count;
+    }
+    return true;
+}
+
+void SimpleHTTPServer::dispatch(HTTPConnection& connection) {
+    const HTTPRequest& head = connection.head;
+    const char* path = connection.text(head.path);
+    DEBUG_PRINTF("SimpleHTTPServer: %s %s\n", connection.text(head.method), path);
+    stats.requests++;
+    if (connection.served > 0) {
+        stats.reused++;
+    }
+    connection.served++;
+
+    // Handlers that answer through send()/sendFile() pick keep-alive up
+    // via connectionHeader(); anything else closes after the response
+    connection.keepAlive = allowKeepAlive(connection);
+    connection.persist = false;
+    connection.bodyPosition = 0;
+    current = &connection;
 
     // Check for registered routes
-    Route* route = findRoute(path);
+    uint8_t allowed = 0;
+    Route* route = findRoute(connection, path, methodOf(connection.text(head.method)), allowed);
     if (route) {
-        route->handler(client, method, query);
+        // Short methods fit String's inline buffer; only a query allocates
+        String method(connection.text(head.method));
+        String query(connection.text(head.query));
+        route->handler(connection, method, query);
+    } else if (allowed) {
+        sendMethodNotAllowed(connection, allowed);
     } else {
         // Try to serve file from SPIFFS
-        sendFile(client, path);
+        sendFile(connection, path);
     }
+    current = nullptr;
 
-    // Give client time to receive data
-    delay(1);
-    client.stop();
+    connection.state = connection.streaming ? HTTPConnectionState::STREAMING : HTTPConnectionState::WRITING;
+    connection.deadline = millis() + HTTP_WRITE_TIMEOUT_MS;
 }
 
-void SimpleHTTPServer::on(const String& path, HTTPHandler handler) {
-    routes.push_back({path, handler});
-    DEBUG_PRINTF("SimpleHTTPServer: Route added: %s\n", path.c_str());
+void SimpleHTTPServer::serviceStream(HTTPConnection& connection, bool expired) {
+    // Nothing more is read from an event stream, only its close matters
+    while (connection.WiFiClient::available() > 0) {
+        connection.WiFiClient::read((uint8_t*)connection.request, sizeof(connection.request));
+    }
+
+    // The deadline only runs while frames wait; a reader that takes
+    // none for the write timeout is dropped
+    bool idle = drain(connection);
+    if (idle) {
+        connection.responseLength = 0;
+        connection.responseSent = 0;
+        connection.deadline = millis() + HTTP_WRITE_TIMEOUT_MS;
+    } else if (expired) {
+        stats.timeouts++;
+    }
+
+    if (!connection.WiFiClient::connected() || (!idle && expired)) {
+        stats.writes += connection.writes;
+        close(connection);
+    }
+}
+
+bool SimpleHTTPServer::beginEventStream(WiFiClient& client, uint32_t intervalMs) {
+    HTTPConnection* connection = connectionOf(client);
+    if (!connection || getEventStreamCount() >= HTTP_MAX_EVENT_STREAMS ||
+        heldConnections(*connection) >= HTTP_MAX_CONNECTIONS - 1) {
+        return false;
+    }
+
+    // The body ends when either side closes the socket
+    connection->keepAlive = false;
+    connection->streaming = true;
+    connection->eventInterval = intervalMs;
+    connection->lastEvent = millis() - intervalMs;
+
+    HTTPResponse response(client, 200);
+    response.header("Content-Type", "text/event-stream");
+    response.header("Cache-Control", "no-cache");
+    response.header("X-Accel-Buffering", "no");    // Proxies pass frames through as they come
+    response.sendHead();
+    client.printf("retry: %u\n\n", (unsigned)SSE_RETRY_MS);
+    return true;
+}
+
+void SimpleHTTPServer::publishEvent(const char* frame, size_t length) {
+    if (!running) return;
+
+    uint32_t now = millis();
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        HTTPConnection& connection = connections[i];
+        if (connection.state != HTTPConnectionState::STREAMING) continue;
+        if (now - connection.lastEvent < connection.eventInterval) continue;
+
+        // Sent bytes out of the way, then the frame whole or not at all.
+        // Nothing may overtake a spilled replay.
+        size_t pending = connection.responseLength - connection.responseSent;
+        memmove(connection.response, connection.response + connection.responseSent, pending);
+        connection.responseLength = pending;
+        connection.responseSent = 0;
+        if (connection.spillLength > 0 || length > sizeof(connection.response) - pending) {
+            stats.eventsDropped++;
+            continue;
+        }
+
+        memcpy(connection.response + pending, frame, length);
+        connection.responseLength += length;
+        connection.lastEvent = now;
+        connection.push();
+        stats.eventsSent++;
+    }
+}
+
+uint8_t SimpleHTTPServer::getEventStreamCount() const {
+    uint8_t count = 0;
+    for (int i = 0; connections && i < HTTP_MAX_CONNECTIONS; i++) {
+        // Including one whose handler is setting it up
+        if (connections[i].state != HTTPConnectionState::FREE && connections[i].streaming) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool SimpleHTTPServer::drain(HTTPConnection& connection) {
+    // Queue, spill and external body in one gathered send; once they are
+    // out the producer adds more, up to HTTP_PRODUCE_PER_PASS per pass
+    size_t produced = 0;
+    for (;;) {
+        struct iovec parts[3];
+        int count = 0;
+        size_t lengths[3] = {
+            connection.responseLength - connection.responseSent,
+            connection.spillLength - connection.spillSent,
+            connection.externalLength - connection.externalSent
+        };
+        const uint8_t* starts[3] = {
+            connection.response + connection.responseSent,
+            connection.spill + connection.spillSent,
+            connection.external + connection.externalSent
+        };
+        for (int i = 0; i < 3; i++) {
+            if (lengths[i] == 0) continue;
+            parts[count].iov_base = (void*)starts[i];
+            parts[count].iov_len = lengths[i];
+            count++;
+        }
+
+        if (count == 0) {
+            connection.responseLength = connection.responseSent = 0;
+            connection.spillLength = connection.spillSent = 0;
+            connection.externalLength = connection.externalSent = 0;
+            connection.external = nullptr;
+            if (!connection.producer) return true;
+            if (produced >= HTTP_PRODUCE_PER_PASS) return false;
+
+            bool more = runProducer(connection);
+            size_t made = connection.responseLength + connection.spillLength + connection.externalLength;
+            if (more && made == 0) return false;    // Nothing to add yet, ask again next pass
+            produced += made;
+            continue;
+        }
+
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = parts;
+        message.msg_iovlen = count;
+        int sent = lwip_sendmsg(connection.fd(), &message, MSG_DONTWAIT);
+        if (sent > 0) {
+            connection.writes++;
+            // Off the front, in order
+            size_t done = sent;
+            size_t step = min(done, lengths[0]);
+            connection.responseSent += step;
+            done -= step;
+            step = min(done, lengths[1]);
+            connection.spillSent += step;
+            done -= step;
+            connection.externalSent += done;
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Socket buffer full, try again next pass
+            return false;
+        }
+        // Peer reset - nothing left to deliver to
+        connection.producer = nullptr;
+        return true;
+    }
 }
 
-bool SimpleHTTPServer::parseRequest(WiFiClient& client, String& method, String& path, String& query) {
-    String requestLine = client.readStringUntil('\n');
-    requestLine.trim();
+bool SimpleHTTPServer::runProducer(HTTPConnection& connection) {
+    // connectionOf() and HTTPStream work in the producer as in a handler
+    current = &connection;
+    bool more = connection.producer(connection) && !connection.cut;
+    if (!more) {
+        // Its captured state goes now, while it can still write (a stream's end)
+        connection.producer = nullptr;
+    }
+    current = nullptr;
+    return more;
+}
 
-    int firstSpace = requestLine.indexOf(' ');
-    int secondSpace = requestLine.indexOf(' ', firstSpace + 1);
+void SimpleHTTPServer::fail(HTTPConnection& connection, int code) {
+    if (code != 408) {
+        stats.rejected++;
+    }
+    connection.persist = false;
+    send(connection, code, "text/plain", statusText(code));
+    connection.state = HTTPConnectionState::WRITING;
+    connection.deadline = millis() + HTTP_WRITE_TIMEOUT_MS;
+}
 
-    if (firstSpace == -1 || secondSpace == -1) {
+void SimpleHTTPServer::close(HTTPConnection& connection) {
+    connection.release();
+}
+
+bool SimpleHTTPServer::allowKeepAlive(HTTPConnection& connection) {
+    if (!connection.head.keepAlive || connection.served >= HTTP_MAX_REQUESTS_PER_CONNECTION) {
         return false;
     }
 
-    method = requestLine.substring(0, firstSpace);
-    String fullPath = requestLine.substring(firstSpace + 1, secondSpace);
+    // Sockets already held open count against the lwIP pool
+    int kept = 0;
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        if (&connections[i] != &connection && connections[i].state != HTTPConnectionState::FREE &&
+            connections[i].persist) {
+            kept++;
+        }
+    }
+    return kept < HTTP_MAX_KEEPALIVE && heldConnections(connection) < HTTP_MAX_CONNECTIONS - 1;
+}
 
-    // Extract path and query string
-    int queryStart = fullPath.indexOf('?');
-    if (queryStart != -1) {
-        path = fullPath.substring(0, queryStart);
-        query = fullPath.substring(queryStart + 1);
-    } else {
-        path = fullPath;
-        query = "";
+int SimpleHTTPServer::heldConnections(const HTTPConnection& except) const {
+    // Kept-alive and event-stream sockets other than `except`: holding one
+    // more must still leave a slot for a new client
+    int held = 0;
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        const HTTPConnection& other = connections[i];
+        if (&other != &except && other.state != HTTPConnectionState::FREE && (other.persist || other.streaming)) {
+            held++;
+        }
+    }
+    return held;
+}
+
+bool SimpleHTTPServer::parseHead(HTTPConnection& connection) {
+    // Only lines completed since the last pass are looked at
+    char* request = connection.request;
+    while (connection.headLength == 0) {
+        size_t offset = connection.parsed;
+        char* newline = (char*)memchr(request + offset, '\n', connection.requestLength - offset);
+        if (!newline) break;
+
+        size_t length = newline - (request + offset);
+        if (length > 0 && newline[-1] == '\r') length--;
+        connection.parsed = newline + 1 - request;
+
+        if (connection.head.method.length == 0) {
+            // Stray blank lines before a request are allowed
+            if (length == 0) continue;
+            if (!parseRequestLine(connection, offset, length)) {
+                fail(connection, 400);
+                return false;
+            }
+        } else if (length == 0) {
+            connection.headLength = connection.parsed;
+        } else if (!parseHeader(connection, offset, length)) {
+            fail(connection, 400);
+            return false;
+        }
+    }
+
+    if (connection.headLength == 0) {
+        if (connection.requestLength == sizeof(connection.request)) {
+            fail(connection, 431);
+            return false;
+        }
+        return true;
     }
 
-    // Skip headers
-    while (client.available()) {
-        String header = client.readStringUntil('\n');
-        header.trim();
-        if (header.length() == 0) break;
+    // A chunked body isn't delimited by Content-Length; reading on would
+    // take it for the next request. Refuse it and drop the connection.
+    if (connection.head.transferEncoding) {
+        fail(connection, 501);
+        return false;
     }
 
+    // A body that doesn't fit behind the head is received into its own
+    // buffer, as long as some route could take it
+    if (connection.headLength + connection.head.contentLength > sizeof(connection.request) &&
+        (connection.head.contentLength > HTTP_BODY_LIMIT || !connection.allocateBody())) {
+        fail(connection, 413);
+        return false;
+    }
     return true;
 }
 
-SimpleHTTPServer::Route* SimpleHTTPServer::findRoute(const String& path) {
-    for (auto& route : routes) {
-        if (route.path == path) {
+bool SimpleHTTPServer::parseRequestLine(HTTPConnection& connection, size_t offset, size_t length) {
+    // METHOD SP target SP HTTP/1.x - separators become terminators
+    char* line = connection.request + offset;
+    char* end = line + length;
+    char* firstSpace = (char*)memchr(line, ' ', length);
+    if (!firstSpace || firstSpace == line) return false;
+    char* target = firstSpace + 1;
+    char* secondSpace = (char*)memchr(target, ' ', end - target);
+    if (!secondSpace || secondSpace == target) return false;
+    char* version = secondSpace + 1;
+    if (end - version != 8 || strncmp(version, "HTTP/1.", 7) != 0) return false;
+
+    HTTPRequest& head = connection.head;
+    head.method = {(uint16_t)offset, (uint16_t)(firstSpace - line)};
+    *firstSpace = '\0';
+
+    char* queryStart = (char*)memchr(target, '?', secondSpace - target);
+    char* pathEnd = queryStart ? queryStart : secondSpace;
+    head.path = {(uint16_t)(target - connection.request), (uint16_t)(pathEnd - target)};
+    if (queryStart) {
+        head.query = {(uint16_t)(queryStart + 1 - connection.request), (uint16_t)(secondSpace - queryStart - 1)};
+    } else {
+        // Empty, pointing at the terminator below
+        head.query = {(uint16_t)(secondSpace - connection.request), 0};
+    }
+    *pathEnd = '\0';
+    *secondSpace = '\0';
+
+    // HTTP/1.1 keeps the connection unless told otherwise, 1.0 only when asked
+    head.http11 = version[7] == '1';
+    head.keepAlive = head.http11;
+    return true;
+}
+
+bool SimpleHTTPServer::parseHeader(HTTPConnection& connection, size_t offset, size_t length) {
+    const char* line = connection.request + offset;
+    const char* colon = (const char*)memchr(line, ':', length);
+    if (!colon || colon == line) return false;
+
+    // Value without surrounding whitespace
+    size_t nameLength = colon - line;
+    const char* value = colon + 1;
+    const char* end = line + length;
+    while (value < end && (*value == ' ' || *value == '\t')) value++;
+    while (end > value && (end[-1] == ' ' || end[-1] == '\t')) end--;
+    HTTPSlice slice = {(uint16_t)(value - connection.request), (uint16_t)(end - value)};
+
+    HTTPRequest& head = connection.head;
+    if (nameLength == 14 && strncasecmp(line, "Content-Length", 14) == 0) {
+        if (slice.length == 0) return false;
+        size_t contentLength = 0;
+        for (const char* p = value; p < end; p++) {
+            if (*p < '0' || *p > '9' || contentLength > HTTP_BODY_LIMIT) return false;
+            contentLength = contentLength * 10 + (*p - '0');
+        }
+        head.contentLength = contentLength;
+    } else if (nameLength == 12 && strncasecmp(line, "Content-Type", 12) == 0) {
+        head.contentType = slice;
+    } else if (nameLength == 13 && strncasecmp(line, "If-None-Match", 13) == 0) {
+        head.ifNoneMatch = slice;
+    } else if (nameLength == 15 && strncasecmp(line, "Accept-Encoding", 15) == 0) {
+        head.acceptEncoding = slice;
+    } else if (nameLength == 7 && strncasecmp(line, "Upgrade", 7) == 0) {
+        head.upgrade = slice;
+    } else if (nameLength == 13 && strncasecmp(line, "Last-Event-ID", 13) == 0) {
+        head.lastEventId = slice;
+    } else if (nameLength == 17 && strncasecmp(line, "Transfer-Encoding", 17) == 0) {
+        head.transferEncoding = true;
+    } else if (nameLength == 10 && strncasecmp(line, "Connection", 10) == 0) {
+        if (connection.contains(slice, "close")) head.keepAlive = false;
+        if (connection.contains(slice, "keep-alive")) head.keepAlive = true;
+    }
+    return true;
+}
+
+void SimpleHTTPServer::buildRoutes() {
+    // Pointer tree first, then flattened breadth-first so the children
+    // of every node end up next to each other
+    struct BuildNode {
+        String segment;
+        bool param;
+        std::vector<uint16_t> children;
+        uint16_t paramChild;
+        std::vector<uint16_t> routes;
+    };
+    std::vector<BuildNode> tree(1);
+    tree[0].param = false;
+    tree[0].paramChild = HTTP_ROUTE_NONE;
+
+    for (size_t r = 0; r < routes.size(); r++) {
+        const String& path = routes[r].path;
+        uint16_t node = 0;
+        int start = path.startsWith("/") ? 1 : 0;
+        while (start < (int)path.length()) {
+            int end = path.indexOf('/', start);
+            if (end == -1) end = path.length();
+            String segment = path.substring(start, end);
+            bool param = segment.startsWith("{") && segment.endsWith("}");
+            start = end + 1;
+
+            uint16_t next = param ? tree[node].paramChild : HTTP_ROUTE_NONE;
+            if (!param) {
+                for (uint16_t child : tree[node].children) {
+                    if (tree[child].segment == segment) {
+                        next = child;
+                        break;
+                    }
+                }
+            }
+            if (next == HTTP_ROUTE_NONE) {
+                next = tree.size();
+                tree.push_back({param ? String() : segment, param, {}, HTTP_ROUTE_NONE, {}});
+                if (param) {
+                    tree[node].paramChild = next;
+                } else {
+                    tree[node].children.push_back(next);
+                }
+            }
+            node = next;
+        }
+        tree[node].routes.push_back(r);
+    }
+
+    std::vector<uint16_t> order(1, 0);
+    for (size_t i = 0; i < order.size(); i++) {
+        const BuildNode& node = tree[order[i]];
+        order.insert(order.end(), node.children.begin(), node.children.end());
+        if (node.paramChild != HTTP_ROUTE_NONE) order.push_back(node.paramChild);
+    }
+    std::vector<uint16_t> position(tree.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        position[order[i]] = i;
+    }
+
+    routeNodes.clear();
+    routeSlots.clear();
+    routeText = "";
+    for (uint16_t index : order) {
+        const BuildNode& node = tree[index];
+        RouteNode flat;
+        flat.hash = HTTP_FNV_SEED;
+        for (unsigned int i = 0; i < node.segment.length(); i++) {
+            flat.hash = (flat.hash ^ (uint8_t)node.segment[i]) * HTTP_FNV_PRIME;
+        }
+        flat.text = routeText.length();
+        flat.length = node.segment.length();
+        routeText += node.segment;
+        flat.firstChild = node.children.empty() ? 0 : position[node.children[0]];
+        flat.childCount = node.children.size();
+        flat.param = node.paramChild == HTTP_ROUTE_NONE ? HTTP_ROUTE_NONE : position[node.paramChild];
+        flat.firstRoute = routeSlots.size();
+        flat.routeCount = node.routes.size();
+        routeSlots.insert(routeSlots.end(), node.routes.begin(), node.routes.end());
+        routeNodes.push_back(flat);
+    }
+
+    DEBUG_PRINTF("SimpleHTTPServer: %u routes, %u trie nodes\n", (unsigned)routes.size(), (unsigned)routeNodes.size());
+}
+
+SimpleHTTPServer::Route* SimpleHTTPServer::findRoute(HTTPConnection& connection, const char* path,
+                                                     HTTPMethod method, uint8_t& allowed) {
+    allowed = 0;
+    connection.pattern = nullptr;
+    connection.paramCount = 0;
+    if (routeNodes.empty()) return nullptr;
+
+    const char* text = routeText.c_str();
+    const RouteNode* node = &routeNodes[0];
+    const char* segment = path[0] == '/' ? path + 1 : path;
+    while (*segment) {
+        uint32_t hash = HTTP_FNV_SEED;
+        const char* end = segment;
+        while (*end && *end != '/') {
+            hash = (hash ^ (uint8_t)*end++) * HTTP_FNV_PRIME;
+        }
+        size_t length = end - segment;
+
+        const RouteNode* next = nullptr;
+        for (uint16_t i = 0; i < node->childCount; i++) {
+            const RouteNode& child = routeNodes[node->firstChild + i];
+            if (child.hash == hash && child.length == length && memcmp(text + child.text, segment, length) == 0) {
+                next = &child;
+                break;
+            }
+        }
+        if (!next && node->param != HTTP_ROUTE_NONE && length > 0) {
+            if (connection.paramCount == HTTP_MAX_PATH_PARAMS) return nullptr;
+            connection.params[connection.paramCount++] = {(uint16_t)(segment - connection.request), (uint16_t)length};
+            next = &routeNodes[node->param];
+        }
+        if (!next) return nullptr;
+
+        node = next;
+        segment = *end ? end + 1 : end;
+    }
+
+    for (uint16_t i = 0; i < node->routeCount; i++) {
+        Route& route = routes[routeSlots[node->firstRoute + i]];
+        allowed |= (uint8_t)route.methods;
+        if ((uint8_t)route.methods & (uint8_t)method) {
+            connection.pattern = route.path.c_str();
             return &route;
         }
     }
     return nullptr;
 }
 
-void SimpleHTTPServer::send(WiFiClient& client, int code, const String& contentType, const String& content) {
-    String status;
-    switch (code) {
-        case 200: status = "OK"; break;
-        case 302: status = "Found"; break;
-        case 404: status = "Not Found"; break;
-        case 500: status = "Internal Server Error"; break;
-        default: status = "Unknown"; break;
+void SimpleHTTPServer::sendMethodNotAllowed(WiFiClient& client, uint8_t allowed) {
+    static const char* const names[] = {"GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS"};
+
+    char allow[64] = "";    // Fits all seven
+    for (uint8_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (allowed & (1 << i)) {
+            if (allow[0]) strcat(allow, ", ");
+            strcat(allow, names[i]);
+        }
     }
 
-    client.printf("HTTP/1.1 %d %s\r\n", code, status.c_str());
-    client.printf("Content-Type: %s\r\n", contentType.c_str());
-    client.printf("Content-Length: %d\r\n", content.length());
-    client.println("Connection: close\r\n");
-    client.print(content);
+    const char* text = statusText(405);
+    HTTPResponse response(client, 405);
+    response.header("Allow", allow);
+    response.header("Content-Type", "text/plain");
+    response.send((const uint8_t*)text, strlen(text));
+}
+
+void SimpleHTTPServer::send(WiFiClient& client, int code, const String& contentType, const String& content) {
+    HTTPResponse response(client, code);
+    response.header("Content-Type", contentType.c_str());
+    response.send(content);
 }
 
 void SimpleHTTPServer::sendJSON(WiFiClient& client, const String& json) {
@@ -146,9 +1187,9 @@ void SimpleHTTPServer::sendJSON(WiFiClient& client, const String& json) {
 }
 
 void SimpleHTTPServer::redirect(WiFiClient& client, const String& location) {
-    client.println("HTTP/1.1 302 Found");
-    client.printf("Location: %s\r\n", location.c_str());
-    client.println("Connection: close\r\n");
+    HTTPResponse response(client, 302);
+    response.header("Location", location.c_str());
+    response.send();
 }
 
 void SimpleHTTPServer::sendFile(WiFiClient& client, const String& path) {
@@ -164,33 +1205,245 @@ void SimpleHTTPServer::sendFile(WiFiClient& client, const String& path) {
         filePath = "/wifi_config.html";
     }
 
-    if (!SPIFFS.exists(filePath)) {
+    HTTPConnection* connection = connectionOf(client);
+    bool headOnly = connection && connection->equals(connection->getRequest().method, "HEAD");
+
+    // Precompressed copy from scripts/compress_assets.py, for clients that take it
+    const StaticAsset* gzipAsset = findAsset(filePath + ".gz");
+    const StaticAsset* asset = gzipAsset && acceptsGzip(client) ? gzipAsset : findAsset(filePath);
+    bool sendGzip = asset && asset == gzipAsset;
+
+    // Files that are not indexed web assets go out as they are, without validators
+    if (!asset && !SPIFFS.exists(filePath)) {
         // For captive portal, redirect all 404s to the config page
         redirect(client, "/wifi_config.html");
         return;
     }
 
-    File file = SPIFFS.open(filePath, "r");
-    if (!file) {
-        send(client, 500, "text/plain", "Failed to open file");
-        return;
+    const char* cache = cacheControl(filePath);
+    if (asset && connection) {
+        const HTTPSlice& ifNoneMatch = connection->getRequest().ifNoneMatch;
+        if (connection->contains(ifNoneMatch, asset->etag) || connection->equals(ifNoneMatch, "*")) {
+            HTTPResponse response(client, 304);
+            response.header("ETag", asset->etag);
+            response.header("Cache-Control", cache);
+            if (gzipAsset) {
+                response.header("Vary", "Accept-Encoding");
+            }
+            response.sendHead();
+            return;
+        }
+    }
+
+    // Mapped assets and HEAD on an indexed one need no file at all
+    File file;
+    size_t size = asset ? asset->size : 0;
+    if (!asset || (!asset->data && !headOnly)) {
+        file = SPIFFS.open(asset ? asset->path : filePath, "r");
+        if (!file) {
+            send(client, 500, "text/plain", "Failed to open file");
+            return;
+        }
+        size = file.size();
     }
 
     String contentType = getContentType(filePath);
-    client.println("HTTP/1.1 200 OK");
-    client.printf("Content-Type: %s\r\n", contentType.c_str());
-    client.printf("Content-Length: %d\r\n", file.size());
-    client.println("Connection: close");
-    client.println();
+    HTTPResponse response(client, 200);
+    response.header("Content-Type", contentType.c_str());
+    if (sendGzip) {
+        response.header("Content-Encoding", "gzip");
+    }
+    if (gzipAsset) {
+        response.header("Vary", "Accept-Encoding");
+    }
+    if (asset) {
+        response.header("ETag", asset->etag);
+        response.header("Cache-Control", cache);
+    }
+
+    if (asset && asset->data && !headOnly) {
+        // Straight from mapped flash behind the head, no copy on our side
+        response.sendStatic(asset->data, size);
+        return;
+    }
+
+    response.header("Content-Length", (unsigned long)size);
+    response.sendHead();
+    if (file && !headOnly) {
+        // Read a piece at a time as the socket takes it; the producer
+        // owns the file from here and closes it when done
+        produce(client, [file](WiFiClient& client) mutable {
+            uint8_t buffer[1024];
+            size_t length = file.read(buffer, sizeof(buffer));
+            if (length > 0 && client.write(buffer, length) == length && file.available()) {
+                return true;
+            }
+            file.close();
+            return false;
+        });
+        return;
+    }
+
+    if (file) {
+        file.close();
+    }
+}
+
+void SimpleHTTPServer::produce(WiFiClient& client, HTTPProducer producer) {
+    HTTPConnection* connection = connectionOf(client);
+    if (connection) {
+        connection->producer = producer;
+        return;
+    }
+
+    // Not one of ours - make it all now
+    while (producer(client)) {
+    }
+}
+
+void SimpleHTTPServer::indexAssets() {
+    assets.clear();
+
+    // Bundle first; SPIFFS only adds what the bundle lacks
+    for (size_t i = 0; assetBundle && i < assetBundle->getCount(); i++) {
+        const AssetBundleEntry& entry = assetBundle->getEntry(i);
+        StaticAsset asset;
+        asset.path = entry.path;
+        asset.size = entry.size;
+        snprintf(asset.etag, sizeof(asset.etag), "\"%08x-%x\"", (unsigned)entry.hash, (unsigned)entry.size);
+        asset.data = assetBundle->data(entry);
+        assets.push_back(asset);
+    }
+    size_t bundled = assets.size();
+
+    File dir = SPIFFS.open("/");
+    File file = dir.openNextFile();
+    uint8_t buffer[512];
+    while (file) {
+        // Top-level web files only - the data directories (/tlog, ...)
+        // are rewritten at runtime
+        String path = file.path();
+        if (path.lastIndexOf('/') == 0 && isWebAsset(path) && !findAsset(path, bundled)) {
+            uint32_t hash = HTTP_FNV_SEED;
+            while (file.available()) {
+                size_t length = file.read(buffer, sizeof(buffer));
+                for (size_t i = 0; i < length; i++) {
+                    hash = (hash ^ buffer[i]) * HTTP_FNV_PRIME;
+                }
+            }
+
+            StaticAsset asset;
+            asset.path = path;
+            asset.size = file.size();
+            snprintf(asset.etag, sizeof(asset.etag), "\"%08x-%x\"", (unsigned)hash, (unsigned)asset.size);
+            asset.data = nullptr;
+            assets.push_back(asset);
+        }
+        file = dir.openNextFile();
+    }
+
+    std::sort(assets.begin(), assets.end(), [](const StaticAsset& a, const StaticAsset& b) {
+        return strcmp(a.path.c_str(), b.path.c_str()) < 0;
+    });
+
+    DEBUG_PRINTF("SimpleHTTPServer: %u static assets indexed, %u from the bundle\n",
+                 (unsigned)assets.size(), (unsigned)bundled);
+}
 
-    // Send file in chunks
-    uint8_t buffer[1024];
-    while (file.available()) {
-        size_t len = file.read(buffer, sizeof(buffer));
-        client.write(buffer, len);
+const StaticAsset* SimpleHTTPServer::findAsset(const String& path) {
+    return findAsset(path, assets.size());
+}
+
+const StaticAsset* SimpleHTTPServer::findAsset(const String& path, size_t count) {
+    // Binary search over the first `count` assets (sorted)
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        int order = strcmp(assets[middle].path.c_str(), path.c_str());
+        if (order == 0) return &assets[middle];
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
     }
+    return nullptr;
+}
+
+HTTPConnection* SimpleHTTPServer::connectionOf(WiFiClient& client) {
+    return current == &client ? current : nullptr;
+}
+
+const char* SimpleHTTPServer::connectionHeader(WiFiClient& client) {
+    if (current != &client || !current->keepAlive) {
+        return "close";
+    }
+    current->persist = true;
+    return "keep-alive";
+}
 
-    file.close();
+HTTPMethod SimpleHTTPServer::methodOf(const char* name) {
+    if (strcmp(name, "GET") == 0) return HTTPMethod::GET;
+    if (strcmp(name, "POST") == 0) return HTTPMethod::POST;
+    if (strcmp(name, "HEAD") == 0) return HTTPMethod::HEAD;
+    if (strcmp(name, "PUT") == 0) return HTTPMethod::PUT;
+    if (strcmp(name, "DELETE") == 0) return HTTPMethod::DELETE;
+    if (strcmp(name, "PATCH") == 0) return HTTPMethod::PATCH;
+    if (strcmp(name, "OPTIONS") == 0) return HTTPMethod::OPTIONS;
+    return HTTPMethod::NONE;
+}
+
+const char* SimpleHTTPServer::statusText(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+bool SimpleHTTPServer::acceptsGzip(WiFiClient& client) {
+    HTTPConnection* connection = connectionOf(client);
+    if (!connection) return false;
+
+    // "gzip;q=0" turns it down explicitly
+    const HTTPSlice& accept = connection->getRequest().acceptEncoding;
+    return connection->contains(accept, "gzip") && !connection->contains(accept, "gzip;q=0");
+}
+
+bool SimpleHTTPServer::isWebAsset(const String& path) {
+    String name = path.endsWith(".gz") ? path.substring(0, path.length() - 3) : path;
+    return getContentType(name) != "text/plain";
+}
+
+const char* SimpleHTTPServer::cacheControl(const String& path) {
+    // A dot-separated part of hex digits between name and extension
+    int start = path.lastIndexOf('/') + 1;
+    int dot = path.indexOf('.', start);
+    while (dot != -1) {
+        int next = path.indexOf('.', dot + 1);
+        if (next == -1) break;
+
+        int digits = 0;
+        for (int i = dot + 1; i < next && isxdigit((unsigned char)path[i]); i++) {
+            digits++;
+        }
+        if (digits == next - dot - 1 && digits >= HTTP_VERSION_MIN_DIGITS) {
+            return HTTP_CACHE_VERSIONED;
+        }
+        dot = next;
+    }
+    return HTTP_CACHE_DEFAULT;
 }
 
 void SimpleHTTPServer::handleNotFound(WiFiClient& client) {
@@ -198,6 +1451,7 @@ void SimpleHTTPServer::handleNotFound(WiFiClient& client) {
     redirect(client, "/wifi_config.html");
 }
 
+
 String SimpleHTTPServer::getContentType(const String& path) {
     if (path.endsWith(".html")) return "text/html";
     if (path.endsWith(".css")) return "text/css";
@@ -209,6 +1463,21 @@ String SimpleHTTPServer::getContentType(const String& path) {
     return "text/plain";
 }
 
+String SimpleHTTPServer::getQueryParam(const String& query, const String& name) {
+    int start = 0;
+    while (start < (int)query.length()) {
+        int end = query.indexOf('&', start);
+        if (end == -1) end = query.length();
+
+        int equals = query.indexOf('=', start);
+        if (equals != -1 && equals < end && query.substring(start, equals) == name) {
+            return urlDecode(query.substring(equals + 1, end));
+        }
+        start = end + 1;
+    }
+    return "";
+}
+
 String SimpleHTTPServer::urlDecode(const String& str) {
     String decoded = "";
     char temp[] = "0x00";
@@ -9,10 +9,281 @@
 #include <WiFi.h>
 #include <functional>
 #include <vector>
+#include "Config.h"
+#include "AssetBundle.h"
+
+#define HTTP_ROUTE_NONE     0xFFFF
+#define HTTP_FNV_SEED       2166136261u
+#define HTTP_FNV_PRIME      16777619u
+#define HTTP_CHUNK_RESERVE  6           // Chunk size line: 4 hex digits + CRLF
 
 // Route handler function type
 using HTTPHandler = std::function<void(WiFiClient&, const String&, const String&)>;
 
+// Makes the rest of a response body, see SimpleHTTPServer::produce()
+using HTTPProducer = std::function<bool(WiFiClient&)>;
+
+// Methods a route answers, combined with |
+enum class HTTPMethod : uint8_t {
+    NONE    = 0,
+    GET     = 0x01,
+    HEAD    = 0x02,
+    POST    = 0x04,
+    PUT     = 0x08,
+    DELETE  = 0x10,
+    PATCH   = 0x20,
+    OPTIONS = 0x40,
+    ANY     = 0xFF
+};
+
+inline HTTPMethod operator|(HTTPMethod a, HTTPMethod b) {
+    return (HTTPMethod)((uint8_t)a | (uint8_t)b);
+}
+
+enum class HTTPConnectionState : uint8_t {
+    FREE = 0,
+    READING_HEADERS,
+    READING_BODY,
+    WRITING,
+    STREAMING           // Event stream: kept open, written by publishEvent()
+};
+
+// Part of a connection's request buffer. Method, path and query are
+// also NUL-terminated in place; header values are not.
+struct HTTPSlice {
+    uint16_t offset;
+    uint16_t length;
+};
+
+// What the parser keeps of a request head - no copies, no heap
+struct HTTPRequest {
+    HTTPSlice method;
+    HTTPSlice path;
+    HTTPSlice query;
+    HTTPSlice contentType;
+    HTTPSlice ifNoneMatch;
+    HTTPSlice acceptEncoding;
+    HTTPSlice upgrade;
+    HTTPSlice lastEventId;
+    size_t contentLength;
+    bool http11;
+    bool keepAlive;             // Client allows a persistent connection
+    bool transferEncoding;      // Body framing we don't decode - rejected
+};
+
+// One socket. Handlers get it as their WiFiClient: reads are served from
+// the request the server has already buffered, writes are queued and
+// drained by the server without blocking. What does not fit the queue
+// spills into a heap buffer sent after it, so no write ever waits on the
+// socket; the server gathers queue, spill and body into as few socket
+// sends as possible.
+class HTTPConnection : public WiFiClient {
+public:
+    HTTPConnection();
+    ~HTTPConnection();
+
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size) override;
+    int peek() override;
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    // False also once the response outgrew HTTP_SPILL_LIMIT and was cut
+    uint8_t connected() override;
+
+    // Request being handled, valid until the handler returns
+    const HTTPRequest& getRequest() const { return head; }
+    const char* text(const HTTPSlice& slice) const { return request + slice.offset; }
+    bool equals(const HTTPSlice& slice, const char* value) const;     // Case-insensitive
+    bool contains(const HTTPSlice& slice, const char* token) const;   // Case-insensitive
+
+    // The whole body, received before the handler was called
+    const char* getBody() const { return largeBody ? largeBody : request + headLength; }
+    size_t getBodyLength() const { return head.contentLength; }
+
+    // Values of the {name} segments of the matched route
+    bool getParam(const char* name, HTTPSlice& value) const;
+    long getParamInt(const char* name, long fallback = -1) const;
+
+    // Bytes write() queues right now without waiting on the socket
+    size_t writable() const {
+        return externalLength > 0 || spillLength > 0 ? 0 : sizeof(response) - responseLength;
+    }
+
+private:
+    friend class SimpleHTTPServer;
+    friend class HTTPResponse;
+    friend class HTTPStream;
+
+    HTTPConnectionState state;
+    uint32_t deadline;              // millis() the current phase must finish by
+    uint32_t acceptedAt;
+    uint16_t served;                // Requests dispatched on this socket
+    bool keepAlive;                 // Client asked for it and the server can spare the socket
+    bool persist;                   // Response promised keep-alive, serve the next request after it
+    bool streaming;                 // Handler made this an event stream
+    uint32_t eventInterval;         // Least ms between published events
+    uint32_t lastEvent;
+
+    // Request head and body as received
+    char request[HTTP_REQUEST_BUFFER];
+    size_t requestLength;
+    size_t headLength;              // Up to and including the blank line, 0 until complete
+    size_t parsed;                  // Head bytes already parsed, always a line start
+    HTTPRequest head;
+    const char* pattern;            // Matched route, for parameter names
+    HTTPSlice params[HTTP_MAX_PATH_PARAMS];
+    uint8_t paramCount;
+    size_t bodyPosition;            // Next body byte handed to the handler
+
+    // A body too long to follow the head in `request` (up to
+    // HTTP_BODY_LIMIT) gets a buffer of its own, PSRAM first
+    char* largeBody;
+    size_t largeReceived;
+
+    // Response bytes not yet accepted by the socket
+    uint8_t response[HTTP_RESPONSE_BUFFER];
+    size_t responseLength;
+    size_t responseSent;
+
+    // Written past a full queue, sent after it. Grows on demand up to
+    // HTTP_SPILL_LIMIT, freed when the response is done.
+    uint8_t* spill;
+    size_t spillLength;
+    size_t spillSent;
+    size_t spillCapacity;
+    bool spilled;                   // The current response needed the spill
+    bool cut;                       // ...and outgrew it, the rest is dropped
+
+    // Body sent in place after the queue (mapped flash), never copied
+    const uint8_t* external;
+    size_t externalLength;
+    size_t externalSent;
+
+    HTTPProducer producer;          // Rest of the body, made as the socket takes it
+    uint32_t writes;                // Socket sends for the current response
+
+    void attach(const WiFiClient& client);
+    void release();
+    void nextRequest();
+    void resetResponse();
+    bool allocateBody();
+    void freeBody();
+    bool bodyComplete() const;
+    void sendExternal(const uint8_t* data, size_t length);
+    bool writeResponse(const uint8_t* head, size_t headLength,
+                       const uint8_t* body, size_t bodyLength, bool stable);
+    bool addSpill(const uint8_t* data, size_t length);
+    void push();
+};
+
+// Builds the status line and headers in one buffer and writes them
+// together with the body: a small body is queued right behind the head,
+// a larger one continues in the spill and leaves with it in gathered
+// sends.
+//
+//   HTTPResponse response(client, 200);
+//   response.header("Content-Type", "text/plain");
+//   response.send(text);
+class HTTPResponse {
+public:
+    HTTPResponse(WiFiClient& client, int code);
+
+    // Headers that do not fit HTTP_HEAD_BUFFER are dropped (and logged)
+    HTTPResponse& header(const char* name, const char* value);
+    HTTPResponse& header(const char* name, unsigned long value);
+
+    // Adds Content-Length and Connection and writes head and body
+    bool send(const uint8_t* body, size_t length);
+    bool send(const String& body);
+    bool send() { return send(nullptr, 0); }
+
+    // Same, but `body` stays valid until sent (mapped flash) and is
+    // written from where it is instead of being copied
+    bool sendStatic(const uint8_t* body, size_t length);
+
+    // Head only, with Connection; Content-Length is up to the caller
+    bool sendHead();
+
+    // Head for a body of unknown length, see HTTPStream. Returns whether
+    // the body is chunked (HTTP/1.1) or delimited by closing the socket.
+    bool sendChunked();
+
+private:
+    friend class HTTPStream;
+
+    WiFiClient& client;
+    char head[HTTP_HEAD_BUFFER];
+    size_t length;
+
+    bool append(const char* format, ...);
+    bool write(const uint8_t* body, size_t bodyLength, bool stable);
+};
+
+// Body of a response whose length is not known up front. Sends the head
+// at once, then collects writes in a fixed buffer that goes out as one
+// chunk whenever it fills - any size of response in HTTP_CHUNK_BUFFER
+// bytes. Ends the body when destroyed if end() was not called.
+//
+//   HTTPResponse response(client, 200);
+//   response.header("Content-Type", "text/csv");
+//   HTTPStream stream(response);
+//   stream.printf(...);
+class HTTPStream : public Print {
+public:
+    explicit HTTPStream(HTTPResponse& response);
+    ~HTTPStream();
+
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    // False once the client has gone - stop producing
+    bool connected();
+
+    // Whether one more chunk fits the connection's queue. A producer (see
+    // SimpleHTTPServer::produce()) writes while this holds, then returns.
+    bool writable();
+
+    // Sends what is buffered and the terminating chunk
+    void end();
+
+private:
+    WiFiClient& client;
+    bool chunked;
+    bool ended;
+    uint8_t buffer[HTTP_CHUNK_RESERVE + HTTP_CHUNK_BUFFER + 2];     // Size line, data, CRLF
+    size_t used;
+
+    void sendChunk();
+};
+
+// Web asset from the bundle partition or SPIFFS, validator computed
+// when the server starts
+struct StaticAsset {
+    String path;
+    uint32_t size;
+    char etag[20];              // Quoted FNV-1a of the contents and the size
+    const uint8_t* data;        // Mapped flash, nullptr when on SPIFFS
+};
+
+struct HTTPServerStats {
+    uint32_t accepted;
+    uint32_t requests;
+    uint32_t reused;            // Requests on an already used keep-alive socket
+    uint32_t timeouts;
+    uint32_t rejected;          // Malformed or oversized requests
+    uint32_t spilled;           // Responses that overflowed the write queue
+    uint32_t writes;            // Socket sends, for segments per response
+    uint32_t eventsSent;        // Frames queued on event streams
+    uint32_t eventsDropped;     // Frames a stream had no queue space for
+    uint16_t open;              // Sockets currently served
+    uint16_t maxOpen;
+    uint32_t maxServiceUs;      // Longest handleClient() pass
+};
+
 // Simple HTTP server optimized for ESP32
 class SimpleHTTPServer {
 public:
@@ -22,14 +293,39 @@ public:
     // Server control
     bool begin(uint16_t port = 80);
     void stop();
+
+    // Accepts, reads, dispatches and writes for all open connections -
+    // never waits on a socket, call every loop pass
     void handleClient();
 
-    // Route registration
+    // Route registration, before begin(). Segments written as {name}
+    // match any one path segment; fixed segments take precedence.
     void on(const String& path, HTTPHandler handler);
+    void on(HTTPMethod methods, const String& path, HTTPHandler handler);
+
+    // Server-sent events. A handler turns its connection into a stream
+    // that stays open after it returns (false if HTTP_MAX_EVENT_STREAMS
+    // are open); publishEvent() queues one encoded frame on every stream
+    // whose interval has passed, without waiting on any socket.
+    bool beginEventStream(WiFiClient& client, uint32_t intervalMs);
+    void publishEvent(const char* frame, size_t length);
+    uint8_t getEventStreamCount() const;
 
     // Server info
     bool isRunning() const { return running; }
     uint16_t getPort() const { return serverPort; }
+    HTTPServerStats getStats() const { return stats; }
+
+    // Serve the bundle's files ahead of SPIFFS; set before begin()
+    static void setAssetBundle(AssetBundle* bundle) { assetBundle = bundle; }
+
+    // Hashes the web assets on SPIFFS for ETags (begin() does this;
+    // call again after replacing files at runtime)
+    static void indexAssets();
+    static const StaticAsset* findAsset(const String& path);
+
+    // The connection behind `client` while its handler runs, else nullptr
+    static HTTPConnection* connectionOf(WiFiClient& client);
 
     // Helper methods for responses
     static void send(WiFiClient& client, int code, const String& contentType, const String& content);
@@ -37,28 +333,90 @@ public:
     static void redirect(WiFiClient& client, const String& location);
     static void sendFile(WiFiClient& client, const String& path);
 
+    // Hands the rest of the response body to `producer`. handleClient()
+    // calls it whenever everything written before has gone out, until it
+    // returns false; each call should add a bounded piece (about
+    // HTTP_RESPONSE_BUFFER bytes), so a long body never holds up the loop.
+    // Captured state lives as long as the producer.
+    static void produce(WiFiClient& client, HTTPProducer producer);
+
+    // Decoded value of a query string parameter, empty if absent
+    static String getQueryParam(const String& query, const String& name);
+
+    // Value for the Connection header of the response being written to
+    // `client`. "keep-alive" also tells the server to keep the socket
+    // open, so only use it for responses with a Content-Length.
+    static const char* connectionHeader(WiFiClient& client);
+
+    static const char* statusText(int code);
+    static HTTPMethod methodOf(const char* name);
+
 private:
     struct Route {
         String path;
+        HTTPMethod methods;
         HTTPHandler handler;
     };
 
+    // Segment trie, built from `routes` by begin(). Children of a node
+    // are contiguous, so lookup is one pass over the path comparing
+    // segment hashes - no allocation.
+    struct RouteNode {
+        uint32_t hash;          // FNV-1a of the segment
+        uint16_t text;          // Segment in routeText
+        uint16_t length;
+        uint16_t firstChild;
+        uint16_t childCount;
+        uint16_t param;         // {name} child, HTTP_ROUTE_NONE if none
+        uint16_t firstRoute;    // Routes ending here, in routeSlots
+        uint16_t routeCount;
+    };
+
     WiFiServer server;
     std::vector<Route> routes;
+    std::vector<RouteNode> routeNodes;
+    std::vector<uint16_t> routeSlots;
+    String routeText;
     uint16_t serverPort;
     bool running;
+    HTTPConnection* connections;
+    HTTPServerStats stats;
+
+    static HTTPConnection* current;     // Connection whose handler is running
+    static std::vector<StaticAsset> assets;     // Sorted by path
+    static AssetBundle* assetBundle;
+
+    void acceptClients();
+    void service(HTTPConnection& connection);
+    bool receive(HTTPConnection& connection);
+    void serviceStream(HTTPConnection& connection, bool expired);
+    void dispatch(HTTPConnection& connection);
+    bool drain(HTTPConnection& connection);
+    bool runProducer(HTTPConnection& connection);
+    void fail(HTTPConnection& connection, int code);
+    void close(HTTPConnection& connection);
+    bool allowKeepAlive(HTTPConnection& connection);
+    int heldConnections(const HTTPConnection& except) const;
 
     // Request parsing
-    bool parseRequest(WiFiClient& client, String& method, String& path, String& query);
+    bool parseHead(HTTPConnection& connection);
+    bool parseRequestLine(HTTPConnection& connection, size_t offset, size_t length);
+    bool parseHeader(HTTPConnection& connection, size_t offset, size_t length);
 
     // Route matching
-    Route* findRoute(const String& path);
+    void buildRoutes();
+    Route* findRoute(HTTPConnection& connection, const char* path, HTTPMethod method, uint8_t& allowed);
+    void sendMethodNotAllowed(WiFiClient& client, uint8_t allowed);
 
     // Default handlers
     void handleNotFound(WiFiClient& client);
 
     // Helper methods
     static String getContentType(const String& path);
+    static bool acceptsGzip(WiFiClient& client);
+    static const StaticAsset* findAsset(const String& path, size_t count);
+    static bool isWebAsset(const String& path);
+    static const char* cacheControl(const String& path);
     static String urlDecode(const String& str);
 };
 
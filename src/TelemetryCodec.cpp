@@ -0,0 +1,72 @@
+// TelemetryCodec.cpp
+// Telemetry sample and log block layout, and the delta/varint record codec
+
+#include "TelemetryCodec.h"
+
+size_t TelemetryCodec::encode(uint8_t* out, const TelemetryRecord& previous, const TelemetryRecord& record) {
+    uint8_t flags = 0;
+    if (record.frequency != previous.frequency) flags |= TELEMETRY_DELTA_FREQUENCY;
+    if (record.current != previous.current) flags |= TELEMETRY_DELTA_CURRENT;
+    if (record.voltage != previous.voltage) flags |= TELEMETRY_DELTA_VOLTAGE;
+    if (record.statusWord != previous.statusWord) flags |= TELEMETRY_DELTA_STATUS;
+
+    size_t length = 0;
+    out[length++] = flags;
+    length += putVarint(out + length, record.time - previous.time);
+    if (flags & TELEMETRY_DELTA_FREQUENCY) {
+        length += putVarint(out + length, zigzag((int32_t)record.frequency - previous.frequency));
+    }
+    if (flags & TELEMETRY_DELTA_CURRENT) {
+        length += putVarint(out + length, zigzag((int32_t)record.current - previous.current));
+    }
+    if (flags & TELEMETRY_DELTA_VOLTAGE) {
+        length += putVarint(out + length, zigzag((int32_t)record.voltage - previous.voltage));
+    }
+    if (flags & TELEMETRY_DELTA_STATUS) {
+        length += putVarint(out + length, zigzag((int32_t)record.statusWord - previous.statusWord));
+    }
+    return length;
+}
+
+size_t TelemetryCodec::decode(const uint8_t* in, size_t length, const TelemetryRecord& previous, TelemetryRecord& record) {
+    if (length == 0) return 0;
+
+    uint8_t flags = in[0];
+    size_t position = 1;
+    uint32_t value;
+
+    size_t used = getVarint(in + position, length - position, value);
+    if (used == 0) return 0;
+    position += used;
+    record = previous;
+    record.time += value;
+
+    uint16_t* fields[4] = { &record.frequency, &record.current, &record.voltage, &record.statusWord };
+    for (uint8_t i = 0; i < 4; i++) {
+        if (!(flags & (1 << i))) continue;
+        used = getVarint(in + position, length - position, value);
+        if (used == 0) return 0;
+        position += used;
+        *fields[i] += unzigzag(value);
+    }
+    return position;
+}
+
+size_t TelemetryCodec::putVarint(uint8_t* out, uint32_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+size_t TelemetryCodec::getVarint(const uint8_t* in, size_t length, uint32_t& value) {
+    value = 0;
+    for (size_t i = 0; i < length && i < 5; i++) {
+        value |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+        if (!(in[i] & 0x80)) return i + 1;
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+// TelemetryCodec.h
+// Telemetry sample and log block layout, and the delta/varint record codec
+
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+// No framework includes - the native unit tests build this on the host
+#include <stdint.h>
+#include <stddef.h>
+#include "Config.h"
+
+// One sample: 12 bytes, fixed point in the drive's own register units
+struct TelemetryRecord {
+    uint32_t time;          // millis() when the status was read
+    uint16_t frequency;     // Output frequency (Hz x100)
+    uint16_t current;       // Output current (A x100)
+    uint16_t voltage;       // Output voltage (V x10)
+    uint16_t statusWord;    // 0x2101 as read
+};
+
+static_assert(sizeof(TelemetryRecord) == 12, "TelemetryRecord must stay packed");
+
+#define TELEMETRY_LOG_MAGIC      0x31424C54  // "TLB1"
+#define TELEMETRY_LOG_MAX_RECORD 18          // Flags + time + four field deltas, worst case
+
+// Field-changed flags leading each encoded record
+#define TELEMETRY_DELTA_FREQUENCY 0x01
+#define TELEMETRY_DELTA_CURRENT   0x02
+#define TELEMETRY_DELTA_VOLTAGE   0x04
+#define TELEMETRY_DELTA_STATUS    0x08
+
+// Start of every block. The base record is stored as-is; each following
+// record is a flags byte, the time delta (varint) and zigzag varint
+// deltas of the fields that changed - 2-3 bytes for a steady drive.
+struct TelemetryBlockHeader {
+    uint32_t magic;
+    uint16_t count;         // Records, incl. the base
+    uint16_t length;        // Encoded bytes after the header
+    uint32_t epoch;         // RTC time of the base record, 0 if the clock was unset
+    uint32_t lastTime;      // millis() of the last record
+    TelemetryRecord base;
+};
+
+// Encoded bytes a block holds after its header
+#define TELEMETRY_LOG_PAYLOAD   (TELEMETRY_LOG_BLOCK - sizeof(TelemetryBlockHeader))
+
+class TelemetryCodec {
+public:
+    // `previous` is the record before in the block. encode() writes at
+    // most TELEMETRY_LOG_MAX_RECORD bytes; decode() returns 0 for a
+    // truncated record.
+    static size_t encode(uint8_t* out, const TelemetryRecord& previous, const TelemetryRecord& record);
+    static size_t decode(const uint8_t* in, size_t length, const TelemetryRecord& previous, TelemetryRecord& record);
+
+    static size_t putVarint(uint8_t* out, uint32_t value);
+    static size_t getVarint(const uint8_t* in, size_t length, uint32_t& value);
+
+    static uint32_t zigzag(int32_t value) {
+        return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    }
+    static int32_t unzigzag(uint32_t value) {
+        return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+    }
+};
+
+#endif // TELEMETRY_CODEC_H
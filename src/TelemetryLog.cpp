@@ -0,0 +1,342 @@
+// TelemetryLog.cpp
+// Long-term telemetry on SPIFFS: delta/varint-packed blocks in rotating files
+
+#include "TelemetryLog.h"
+#include <SPIFFS.h>
+
+TelemetryLog::TelemetryLog(CalendarScheduler& clock) :
+    clock(clock),
+    task(nullptr),
+    fileMutex(nullptr),
+    memory(nullptr),
+    readBlock(nullptr),
+    readFile(0),
+    readIndex(0),
+    readValid(false),
+    active(0),
+    pending(-1),
+    hasPrevious(false),
+    fileBlocks(0)
+{
+    blocks[0] = nullptr;
+    blocks[1] = nullptr;
+    memset(&previous, 0, sizeof(previous));
+    memset(&stats, 0, sizeof(stats));
+}
+
+TelemetryLog::~TelemetryLog() {
+    if (task) {
+        vTaskDelete(task);
+    }
+    if (fileMutex) {
+        vSemaphoreDelete(fileMutex);
+    }
+    if (memory) {
+        heap_caps_free(memory);
+    }
+}
+
+bool TelemetryLog::begin() {
+    if (task) return true;
+
+    size_t size = 3 * TELEMETRY_LOG_BLOCK;
+    memory = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (!memory) {
+        memory = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    fileMutex = xSemaphoreCreateMutex();
+    if (!memory || !fileMutex) {
+        DEBUG_PRINTLN("TelemetryLog: Allocation failed");
+        return false;
+    }
+    blocks[0] = memory;
+    blocks[1] = memory + TELEMETRY_LOG_BLOCK;
+    readBlock = memory + 2 * TELEMETRY_LOG_BLOCK;
+
+    scanFiles();
+
+    // Flash writes stall the writing task for tens of ms - keep them off
+    // the loop and the control tasks
+    BaseType_t created = xTaskCreatePinnedToCore(
+        taskEntry,
+        "TelemetryLog",
+        VFD_CONTROL_TASK_STACK,
+        this,
+        TELEMETRY_LOG_TASK_PRIORITY,
+        &task,
+        TELEMETRY_LOG_TASK_CORE
+    );
+    if (created != pdPASS) {
+        task = nullptr;
+        DEBUG_PRINTLN("TelemetryLog: Failed to create task");
+        return false;
+    }
+
+    DEBUG_PRINTF("TelemetryLog: Files %u-%u, %u blocks in the newest\n",
+                 stats.firstFile, stats.lastFile, fileBlocks);
+    return true;
+}
+
+void TelemetryLog::append(const TelemetryRecord& record) {
+    if (!task) return;
+    if (hasPrevious && record.time - previous.time < TELEMETRY_LOG_INTERVAL_MS) return;
+
+    uint8_t* block = blocks[active];
+    TelemetryBlockHeader* header = (TelemetryBlockHeader*)block;
+
+    if (!hasPrevious) {
+        startBlock(block, record);
+    } else if (header->length + (size_t)TELEMETRY_LOG_MAX_RECORD > TELEMETRY_LOG_PAYLOAD) {
+        // Full - hand it to the writer and carry on in the other block. If
+        // the writer hasn't finished the last one, lose this sample rather
+        // than wait on flash.
+        if (pending >= 0) {
+            portENTER_CRITICAL(&lock);
+            stats.dropped++;
+            portEXIT_CRITICAL(&lock);
+            return;
+        }
+        memset(block + sizeof(TelemetryBlockHeader) + header->length, 0xFF, TELEMETRY_LOG_PAYLOAD - header->length);
+        pending = active;
+        xTaskNotifyGive(task);
+
+        active ^= 1;
+        startBlock(blocks[active], record);
+    } else {
+        // A block started before the clock was set gets its RTC time as
+        // soon as the clock is valid
+        if (header->epoch == 0 && clock.isClockValid()) {
+            header->epoch = clock.now() - (record.time - header->base.time) / 1000;
+        }
+        header->length += TelemetryCodec::encode(block + sizeof(TelemetryBlockHeader) + header->length, previous, record);
+        header->count++;
+        header->lastTime = record.time;
+    }
+
+    previous = record;
+    hasPrevious = true;
+
+    portENTER_CRITICAL(&lock);
+    stats.recordsLogged++;
+    portEXIT_CRITICAL(&lock);
+}
+
+void TelemetryLog::start(TelemetryLogCursor& cursor, uint32_t from, uint32_t to, uint32_t step) {
+    memset(&cursor, 0, sizeof(cursor));
+    cursor.from = from;
+    cursor.to = to;
+    cursor.step = step;
+    cursor.nextEmit = from;
+    cursor.file = getStats().firstFile;
+}
+
+bool TelemetryLog::resume(TelemetryLogCursor& cursor, TelemetryLogCallback callback) {
+    if (!task || cursor.done) return false;
+
+    xSemaphoreTake(fileMutex, portMAX_DELAY);
+    uint32_t firstFile = stats.firstFile;
+    uint32_t lastFile = stats.lastFile;
+    xSemaphoreGive(fileMutex);
+
+    // Rotation removed the file the cursor was in - go on with the oldest left
+    if ((int32_t)(cursor.file - firstFile) < 0) {
+        cursor.file = firstFile;
+        cursor.index = 0;
+        cursor.record = 0;
+    }
+
+    const TelemetryBlockHeader* header = (const TelemetryBlockHeader*)readBlock;
+    const uint8_t* payload = readBlock + sizeof(TelemetryBlockHeader);
+    bool read = false;
+
+    for (;;) {
+        // One block from flash per call; the one already in readBlock is free
+        bool cached = readValid && readFile == cursor.file && readIndex == cursor.index;
+        if (!cached) {
+            if (read) return true;
+            read = true;
+        }
+
+        // Stops at the end of the file, or where rotation removed it
+        if (!readBlockAt(cursor.file, cursor.index)) {
+            if ((int32_t)(cursor.file - lastFile) >= 0) {
+                cursor.done = true;
+                return false;
+            }
+            cursor.file++;
+            cursor.index = 0;
+            cursor.record = 0;
+            continue;
+        }
+
+        if (cursor.record == 0) {
+            uint32_t blockEnd = header->epoch + (header->lastTime - header->base.time) / 1000;
+            if (header->epoch == 0 || blockEnd < cursor.from || header->epoch > cursor.to) {
+                cursor.index++;
+                continue;
+            }
+            cursor.position = 0;
+        }
+
+        while (cursor.record < header->count) {
+            TelemetryRecord record = header->base;
+            if (cursor.record > 0) {
+                size_t used = TelemetryCodec::decode(payload + cursor.position, header->length - cursor.position,
+                                                     cursor.previous, record);
+                if (used == 0) break;
+                cursor.position += used;
+            }
+            cursor.previous = record;
+            cursor.record++;
+
+            uint32_t epoch = header->epoch + (record.time - header->base.time) / 1000;
+            if (epoch < cursor.nextEmit) continue;
+            if (epoch > cursor.to) break;
+            if (cursor.step > 0) {
+                cursor.nextEmit = epoch - epoch % cursor.step + cursor.step;
+            }
+            if (!callback(epoch, record)) return true;
+        }
+
+        cursor.index++;
+        cursor.record = 0;
+    }
+}
+
+TelemetryLogStats TelemetryLog::getStats() {
+    portENTER_CRITICAL(&lock);
+    TelemetryLogStats copy = stats;
+    portEXIT_CRITICAL(&lock);
+    return copy;
+}
+
+void TelemetryLog::taskEntry(void* param) {
+    static_cast<TelemetryLog*>(param)->run();
+}
+
+void TelemetryLog::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        int8_t index = pending;
+        if (index < 0) continue;
+        writeBlock(blocks[index]);
+        pending = -1;
+    }
+}
+
+void TelemetryLog::startBlock(uint8_t* block, const TelemetryRecord& record) {
+    TelemetryBlockHeader* header = (TelemetryBlockHeader*)block;
+    header->magic = TELEMETRY_LOG_MAGIC;
+    header->count = 1;
+    header->length = 0;
+    header->epoch = clock.isClockValid() ? clock.now() : 0;
+    header->lastTime = record.time;
+    header->base = record;
+}
+
+void TelemetryLog::writeBlock(const uint8_t* block) {
+    xSemaphoreTake(fileMutex, portMAX_DELAY);
+
+    // Rotate: new file once the newest is full, drop the oldest over the cap
+    if (fileBlocks >= TELEMETRY_LOG_FILE_BLOCKS) {
+        portENTER_CRITICAL(&lock);
+        stats.lastFile++;
+        portEXIT_CRITICAL(&lock);
+        fileBlocks = 0;
+
+        while (stats.lastFile - stats.firstFile >= TELEMETRY_LOG_MAX_FILES) {
+            SPIFFS.remove(path(stats.firstFile));
+            portENTER_CRITICAL(&lock);
+            stats.firstFile++;
+            portEXIT_CRITICAL(&lock);
+        }
+    }
+
+    uint32_t start = micros();
+    File file = SPIFFS.open(path(stats.lastFile), FILE_APPEND);
+    bool ok = file && file.write(block, TELEMETRY_LOG_BLOCK) == TELEMETRY_LOG_BLOCK;
+    if (file) {
+        file.close();
+    }
+
+    if (ok) {
+        fileBlocks++;
+    } else {
+        // A short write would misalign every block after it - start over
+        // in a new file
+        fileBlocks = TELEMETRY_LOG_FILE_BLOCKS;
+        DEBUG_PRINTF("TelemetryLog: Write to %s failed\n", path(stats.lastFile).c_str());
+    }
+
+    portENTER_CRITICAL(&lock);
+    if (ok) {
+        stats.blocksWritten++;
+    } else {
+        stats.writeErrors++;
+    }
+    stats.lastWriteUs = micros() - start;
+    portEXIT_CRITICAL(&lock);
+
+    xSemaphoreGive(fileMutex);
+}
+
+void TelemetryLog::scanFiles() {
+    bool found = false;
+    uint32_t first = 0;
+    uint32_t last = 0;
+    size_t lastSize = 0;
+
+    File dir = SPIFFS.open(TELEMETRY_LOG_DIR);
+    File file = dir.openNextFile();
+    while (file) {
+        String entry = file.name();
+        int slash = entry.lastIndexOf('/');
+        if (slash != -1) entry = entry.substring(slash + 1);
+        if (entry.endsWith(".blk")) {
+            uint32_t number = strtoul(entry.c_str(), nullptr, 10);
+            if (!found || number < first) first = number;
+            if (!found || number >= last) {
+                last = number;
+                lastSize = file.size();
+            }
+            found = true;
+        }
+        file = dir.openNextFile();
+    }
+
+    stats.firstFile = first;
+    stats.lastFile = last;
+    fileBlocks = lastSize / TELEMETRY_LOG_BLOCK;
+    if (lastSize % TELEMETRY_LOG_BLOCK != 0) {
+        // Cut short by a reset mid-write; keep appends block-aligned
+        fileBlocks = TELEMETRY_LOG_FILE_BLOCKS;
+    }
+}
+
+bool TelemetryLog::readBlockAt(uint32_t file, uint32_t index) {
+    // Flushed blocks never change, only whole files go
+    if (readValid && readFile == file && readIndex == index) return true;
+
+    xSemaphoreTake(fileMutex, portMAX_DELAY);
+    bool ok = false;
+    File handle = SPIFFS.open(path(file), FILE_READ);
+    if (handle) {
+        ok = handle.size() >= (index + 1) * TELEMETRY_LOG_BLOCK &&
+             handle.seek(index * TELEMETRY_LOG_BLOCK) &&
+             handle.read(readBlock, TELEMETRY_LOG_BLOCK) == TELEMETRY_LOG_BLOCK;
+        handle.close();
+    }
+    xSemaphoreGive(fileMutex);
+
+    const TelemetryBlockHeader* header = (const TelemetryBlockHeader*)readBlock;
+    readValid = ok && header->magic == TELEMETRY_LOG_MAGIC &&
+                header->count > 0 && header->length <= TELEMETRY_LOG_PAYLOAD;
+    readFile = file;
+    readIndex = index;
+    return readValid;
+}
+
+String TelemetryLog::path(uint32_t file) {
+    return String(TELEMETRY_LOG_DIR) + "/" + String(file) + ".blk";
+}
@@ -0,0 +1,105 @@
+// TelemetryLog.h
+// Long-term telemetry on SPIFFS: delta/varint-packed blocks in rotating files
+
+#ifndef TELEMETRY_LOG_H
+#define TELEMETRY_LOG_H
+
+#include <Arduino.h>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include "Config.h"
+#include "TelemetryRing.h"
+#include "TelemetryCodec.h"
+#include "CalendarScheduler.h"
+
+struct TelemetryLogStats {
+    uint32_t firstFile;     // Oldest and newest file number
+    uint32_t lastFile;
+    uint32_t blocksWritten; // Since boot
+    uint32_t recordsLogged;
+    uint32_t dropped;       // Block completed while the previous one was still being written
+    uint32_t writeErrors;
+    uint32_t lastWriteUs;   // Duration of the last block write
+};
+
+// Called per decoded record with its RTC time; return false to pause
+using TelemetryLogCallback = std::function<bool(uint32_t epoch, const TelemetryRecord& record)>;
+
+// Where a query stands between TelemetryLog::resume() calls
+struct TelemetryLogCursor {
+    uint32_t from;              // Range in RTC seconds
+    uint32_t to;
+    uint32_t step;
+    uint32_t nextEmit;          // Earliest epoch passed on next
+    uint32_t file;              // Block being decoded
+    uint32_t index;
+    uint16_t record;            // Records of it already decoded, 0 = not started
+    size_t position;            // Payload offset of the next record
+    TelemetryRecord previous;   // Last record decoded, base of the next delta
+    bool done;
+};
+
+class TelemetryLog {
+public:
+    TelemetryLog(CalendarScheduler& clock);
+    ~TelemetryLog();
+
+    // Finds the existing files and starts the writer task (mount SPIFFS first)
+    bool begin();
+
+    // Encodes into the RAM block, no flash access; a full block is handed
+    // to the writer task. Samples closer than TELEMETRY_LOG_INTERVAL_MS
+    // to the previous one are skipped.
+    void append(const TelemetryRecord& record);
+
+    // A query over the flushed blocks covering [from, to] (RTC seconds),
+    // oldest first, decoded a piece at a time: each resume() reads at
+    // most one block from flash and passes its records in range to
+    // `callback` until that returns false. Returns false once the range
+    // is done. With step > 0 only the first record of each step-second
+    // interval is passed on. Blocks logged before the clock was set have
+    // no RTC time and are left out.
+    void start(TelemetryLogCursor& cursor, uint32_t from, uint32_t to, uint32_t step);
+    bool resume(TelemetryLogCursor& cursor, TelemetryLogCallback callback);
+
+    TelemetryLogStats getStats();
+
+    // The clock records are stamped with
+    uint32_t now() { return clock.now(); }
+    bool isClockValid() const { return clock.isClockValid(); }
+
+private:
+    CalendarScheduler& clock;
+    TaskHandle_t task;
+    SemaphoreHandle_t fileMutex;    // Writer vs. queries around file rotation
+
+    // Two blocks in RAM: one filling, one waiting for the writer. Plus a
+    // block for decoding queries. All from one allocation, PSRAM first.
+    uint8_t* memory;
+    uint8_t* blocks[2];
+    uint8_t* readBlock;
+    uint32_t readFile;              // What readBlock holds, so a resumed
+    uint32_t readIndex;             // query doesn't read it again
+    bool readValid;
+    uint8_t active;
+    volatile int8_t pending;        // Block index waiting to be written, -1 if none
+    TelemetryRecord previous;
+    bool hasPrevious;
+
+    uint32_t fileBlocks;            // Blocks in the newest file
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    TelemetryLogStats stats;
+
+    static void taskEntry(void* param);
+    void run();
+    void startBlock(uint8_t* block, const TelemetryRecord& record);
+    void writeBlock(const uint8_t* block);
+    void scanFiles();
+    bool readBlockAt(uint32_t file, uint32_t index);
+
+    static String path(uint32_t file);
+};
+
+#endif // TELEMETRY_LOG_H
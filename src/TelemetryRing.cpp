@@ -0,0 +1,182 @@
+// TelemetryRing.cpp
+// Fixed-size history of every polled drive sample, kept in PSRAM
+
+#include "TelemetryRing.h"
+
+TelemetryRing::TelemetryRing() :
+    buffer(nullptr),
+    mask(0),
+    head(0),
+    psram(false)
+{
+}
+
+TelemetryRing::~TelemetryRing() {
+    if (buffer) {
+        heap_caps_free(buffer);
+    }
+}
+
+bool TelemetryRing::begin() {
+    if (buffer) return true;
+
+    uint32_t capacity = TELEMETRY_RING_RECORDS;
+    buffer = (TelemetryRecord*)heap_caps_malloc(capacity * sizeof(TelemetryRecord), MALLOC_CAP_SPIRAM);
+    psram = buffer != nullptr;
+    if (!buffer) {
+        capacity = TELEMETRY_RING_FALLBACK_RECORDS;
+        buffer = (TelemetryRecord*)heap_caps_malloc(capacity * sizeof(TelemetryRecord), MALLOC_CAP_8BIT);
+    }
+    if (!buffer) {
+        DEBUG_PRINTLN("TelemetryRing: Allocation failed");
+        return false;
+    }
+
+    mask = capacity - 1;
+    head = 0;
+
+    DEBUG_PRINTF("TelemetryRing: %u records (%u KB) in %s, %.1f h at the poll rate\n",
+                 capacity, capacity * sizeof(TelemetryRecord) / 1024,
+                 psram ? "PSRAM" : "internal RAM",
+                 capacity * (VFD_POLL_INTERVAL / 1000.0) / 3600.0);
+    return true;
+}
+
+void TelemetryRing::append(const TelemetryRecord& record) {
+    if (!buffer) return;
+
+    // Fill the slot before publishing it through head, so a reader never
+    // sees a half-written newest record
+    buffer[head & mask] = record;
+
+    portENTER_CRITICAL(&lock);
+    head++;
+    portEXIT_CRITICAL(&lock);
+}
+
+TelemetryRecord TelemetryRing::toRecord(const VFDStatus& status) {
+    TelemetryRecord record;
+    record.time = status.lastUpdateTime;
+    record.frequency = (uint16_t)(status.actualFrequency * 100 + 0.5);
+    record.current = (uint16_t)(status.outputCurrent * 100 + 0.5);
+    record.voltage = (uint16_t)(status.outputVoltage * 10 + 0.5);
+    record.statusWord = status.statusWord;
+    return record;
+}
+
+uint32_t TelemetryRing::firstSequence() {
+    portENTER_CRITICAL(&lock);
+    uint32_t first = firstLocked();
+    portEXIT_CRITICAL(&lock);
+    return first;
+}
+
+uint32_t TelemetryRing::endSequence() {
+    portENTER_CRITICAL(&lock);
+    uint32_t end = head;
+    portEXIT_CRITICAL(&lock);
+    return end;
+}
+
+bool TelemetryRing::isRetained(uint32_t sequence) {
+    portENTER_CRITICAL(&lock);
+    bool retained = sequence - firstLocked() < head - firstLocked();
+    portEXIT_CRITICAL(&lock);
+    return retained;
+}
+
+uint32_t TelemetryRing::findTime(uint32_t time) {
+    portENTER_CRITICAL(&lock);
+    uint32_t first = firstLocked();
+    uint32_t end = head;
+    portEXIT_CRITICAL(&lock);
+
+    if (!buffer || first == end) return end;
+
+    // Compare ages against the newest sample rather than raw millis(), so
+    // the search still works across the 49-day wrap
+    uint32_t newest = buffer[(end - 1) & mask].time;
+    if ((int32_t)(time - newest) > 0) return end;
+    uint32_t age = newest - time;
+
+    // Ages fall with the sequence; find the first one no older than `age`
+    uint32_t low = first;
+    uint32_t high = end - 1;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (newest - buffer[middle & mask].time > age) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+size_t TelemetryRing::segment(uint32_t sequence, size_t max, const TelemetryRecord*& records) {
+    portENTER_CRITICAL(&lock);
+    uint32_t first = firstLocked();
+    uint32_t end = head;
+    portEXIT_CRITICAL(&lock);
+
+    if (!buffer || sequence - first >= end - first) return 0;
+
+    uint32_t index = sequence & mask;
+    size_t count = min((size_t)(end - sequence), (size_t)(mask + 1 - index));
+    records = buffer + index;
+    return min(count, max);
+}
+
+bool TelemetryRing::getRecord(uint32_t sequence, TelemetryRecord& record) {
+    const TelemetryRecord* records;
+    if (segment(sequence, 1, records) == 0) return false;
+    record = records[0];
+    return isRetained(sequence);
+}
+
+TrendAggregator::TrendAggregator(uint32_t from, uint32_t width, TrendCallback emit) :
+    from(from),
+    width(width > 0 ? width : 1),
+    emit(emit),
+    stopped(false)
+{
+    bucket.count = 0;
+}
+
+bool TrendAggregator::add(const TelemetryRecord& record) {
+    if (stopped) return false;
+
+    uint16_t values[TREND_CHANNELS] = { record.frequency, record.current, record.voltage };
+    uint32_t index = (record.time - from) / width;
+
+    if (bucket.count > 0 && index != bucket.index) {
+        if (!emit(bucket)) {
+            stopped = true;
+            return false;
+        }
+        bucket.count = 0;
+    }
+    if (bucket.count == 0) {
+        bucket.index = index;
+        for (uint8_t c = 0; c < TREND_CHANNELS; c++) {
+            bucket.min[c] = values[c];
+            bucket.max[c] = values[c];
+            bucket.sum[c] = 0;
+        }
+    }
+
+    bucket.count++;
+    for (uint8_t c = 0; c < TREND_CHANNELS; c++) {
+        if (values[c] < bucket.min[c]) bucket.min[c] = values[c];
+        if (values[c] > bucket.max[c]) bucket.max[c] = values[c];
+        bucket.sum[c] += values[c];
+    }
+    return true;
+}
+
+void TrendAggregator::finish() {
+    if (bucket.count > 0 && !stopped) {
+        emit(bucket);
+    }
+    bucket.count = 0;
+}
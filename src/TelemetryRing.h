@@ -0,0 +1,97 @@
+// TelemetryRing.h
+// Fixed-size history of every polled drive sample, kept in PSRAM
+
+#ifndef TELEMETRY_RING_H
+#define TELEMETRY_RING_H
+
+#include <Arduino.h>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include "Config.h"
+#include "ModbusVFD.h"
+#include "TelemetryCodec.h"
+
+// Frequency, current, voltage - in record units
+#define TREND_CHANNELS  3
+
+// Aggregate of the samples falling into one time bucket
+struct TrendBucket {
+    uint32_t index;         // Bucket number counted from the query start
+    uint32_t count;
+    uint16_t min[TREND_CHANNELS];
+    uint16_t max[TREND_CHANNELS];
+    uint64_t sum[TREND_CHANNELS];
+};
+
+// Receives each non-empty bucket in time order; return false to stop
+using TrendCallback = std::function<bool(const TrendBucket& bucket)>;
+
+// Folds samples into buckets of `width` ms starting at `from`, handing
+// each to `emit` once a later sample shows it complete. Samples may come
+// from more than one source as long as they arrive in time order, and
+// in as many calls as suits the caller; memory use is one bucket however
+// long the range.
+class TrendAggregator {
+public:
+    TrendAggregator(uint32_t from, uint32_t width, TrendCallback emit);
+
+    // False once `emit` has asked to stop
+    bool add(const TelemetryRecord& record);
+
+    // Hands over the last bucket
+    void finish();
+
+private:
+    uint32_t from;
+    uint32_t width;
+    TrendCallback emit;
+    TrendBucket bucket;
+    bool stopped;
+};
+
+class TelemetryRing {
+public:
+    TelemetryRing();
+    ~TelemetryRing();
+
+    // Allocates the buffer once - PSRAM if present, a small internal
+    // RAM ring otherwise
+    bool begin();
+
+    // O(1), no allocation; overwrites the oldest record when full
+    void append(const TelemetryRecord& record);
+
+    // Packs a status snapshot into the drive's fixed-point units
+    static TelemetryRecord toRecord(const VFDStatus& status);
+
+    // Records are numbered by a running sequence; [first, end) is retained
+    uint32_t firstSequence();
+    uint32_t endSequence();
+    bool isRetained(uint32_t sequence);
+
+    // First sequence with a sample at or after `time` (millis(), wrap-safe
+    // within the ring's span); endSequence() if there is none
+    uint32_t findTime(uint32_t time);
+
+    // Points `records` at the contiguous run starting at `sequence` -
+    // stops at the buffer's wrap point or after `max`. Returns the run
+    // length, 0 if the sequence is no longer (or not yet) retained.
+    size_t segment(uint32_t sequence, size_t max, const TelemetryRecord*& records);
+
+    // Copy of one record, false if it is no longer retained
+    bool getRecord(uint32_t sequence, TelemetryRecord& record);
+
+    uint32_t getCapacity() const { return mask + 1; }
+    bool inPSRAM() const { return psram; }
+
+private:
+    TelemetryRecord* buffer;
+    uint32_t mask;              // Capacity - 1 (capacity is a power of two)
+    uint32_t head;              // Sequence of the next record written
+    bool psram;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    uint32_t firstLocked() const { return head > mask ? head - mask - 1 : 0; }
+};
+
+#endif // TELEMETRY_RING_H
@@ -1,10 +1,23 @@
 #include "WebInterface.h"
 #include "Config.h"
+#include <SPIFFS.h>
+#include <memory>
+#include "JsonWriter.h"
 
 WebInterface::WebInterface(ModbusVFD& vfd) :
     vfd(vfd),
-    lastStatusUpdate(0),
-    lastVFDUpdate(0)
+    driveGroup(nullptr),
+    followerLoop(nullptr),
+    pidLoop(nullptr),
+    autotuner(nullptr),
+    rampGenerator(nullptr),
+    recipeEngine(nullptr),
+    calendarScheduler(nullptr),
+    presetSpeeds(nullptr),
+    telemetry(nullptr),
+    telemetryLog(nullptr),
+    flightRecorder(nullptr),
+    lastStatusUpdate(0)
 {
 }
 
@@ -48,14 +61,8 @@ void WebInterface::handle() {
     // Handle WebSocket connections
     wsServer.handleClients();
 
-    // Update VFD status periodically
+    // Broadcast status to WebSocket clients (VFD is polled from the main loop)
     unsigned long now = millis();
-    if (now - lastVFDUpdate >= 100) {  // Update VFD every 100ms
-        lastVFDUpdate = now;
-        vfd.updateStatus();
-    }
-
-    // Broadcast status to WebSocket clients
     if (now - lastStatusUpdate >= 250) {  // Broadcast every 250ms
         lastStatusUpdate = now;
         updateStatus();
@@ -69,6 +76,23 @@ void WebInterface::updateStatus() {
         DEBUG_PRINTF("WebInterface: Broadcasting to %d clients\n", clientCount);
         wsServer.broadcastText(status);
     }
+
+    // Same status for /api/events, encoded once for all streams. The id
+    // is the ring position, so a reconnecting client can be sent the
+    // samples it missed.
+    if (httpServer.getEventStreamCount() > 0) {
+        String frame;
+        frame.reserve(status.length() + 24);
+        if (telemetry) {
+            frame += "id: ";
+            frame += String(telemetry->endSequence());
+            frame += "\n";
+        }
+        frame += "data: ";
+        frame += status;
+        frame += "\n\n";
+        httpServer.publishEvent(frame.c_str(), frame.length());
+    }
 }
 
 String WebInterface::buildStatusJSON() {
@@ -90,30 +114,104 @@ String WebInterface::buildStatusJSON() {
 
 void WebInterface::setupRoutes() {
     // VFD status endpoint
-    httpServer.on("/api/vfd/status", [this](WiFiClient& client, const String& method, const String& query) {
+    httpServer.on(HTTPMethod::GET, "/api/vfd/status", [this](WiFiClient& client, const String& method, const String& query) {
         handleVFDStatus(client, method, query);
     });
 
+    // Any drive on the link: this one or a drive group member
+    httpServer.on(HTTPMethod::GET, "/api/vfd/{id}/status", [this](WiFiClient& client, const String& method, const String& query) {
+        handleDriveStatus(client, method, query);
+    });
+
     // VFD control endpoints
-    httpServer.on("/api/vfd/start", [this](WiFiClient& client, const String& method, const String& query) {
+    httpServer.on(HTTPMethod::POST, "/api/vfd/start", [this](WiFiClient& client, const String& method, const String& query) {
         handleVFDStart(client, method, query);
     });
 
-    httpServer.on("/api/vfd/stop", [this](WiFiClient& client, const String& method, const String& query) {
+    httpServer.on(HTTPMethod::POST, "/api/vfd/stop", [this](WiFiClient& client, const String& method, const String& query) {
         handleVFDStop(client, method, query);
     });
 
-    httpServer.on("/api/vfd/frequency", [this](WiFiClient& client, const String& method, const String& query) {
+    httpServer.on(HTTPMethod::GET | HTTPMethod::POST, "/api/vfd/frequency", [this](WiFiClient& client, const String& method, const String& query) {
         handleVFDFrequency(client, method, query);
     });
 
     // Settings endpoint
-    httpServer.on("/api/settings", [this](WiFiClient& client, const String& method, const String& query) {
+    httpServer.on(HTTPMethod::GET | HTTPMethod::POST, "/api/settings", [this](WiFiClient& client, const String& method, const String& query) {
         handleSettings(client, method, query);
     });
 
+    // RS485 bus usage per source
+    httpServer.on(HTTPMethod::GET | HTTPMethod::POST, "/api/bus/stats", [this](WiFiClient& client, const String& method, const String& query) {
+        handleBusStats(client, method, query);
+    });
+
+    // Web server connection counters
+    httpServer.on(HTTPMethod::GET, "/api/http/stats", [this](WiFiClient& client, const String& method, const String& query) {
+        handleHTTPStats(client, method, query);
+    });
+
+    // Synchronized setpoints for drive groups
+    httpServer.on(HTTPMethod::GET | HTTPMethod::POST, "/api/group", [this](WiFiClient& client, const String& method, const String& query) {
+        handleDriveGroup(client, method, query);
+    });
+
+    // Master/follower ratio loop
+    httpServer.on(HTTPMethod::GET | HTTPMethod::POST, "/api/follower", [this](WiFiClient& client, const String& method, const String& query) {
+        handleFollower(client, method, query);
+    });
+
+    // Process PID loop
+    httpServer.on(HTTPMethod::GET | HTTPMethod::POST, "/api/pid", [this](WiFiClient& client, const String& method, const String& query) {
+        handlePID(client, method, query);
+    });
+
+    // Relay autotune of the drive's PID
+    httpServer.on(HTTPMethod::GET | HTTPMethod::POST, "/api/autotune", [this](WiFiClient& client, const String& method, const String& query) {
+        handleAutotune(client, method, query);
+    });
+
+    // Setpoint ramp generator
+    httpServer.on(HTTPMethod::GET | HTTPMethod::POST, "/api/ramp", [this](WiFiClient& client, const String& method, const String& query) {
+        handleRamp(client, method, query);
+    });
+
+    // Recipe programs
+    httpServer.on(HTTPMethod::GET | HTTPMethod::POST, "/api/recipe", [this](WiFiClient& client, const String& method, const String& query) {
+        handleRecipe(client, method, query);
+    });
+
+    // Calendar scheduler and RTC
+    httpServer.on(HTTPMethod::GET | HTTPMethod::POST, "/api/schedule", [this](WiFiClient& client, const String& method, const String& query) {
+        handleSchedule(client, method, query);
+    });
+
+    // Multi-step speed table
+    httpServer.on(HTTPMethod::GET | HTTPMethod::POST, "/api/presets", [this](WiFiClient& client, const String& method, const String& query) {
+        handlePresets(client, method, query);
+    });
+
+    // Telemetry history
+    httpServer.on(HTTPMethod::GET, "/api/trend", [this](WiFiClient& client, const String& method, const String& query) {
+        handleTrend(client, method, query);
+    });
+
+    httpServer.on(HTTPMethod::GET, "/api/log", [this](WiFiClient& client, const String& method, const String& query) {
+        handleLog(client, method, query);
+    });
+
+    // Fault flight recorder
+    httpServer.on(HTTPMethod::GET | HTTPMethod::POST, "/api/faults", [this](WiFiClient& client, const String& method, const String& query) {
+        handleFaults(client, method, query);
+    });
+
+    // Status as server-sent events, for clients that cannot use port 81
+    httpServer.on(HTTPMethod::GET, "/api/events", [this](WiFiClient& client, const String& method, const String& query) {
+        handleEvents(client, method, query);
+    });
+
     // WebSocket test endpoint
-    httpServer.on("/api/wstest", [this](WiFiClient& client, const String& method, const String& query) {
+    httpServer.on(HTTPMethod::GET, "/api/wstest", [this](WiFiClient& client, const String& method, const String& query) {
         StaticJsonDocument<256> doc;
         doc["wsPort"] = WS_PORT;
         doc["wsClients"] = wsServer.getClientCount();
@@ -129,12 +227,38 @@ void WebInterface::handleVFDStatus(WiFiClient& client, const String& method, con
     SimpleHTTPServer::sendJSON(client, status);
 }
 
-void WebInterface::handleVFDStart(WiFiClient& client, const String& method, const String& query) {
-    if (method != "POST") {
-        SimpleHTTPServer::send(client, 405, "text/plain", "Method Not Allowed");
+void WebInterface::handleDriveStatus(WiFiClient& client, const String& method, const String& query) {
+    HTTPConnection* connection = SimpleHTTPServer::connectionOf(client);
+    long id = connection ? connection->getParamInt("id") : -1;
+
+    if (id == vfd.getSlaveId()) {
+        handleVFDStatus(client, method, query);
+        return;
+    }
+
+    // Group members: what the last verification poll saw
+    for (size_t i = 0; driveGroup && i < driveGroup->getDriveCount(); i++) {
+        const GroupMember& member = driveGroup->getDrive(i);
+        if (member.slaveId != id) continue;
+
+        StaticJsonDocument<192> doc;
+        doc["id"] = member.slaveId;
+        doc["group"] = true;
+        doc["ratio"] = member.ratio;
+        doc["expected"] = member.expected;
+        doc["confirmed"] = member.confirmed;
+        doc["error"] = member.lastError;
+
+        String response;
+        serializeJson(doc, response);
+        SimpleHTTPServer::sendJSON(client, response);
         return;
     }
 
+    SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+}
+
+void WebInterface::handleVFDStart(WiFiClient& client, const String& method, const String& query) {
     bool success = vfd.start();
 
     StaticJsonDocument<128> doc;
@@ -150,11 +274,6 @@ void WebInterface::handleVFDStart(WiFiClient& client, const String& method, cons
 }
 
 void WebInterface::handleVFDStop(WiFiClient& client, const String& method, const String& query) {
-    if (method != "POST") {
-        SimpleHTTPServer::send(client, 405, "text/plain", "Method Not Allowed");
-        return;
-    }
-
     bool success = vfd.stop();
 
     StaticJsonDocument<128> doc;
@@ -216,9 +335,6 @@ void WebInterface::handleVFDFrequency(WiFiClient& client, const String& method,
 
         // Force immediate status update
         updateStatus();
-
-    } else {
-        SimpleHTTPServer::send(client, 405, "text/plain", "Method Not Allowed");
     }
 }
 
@@ -255,11 +371,1437 @@ void WebInterface::handleSettings(WiFiClient& client, const String& method, cons
 
         vfd.setParameters(params);
 
+        // Optionally push the ramp times to the drive's accel/decel
+        if (doc["applyToDrive"] | false) {
+            if (!vfd.applyRampTimes()) {
+                SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Failed to write accel/decel times\"}");
+                return;
+            }
+        }
+
         SimpleHTTPServer::sendJSON(client, "{\"success\":true,\"message\":\"Settings updated\"}");
+    }
+}
+
+void WebInterface::handleBusStats(WiFiClient& client, const String& method, const String& query) {
+    BusArbiter& arbiter = vfd.getArbiter();
+
+    if (method == "POST") {
+        arbiter.resetStats();
+        SimpleHTTPServer::sendJSON(client, "{\"success\":true,\"message\":\"Bus statistics reset\"}");
+        return;
+    }
+
+    StaticJsonDocument<512> doc;
+    doc["windowMs"] = arbiter.getStatsWindow();
+    JsonObject sources = doc.createNestedObject("sources");
+
+    for (size_t i = 0; i < (size_t)BusSource::COUNT; i++) {
+        BusSource source = (BusSource)i;
+        const BusSourceStats& stats = arbiter.getStats(source);
+        JsonObject entry = sources.createNestedObject(BusArbiter::sourceName(source));
+        entry["frames"] = stats.frames;
+        entry["errors"] = stats.errors;
+        entry["busTimeMs"] = (uint32_t)(stats.busTimeUs / 1000);
+        entry["utilization"] = arbiter.getUtilization(source);
+    }
+
+    String response;
+    serializeJson(doc, response);
+    SimpleHTTPServer::sendJSON(client, response);
+}
+
+void WebInterface::handleHTTPStats(WiFiClient& client, const String& method, const String& query) {
+    HTTPServerStats stats = httpServer.getStats();
+
+    StaticJsonDocument<384> doc;
+    doc["accepted"] = stats.accepted;
+    doc["requests"] = stats.requests;
+    doc["reused"] = stats.reused;
+    doc["timeouts"] = stats.timeouts;
+    doc["rejected"] = stats.rejected;
+    doc["spilled"] = stats.spilled;
+    doc["writes"] = stats.writes;
+    doc["eventStreams"] = httpServer.getEventStreamCount();
+    doc["eventsSent"] = stats.eventsSent;
+    doc["eventsDropped"] = stats.eventsDropped;
+    doc["open"] = stats.open;
+    doc["maxOpen"] = stats.maxOpen;
+    doc["maxServiceUs"] = stats.maxServiceUs;
+
+    String response;
+    serializeJson(doc, response);
+    SimpleHTTPServer::sendJSON(client, response);
+}
+
+void WebInterface::handleDriveGroup(WiFiClient& client, const String& method, const String& query) {
+    if (!driveGroup) {
+        SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+        return;
+    }
+
+    if (method == "POST") {
+        // {"drives":[{"id":1,"ratio":1.0},...]} replaces the membership,
+        // {"frequency":30.0} / {"command":"start|reverse|stop"} act on it
+        DynamicJsonDocument doc(1024);
+        if (!parseJSONBody(client, doc)) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        if (doc.containsKey("drives")) {
+            driveGroup->clear();
+            for (JsonObject drive : doc["drives"].as<JsonArray>()) {
+                if (!driveGroup->addDrive(drive["id"] | 0, drive["ratio"] | 1.0)) {
+                    SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid drive\"}");
+                    return;
+                }
+            }
+        }
+
+        bool success = true;
+        if (doc.containsKey("frequency")) {
+            VFDParams params = vfd.getParameters();
+            float frequency = doc["frequency"];
+            if (frequency < params.minFrequency || frequency > params.maxFrequency) {
+                SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Frequency out of range\"}");
+                return;
+            }
+            success = driveGroup->setFrequency(frequency);
+        }
+
+        if (doc.containsKey("command")) {
+            String command = doc["command"].as<String>();
+            if (command == "start") {
+                success = driveGroup->start(false) && success;
+            } else if (command == "reverse") {
+                success = driveGroup->start(true) && success;
+            } else if (command == "stop") {
+                success = driveGroup->stop() && success;
+            } else {
+                SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Unknown command\"}");
+                return;
+            }
+        }
+
+        StaticJsonDocument<128> response;
+        response["success"] = success;
+        response["sequence"] = driveGroup->getLastResult().sequence;
+
+        String output;
+        serializeJson(response, output);
+        SimpleHTTPServer::sendJSON(client, output);
+        return;
+    }
+
+    // GET: membership and the outcome of the last group change
+    DynamicJsonDocument doc(2048);
+    doc["verifying"] = driveGroup->isVerifying();
+
+    JsonArray drives = doc.createNestedArray("drives");
+    for (size_t i = 0; i < driveGroup->getDriveCount(); i++) {
+        const GroupMember& member = driveGroup->getDrive(i);
+        JsonObject entry = drives.createNestedObject();
+        entry["id"] = member.slaveId;
+        entry["ratio"] = member.ratio;
+        entry["expected"] = member.expected;
+        entry["confirmed"] = member.confirmed;
+        entry["error"] = member.lastError;
+    }
+
+    const GroupResult& result = driveGroup->getLastResult();
+    JsonObject last = doc.createNestedObject("last");
+    last["sequence"] = result.sequence;
+    last["type"] = result.isCommand ? "command" : "frequency";
+    last["value"] = result.value;
+    last["members"] = result.members;
+    last["confirmed"] = result.confirmed;
+    last["unicastWrites"] = result.unicastWrites;
+    last["dispatchUs"] = result.dispatchMicros;
+    last["skewMinUs"] = result.skewMinMicros;
+    last["skewMaxUs"] = result.skewMaxMicros;
+    last["verifyMs"] = result.verifyMillis;
+    last["complete"] = result.complete;
+    last["verified"] = result.verified;
+
+    String response;
+    serializeJson(doc, response);
+    SimpleHTTPServer::sendJSON(client, response);
+}
+
+void WebInterface::handleFollower(WiFiClient& client, const String& method, const String& query) {
+    if (!followerLoop) {
+        SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+        return;
+    }
+
+    if (method == "POST") {
+        DynamicJsonDocument doc(512);
+        if (!parseJSONBody(client, doc)) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        // Any field left out keeps its current value
+        FollowerConfig config = followerLoop->getConfig();
+        config.leaderId = doc["leader"] | config.leaderId;
+        config.followerId = doc["follower"] | config.followerId;
+        config.ratio = doc["ratio"] | config.ratio;
+        config.offset = doc["offset"] | config.offset;
+        config.slewUp = doc["slewUp"] | config.slewUp;
+        config.slewDown = doc["slewDown"] | config.slewDown;
+        config.periodMs = doc["periodMs"] | config.periodMs;
+
+        if (config.leaderId == config.followerId || config.ratio <= 0 ||
+            config.slewUp < 0 || config.slewDown < 0) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid configuration\"}");
+            return;
+        }
+        followerLoop->setConfig(config);
+
+        if (doc["reset"] | false) {
+            followerLoop->resetStats();
+        }
+        if (doc.containsKey("enabled")) {
+            if (doc["enabled"].as<bool>()) {
+                followerLoop->engage();
+            } else {
+                followerLoop->disengage();
+            }
+        }
+
+        SimpleHTTPServer::sendJSON(client, "{\"success\":true}");
+        return;
+    }
+
+    // GET: configuration and loop telemetry
+    FollowerConfig config = followerLoop->getConfig();
+    FollowerStats stats = followerLoop->getStats();
+
+    DynamicJsonDocument doc(1024);
+    doc["enabled"] = followerLoop->isEngaged();
+    doc["leader"] = config.leaderId;
+    doc["follower"] = config.followerId;
+    doc["ratio"] = config.ratio;
+    doc["offset"] = config.offset;
+    doc["slewUp"] = config.slewUp;
+    doc["slewDown"] = config.slewDown;
+    doc["periodMs"] = config.periodMs;
+
+    JsonObject telemetry = doc.createNestedObject("stats");
+    telemetry["ticks"] = stats.ticks;
+    telemetry["overruns"] = stats.overruns;
+    telemetry["leaderErrors"] = stats.leaderErrors;
+    telemetry["writeErrors"] = stats.writeErrors;
+    telemetry["followerErrors"] = stats.followerErrors;
+    telemetry["leaderLost"] = stats.leaderLost;
+    telemetry["leaderFrequency"] = stats.leaderFrequency;
+    telemetry["target"] = stats.target;
+    telemetry["command"] = stats.command;
+    telemetry["followerFrequency"] = stats.followerFrequency;
+    telemetry["trackingError"] = stats.trackingError;
+    telemetry["maxTrackingError"] = stats.maxTrackingError;
+    telemetry["minPeriodUs"] = stats.minPeriodUs;
+    telemetry["maxPeriodUs"] = stats.maxPeriodUs;
+    telemetry["maxJitterUs"] = stats.maxJitterUs;
+    telemetry["lastExecUs"] = stats.lastExecUs;
+    telemetry["maxExecUs"] = stats.maxExecUs;
+    telemetry["lastWriteUs"] = stats.lastWriteUs;
+    telemetry["maxWriteUs"] = stats.maxWriteUs;
+
+    String response;
+    serializeJson(doc, response);
+    SimpleHTTPServer::sendJSON(client, response);
+}
+
+void WebInterface::handlePID(WiFiClient& client, const String& method, const String& query) {
+    if (!pidLoop) {
+        SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+        return;
+    }
+
+    if (method == "POST") {
+        DynamicJsonDocument doc(768);
+        if (!parseJSONBody(client, doc)) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        // Any field left out keeps its current value
+        PIDConfig config = pidLoop->getConfig();
+        config.kp = doc["kp"] | config.kp;
+        config.ki = doc["ki"] | config.ki;
+        config.kd = doc["kd"] | config.kd;
+        config.setpoint = doc["setpoint"] | config.setpoint;
+        config.reverseActing = doc["reverse"] | config.reverseActing;
+        config.periodMs = doc["periodMs"] | config.periodMs;
+        if (doc.containsKey("source")) {
+            config.source = doc["source"].as<String>() == "adc" ? PVSource::ADC : PVSource::DRIVE;
+        }
+        config.slaveId = doc["slaveId"] | config.slaveId;
+        config.pvRegister = doc["register"] | config.pvRegister;
+        config.adcPin = doc["adcPin"] | config.adcPin;
+        config.pvScale = doc["pvScale"] | config.pvScale;
+        config.pvOffset = doc["pvOffset"] | config.pvOffset;
+        config.outMin = doc["outMin"] | config.outMin;
+        config.outMax = doc["outMax"] | config.outMax;
+
+        VFDParams params = vfd.getParameters();
+        if (config.kp < 0 || config.ki < 0 || config.kd < 0 || config.outMin > config.outMax ||
+            config.outMin < params.minFrequency || config.outMax > params.maxFrequency) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid configuration\"}");
+            return;
+        }
+        pidLoop->setConfig(config);
+
+        if (doc["reset"] | false) {
+            pidLoop->resetStats();
+        }
+        if (doc.containsKey("enabled")) {
+            if (doc["enabled"].as<bool>()) {
+                pidLoop->engage();
+            } else {
+                pidLoop->disengage();
+            }
+        }
+
+        SimpleHTTPServer::sendJSON(client, "{\"success\":true}");
+        return;
+    }
+
+    // GET: tuning and loop timing
+    PIDConfig config = pidLoop->getConfig();
+    PIDStats stats = pidLoop->getStats();
+
+    HTTPResponse response(client, 200);
+    response.header("Content-Type", "application/json");
+    HTTPStream stream(response);
+    JsonWriter json(stream);
+
+    json.beginObject();
+    json.field("enabled", pidLoop->isEngaged());
+    json.field("kp", config.kp);
+    json.field("ki", config.ki);
+    json.field("kd", config.kd);
+    json.field("setpoint", config.setpoint);
+    json.field("reverse", config.reverseActing);
+    json.field("periodMs", config.periodMs);
+    json.field("source", config.source == PVSource::ADC ? "adc" : "drive");
+    json.field("slaveId", config.slaveId);
+    json.field("register", config.pvRegister);
+    json.field("adcPin", config.adcPin);
+    json.field("pvScale", config.pvScale);
+    json.field("pvOffset", config.pvOffset);
+    json.field("outMin", config.outMin);
+    json.field("outMax", config.outMax);
+
+    json.beginObject("stats");
+    json.field("ticks", stats.ticks);
+    json.field("overruns", stats.overruns);
+    json.field("pvErrors", stats.pvErrors);
+    json.field("pv", stats.pv);
+    json.field("error", stats.error);
+    json.field("output", stats.output);
+    json.field("p", stats.pTerm);
+    json.field("i", stats.iTerm);
+    json.field("d", stats.dTerm);
+    json.field("saturated", stats.saturated);
+    json.field("minPeriodUs", stats.minPeriodUs);
+    json.field("maxPeriodUs", stats.maxPeriodUs);
+    json.field("maxJitterUs", stats.maxJitterUs);
+    json.field("lastExecUs", stats.lastExecUs);
+    json.field("maxExecUs", stats.maxExecUs);
+    json.field("pvAgeUs", stats.pvAgeUs);
+    json.field("maxPvAgeUs", stats.maxPvAgeUs);
+    json.field("writeLatencyUs", stats.writeLatencyUs);
+    json.field("maxWriteLatencyUs", stats.maxWriteLatencyUs);
+    json.endObject();
+    json.endObject();
+}
+
+void WebInterface::handleAutotune(WiFiClient& client, const String& method, const String& query) {
+    if (!autotuner) {
+        SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+        return;
+    }
+
+    if (method == "POST") {
+        DynamicJsonDocument doc(512);
+        if (!parseJSONBody(client, doc)) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        if (doc["abort"] | false) {
+            autotuner->abort();
+            SimpleHTTPServer::sendJSON(client, "{\"success\":true,\"message\":\"Abort requested\"}");
+            return;
+        }
+
+        VFDParams params = vfd.getParameters();
+        AutotuneConfig config;
+        config.slaveId = doc["slaveId"] | vfd.getSlaveId();
+        config.pvRegister = doc["register"] | REG_PID_FEEDBACK_READ;
+        config.pvScale = doc["pvScale"] | 0.01;
+        config.setpoint = doc["setpoint"] | 50.0;
+        config.hysteresis = doc["hysteresis"] | 1.0;
+        config.bias = doc["bias"] | 30.0;
+        config.amplitude = doc["amplitude"] | 5.0;
+        config.maxFrequency = params.maxFrequency;
+        config.apply = doc["apply"] | true;
+
+        String rule = doc["rule"] | "zn-pid";
+        config.rule = rule == "zn-pi" ? TuneRule::ZIEGLER_NICHOLS_PI :
+                      rule == "tyreus-luyben" ? TuneRule::TYREUS_LUYBEN :
+                      TuneRule::ZIEGLER_NICHOLS_PID;
+
+        if (config.bias - config.amplitude < params.minFrequency ||
+            config.bias + config.amplitude > params.maxFrequency) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Relay swing out of range\"}");
+            return;
+        }
+
+        bool success = autotuner->start(config);
+        SimpleHTTPServer::sendJSON(client, success ? "{\"success\":true,\"message\":\"Autotune started\"}"
+                                                   : "{\"success\":false,\"error\":\"Autotune already running\"}");
+        return;
+    }
+
+    // GET: progress and result
+    AutotuneResult result = autotuner->getResult();
+
+    StaticJsonDocument<512> doc;
+    doc["state"] = PIDAutotuner::stateName(autotuner->getState());
+    doc["message"] = autotuner->getMessage();
+    doc["cycles"] = result.cycles;
+    doc["samples"] = result.samples;
+    doc["meanSampleUs"] = result.meanSampleUs;
+    doc["maxSampleUs"] = result.maxSampleUs;
+    doc["ku"] = result.ultimateGain;
+    doc["tu"] = result.ultimatePeriod;
+    doc["amplitude"] = result.amplitude;
+    doc["kp"] = result.kp;
+    doc["ti"] = result.ti;
+    doc["td"] = result.td;
+    doc["applied"] = result.applied;
+
+    String response;
+    serializeJson(doc, response);
+    SimpleHTTPServer::sendJSON(client, response);
+}
+
+void WebInterface::handleRamp(WiFiClient& client, const String& method, const String& query) {
+    if (!rampGenerator) {
+        SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+        return;
+    }
+
+    if (method == "POST") {
+        DynamicJsonDocument doc(256);
+        if (!parseJSONBody(client, doc)) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        if (doc.containsKey("profile")) {
+            String profile = doc["profile"].as<String>();
+            rampGenerator->setProfile(profile == "scurve" ? RampProfile::SCURVE : RampProfile::TRAPEZOID);
+        }
+        if (doc.containsKey("sCurveTime")) {
+            rampGenerator->setSCurveTime(doc["sCurveTime"]);
+        }
+        if (doc["applyToDrive"] | false) {
+            if (!vfd.applyRampTimes()) {
+                SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Failed to write accel/decel times\"}");
+                return;
+            }
+        }
+
+        if (doc["cancel"] | false) {
+            rampGenerator->cancel();
+        } else if (doc.containsKey("target")) {
+            VFDParams params = vfd.getParameters();
+            float target = doc["target"];
+            if (target < params.minFrequency || target > params.maxFrequency) {
+                SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Frequency out of range\"}");
+                return;
+            }
+            rampGenerator->setTarget(target);
+        }
+
+        SimpleHTTPServer::sendJSON(client, "{\"success\":true}");
+        return;
+    }
+
+    RampStats stats = rampGenerator->getStats();
+
+    StaticJsonDocument<384> doc;
+    doc["ramping"] = rampGenerator->isRamping();
+    doc["target"] = rampGenerator->getTarget();
+    doc["profile"] = rampGenerator->getProfile() == RampProfile::SCURVE ? "scurve" : "trapezoid";
+    doc["sCurveTime"] = rampGenerator->getSCurveTime();
+    doc["updateMs"] = RAMP_UPDATE_MS;
+    doc["setpoint"] = stats.setpoint;
+    doc["rate"] = stats.rate;
+    doc["ticks"] = stats.ticks;
+    doc["maxJitterUs"] = stats.maxJitterUs;
+
+    String response;
+    serializeJson(doc, response);
+    SimpleHTTPServer::sendJSON(client, response);
+}
+
+void WebInterface::handleRecipe(WiFiClient& client, const String& method, const String& query) {
+    if (!recipeEngine) {
+        SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+        return;
+    }
+
+    if (method == "POST") {
+        // A full program: RECIPE_MAX_STEPS steps of up to eight members,
+        // plus the short strings (until, compare, name) copied in
+        DynamicJsonDocument doc(JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(RECIPE_MAX_STEPS) +
+                                RECIPE_MAX_STEPS * JSON_OBJECT_SIZE(8) + 1024);
+        if (!parseJSONBody(client, doc)) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        String action = doc["action"] | "";
+        String name = doc["name"] | "";
+
+        if (action == "abort") {
+            recipeEngine->abort();
+            SimpleHTTPServer::sendJSON(client, "{\"success\":true,\"message\":\"Abort requested\"}");
+            return;
+        }
+
+        if (!RecipeEngine::validName(name.c_str())) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid program name\"}");
+            return;
+        }
+
+        if (action == "start") {
+            bool success = recipeEngine->start(name.c_str());
+            SimpleHTTPServer::sendJSON(client, success ? "{\"success\":true,\"message\":\"Program started\"}"
+                                                       : "{\"success\":false,\"error\":\"Program missing, invalid or one already running\"}");
+            return;
+        }
+
+        if (action == "delete") {
+            bool success = RecipeEngine::remove(name.c_str());
+            SimpleHTTPServer::sendJSON(client, success ? "{\"success\":true}"
+                                                       : "{\"success\":false,\"error\":\"Program not found\"}");
+            return;
+        }
+
+        if (action != "save") {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Unknown action\"}");
+            return;
+        }
+
+        // Steps: {frequency (Hz, omit to keep), direction, durationMs,
+        // ramp, until, compare (">=" / "<="), threshold, abortOnTimeout}
+        JsonArray steps = doc["steps"];
+        if (steps.isNull() || steps.size() == 0 || steps.size() > RECIPE_MAX_STEPS) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"1 to " + String(RECIPE_MAX_STEPS) + " steps required\"}");
+            return;
+        }
+
+        VFDParams params = vfd.getParameters();
+        RecipeProgram program;
+        memset(&program, 0, sizeof(program));
+        program.stepCount = steps.size();
+        program.flags = (doc["loop"] | false) ? RECIPE_PROGRAM_LOOP : 0;
+
+        for (size_t i = 0; i < steps.size(); i++) {
+            JsonObject item = steps[i];
+            RecipeStep& step = program.steps[i];
+
+            step.frequency = RECIPE_KEEP_FREQUENCY;
+            if (item.containsKey("frequency")) {
+                float frequency = item["frequency"];
+                if (frequency < params.minFrequency || frequency > params.maxFrequency) {
+                    SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Step " + String(i) + ": frequency out of range\"}");
+                    return;
+                }
+                step.frequency = (uint16_t)(frequency * 100 + 0.5);
+            }
+
+            RecipeDirection direction = RecipeDirection::KEEP;
+            RecipeCondition condition = RecipeCondition::NONE;
+            if (!RecipeEngine::parseDirection(item["direction"] | "keep", direction) ||
+                !RecipeEngine::parseCondition(item["until"] | "none", condition)) {
+                SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Step " + String(i) + ": unknown direction or condition\"}");
+                return;
+            }
+            step.direction = (uint8_t)direction;
+            step.condition = (uint8_t)condition;
+
+            String compare = item["compare"] | ">=";
+            step.compare = (uint8_t)(compare == "<=" ? RecipeCompare::AT_MOST : RecipeCompare::AT_LEAST);
+            step.threshold = (int16_t)round((float)(item["threshold"] | 0.0) * 10);
+            step.durationMs = item["durationMs"] | 0;
+
+            step.flags = 0;
+            if (item["ramp"] | false) step.flags |= RECIPE_STEP_RAMP;
+            if (item["abortOnTimeout"] | false) step.flags |= RECIPE_STEP_ABORT_ON_TIMEOUT;
+        }
+
+        bool success = RecipeEngine::save(name.c_str(), program);
+        SimpleHTTPServer::sendJSON(client, success ? "{\"success\":true,\"message\":\"Program saved\"}"
+                                                   : "{\"success\":false,\"error\":\"Failed to write program\"}");
+        return;
+    }
+
+    // GET ?name=: one program, decoded
+    String name = SimpleHTTPServer::getQueryParam(query, "name");
+    if (name.length() > 0) {
+        RecipeProgram program;
+        if (!RecipeEngine::load(name.c_str(), program)) {
+            SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+            return;
+        }
+
+        HTTPResponse response(client, 200);
+        response.header("Content-Type", "application/json");
+        HTTPStream stream(response);
+        JsonWriter json(stream);
+
+        json.beginObject();
+        json.field("name", name);
+        json.field("loop", (program.flags & RECIPE_PROGRAM_LOOP) != 0);
+        json.beginArray("steps");
+        for (uint8_t i = 0; i < program.stepCount; i++) {
+            const RecipeStep& step = program.steps[i];
+            json.beginObject();
+            if (step.frequency != RECIPE_KEEP_FREQUENCY) {
+                json.field("frequency", step.frequency / 100.0, 2);
+            }
+            json.field("direction", RecipeEngine::directionName((RecipeDirection)step.direction));
+            json.field("durationMs", step.durationMs);
+            json.field("ramp", (step.flags & RECIPE_STEP_RAMP) != 0);
+            if (step.condition != (uint8_t)RecipeCondition::NONE) {
+                json.field("until", RecipeEngine::conditionName((RecipeCondition)step.condition));
+                json.field("compare", step.compare == (uint8_t)RecipeCompare::AT_MOST ? "<=" : ">=");
+                json.field("threshold", step.threshold / 10.0, 1);
+                json.field("abortOnTimeout", (step.flags & RECIPE_STEP_ABORT_ON_TIMEOUT) != 0);
+            }
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+        return;
+    }
+
+    // GET: engine status and stored programs
+    RecipeStatus status = recipeEngine->getStatus();
+
+    DynamicJsonDocument doc(1024);
+    doc["state"] = RecipeEngine::stateName(status.state);
+    doc["message"] = recipeEngine->getMessage();
+    doc["program"] = status.name;
+    doc["step"] = status.step;
+    doc["steps"] = status.stepCount;
+    doc["stepElapsedMs"] = status.stepElapsedMs;
+    doc["loops"] = status.loops;
+    doc["transitions"] = status.transitions;
+    doc["lastLatenessUs"] = status.lastLatenessUs;
+    doc["maxLatenessUs"] = status.maxLatenessUs;
+
+    JsonArray programs = doc.createNestedArray("programs");
+    File dir = SPIFFS.open(RECIPE_DIR);
+    File file = dir.openNextFile();
+    while (file) {
+        String entry = file.name();
+        int slash = entry.lastIndexOf('/');
+        if (slash != -1) entry = entry.substring(slash + 1);
+        if (entry.endsWith(".rcp")) {
+            programs.add(entry.substring(0, entry.length() - 4));
+        }
+        file = dir.openNextFile();
+    }
+
+    String response;
+    serializeJson(doc, response);
+    SimpleHTTPServer::sendJSON(client, response);
+}
+
+void WebInterface::handleSchedule(WiFiClient& client, const String& method, const String& query) {
+    if (!calendarScheduler) {
+        SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+        return;
+    }
+
+    if (method == "POST") {
+        DynamicJsonDocument doc(512);
+        if (!parseJSONBody(client, doc)) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        String action = doc["action"] | "";
+
+        if (action == "remove") {
+            bool success = calendarScheduler->remove(doc["id"] | SCHEDULE_NO_EVENT);
+            SimpleHTTPServer::sendJSON(client, success ? "{\"success\":true}"
+                                                       : "{\"success\":false,\"error\":\"Event not found\"}");
+            return;
+        }
+
+        if (action == "clear") {
+            calendarScheduler->clear();
+            SimpleHTTPServer::sendJSON(client, "{\"success\":true}");
+            return;
+        }
+
+        // Times are RTC local time, "YYYY-MM-DD HH:MM:SS"
+        RTCDateTime time;
+        if (!PCF85063::parse(doc["time"] | "", time)) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid time\"}");
+            return;
+        }
+
+        if (action == "setTime") {
+            bool success = calendarScheduler->setTime(PCF85063::toEpoch(time));
+            SimpleHTTPServer::sendJSON(client, success ? "{\"success\":true,\"message\":\"Clock set\"}"
+                                                       : "{\"success\":false,\"error\":\"RTC write failed\"}");
+            return;
+        }
+
+        if (action != "add") {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Unknown action\"}");
+            return;
+        }
+
+        ScheduleRepeat repeat;
+        ScheduleAction command;
+        if (!CalendarScheduler::parseRepeat(doc["repeat"] | "once", repeat) ||
+            !CalendarScheduler::parseAction(doc["command"] | "", command)) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Unknown repeat or command\"}");
+            return;
+        }
+
+        float frequency = doc["frequency"] | 0.0;
+        if (command == ScheduleAction::SET_FREQUENCY) {
+            VFDParams params = vfd.getParameters();
+            if (frequency < params.minFrequency || frequency > params.maxFrequency) {
+                SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Frequency out of range\"}");
+                return;
+            }
+        }
+
+        int id = calendarScheduler->add(PCF85063::toEpoch(time), repeat, command, frequency);
+        if (id < 0) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Schedule full or time already past\"}");
+            return;
+        }
+
+        StaticJsonDocument<64> response;
+        response["success"] = true;
+        response["id"] = id;
+        String output;
+        serializeJson(response, output);
+        SimpleHTTPServer::sendJSON(client, output);
+        return;
+    }
+
+    // GET: clock, stats and one page of events (?offset=&limit=, by id)
+    int offset = SimpleHTTPServer::getQueryParam(query, "offset").toInt();
+    String limitParam = SimpleHTTPServer::getQueryParam(query, "limit");
+    int limit = limitParam.length() > 0 ? limitParam.toInt() : 32;
+    limit = constrain(limit, 1, 64);
+
+    DynamicJsonDocument doc(1024 + limit * 160);
+    char text[20];
+    RTCDateTime time;
+
+    PCF85063::fromEpoch(calendarScheduler->now(), time);
+    PCF85063::format(time, text, sizeof(text));
+    doc["time"] = text;
+    doc["clockValid"] = calendarScheduler->isClockValid();
+    doc["count"] = calendarScheduler->getEventCount();
+    doc["capacity"] = SCHEDULE_MAX_EVENTS;
+    doc["nextId"] = calendarScheduler->peekNext();
+
+    ScheduleStats stats = calendarScheduler->getStats();
+    doc["fired"] = stats.fired;
+    doc["missed"] = stats.missed;
+    doc["rtcErrors"] = stats.rtcErrors;
+
+    JsonArray list = doc.createNestedArray("events");
+    int skipped = 0;
+    for (uint16_t id = 0; id < SCHEDULE_MAX_EVENTS && (int)list.size() < limit; id++) {
+        ScheduleEvent event;
+        if (!calendarScheduler->getEvent(id, event)) continue;
+        if (skipped++ < offset) continue;
+
+        JsonObject item = list.createNestedObject();
+        item["id"] = id;
+        PCF85063::fromEpoch(event.first, time);
+        PCF85063::format(time, text, sizeof(text));
+        item["time"] = text;
+        PCF85063::fromEpoch(event.next, time);
+        PCF85063::format(time, text, sizeof(text));
+        item["next"] = text;
+        item["repeat"] = CalendarScheduler::repeatName((ScheduleRepeat)event.repeat);
+        item["command"] = CalendarScheduler::actionName((ScheduleAction)event.action);
+        if (event.action == (uint8_t)ScheduleAction::SET_FREQUENCY) {
+            item["frequency"] = event.value / 100.0;
+        }
+    }
+
+    String response;
+    serializeJson(doc, response);
+    SimpleHTTPServer::sendJSON(client, response);
+}
+
+void WebInterface::handlePresets(WiFiClient& client, const String& method, const String& query) {
+    if (!presetSpeeds) {
+        SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+        return;
+    }
+
+    if (method == "POST") {
+        DynamicJsonDocument doc(1024);
+        if (!parseJSONBody(client, doc)) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        // Target drives, default the local one; "all" only for a step
+        // select, which then goes out as one broadcast
+        uint8_t drives[VFD_GROUP_MAX_DRIVES];
+        size_t driveCount = 0;
+        String driveText = doc["drives"] | "";
+        bool wholeBus = driveText == "all";
+        JsonArray driveList = doc["drives"];
+        if (driveList.isNull() && !wholeBus) {
+            drives[driveCount++] = vfd.getSlaveId();
+        } else {
+            for (JsonVariant id : driveList) {
+                if (driveCount >= VFD_GROUP_MAX_DRIVES) break;
+                int slaveId = id | 0;
+                if (slaveId < 1 || slaveId > 247) {
+                    SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid drive ID\"}");
+                    return;
+                }
+                drives[driveCount++] = slaveId;
+            }
+        }
+        if (driveCount == 0 && !wholeBus) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"No drives given\"}");
+            return;
+        }
+
+        String action = doc["action"] | "";
+
+        if (action == "select") {
+            int step = doc["step"] | -1;
+            if (step < 0 || step > PRESET_STEPS) {
+                SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Step must be 0-15\"}");
+                return;
+            }
+            bool success = wholeBus ? presetSpeeds->selectStepAll(step)
+                                    : presetSpeeds->selectStep(drives, driveCount, step);
+            SimpleHTTPServer::sendJSON(client, success ? "{\"success\":true}"
+                                                       : "{\"success\":false,\"error\":\"Step select failed\"}");
+            return;
+        }
+
+        if (action != "upload") {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Unknown action\"}");
+            return;
+        }
+        if (wholeBus) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Upload needs drive IDs\"}");
+            return;
+        }
+
+        // Steps in Hz; null or missing entries keep the drive's value
+        JsonArray steps = doc["steps"];
+        if (steps.isNull() || steps.size() > PRESET_STEPS) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Up to 15 steps required\"}");
+            return;
+        }
+
+        VFDParams params = vfd.getParameters();
+        uint16_t values[PRESET_STEPS];
+        for (uint8_t i = 0; i < PRESET_STEPS; i++) {
+            values[i] = PRESET_KEEP;
+            if (i >= steps.size() || steps[i].isNull()) continue;
+
+            float frequency = steps[i];
+            if (frequency < 0 || frequency > params.maxFrequency) {
+                SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Step " + String(i + 1) + " out of range\"}");
+                return;
+            }
+            values[i] = (uint16_t)(frequency * 100 + 0.5);
+        }
+
+        DynamicJsonDocument response(256 + driveCount * 160);
+        JsonArray results = response.createNestedArray("drives");
+        bool allVerified = true;
+        for (size_t i = 0; i < driveCount; i++) {
+            PresetResult result;
+            presetSpeeds->upload(drives[i], values, result);
+            allVerified = allVerified && result.verified;
+
+            JsonObject item = results.createNestedObject();
+            item["slaveId"] = result.slaveId;
+            item["verified"] = result.verified;
+            item["blockReads"] = result.blockReads;
+            item["blockWrites"] = result.blockWrites;
+            item["registersWritten"] = result.registersWritten;
+            item["error"] = result.error;
+        }
+        response["success"] = allVerified;
+
+        String output;
+        serializeJson(response, output);
+        SimpleHTTPServer::sendJSON(client, output);
+        return;
+    }
+
+    // GET ?slave=: the drive's table and the step it is running
+    String slaveParam = SimpleHTTPServer::getQueryParam(query, "slave");
+    long slaveValue = slaveParam.length() > 0 ? slaveParam.toInt() : vfd.getSlaveId();
+    if (slaveValue < 1 || slaveValue > 247) {
+        SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid drive ID\"}");
+        return;
+    }
+    uint8_t slaveId = slaveValue;
+
+    uint16_t values[PRESET_STEPS];
+    uint8_t status = presetSpeeds->readTable(slaveId, values);
+    if (status != MODBUS_OK) {
+        SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Table read failed\"}");
+        return;
+    }
 
+    uint16_t activeStep = 0;
+    BusArbiter& arbiter = vfd.getArbiter();
+    arbiter.beginFrame(BusSource::COMMAND);
+    uint8_t stepStatus = vfd.getTransport().readRegisters(slaveId, REG_MULTI_SPEED_READ, 1, &activeStep);
+    arbiter.endFrame(stepStatus == MODBUS_OK);
+
+    DynamicJsonDocument doc(768);
+    doc["success"] = true;
+    doc["slaveId"] = slaveId;
+    if (stepStatus == MODBUS_OK) {
+        doc["activeStep"] = activeStep;
+    }
+    JsonArray steps = doc.createNestedArray("steps");
+    for (uint8_t i = 0; i < PRESET_STEPS; i++) {
+        steps.add(values[i] / 100.0);
+    }
+
+    String response;
+    serializeJson(doc, response);
+    SimpleHTTPServer::sendJSON(client, response);
+}
+
+void WebInterface::handleTrend(WiFiClient& client, const String& method, const String& query) {
+    if (!telemetry) {
+        SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+        return;
+    }
+
+    // from/to are millis() on the device, negative values count back from
+    // now (from=-600000 is the last ten minutes); default the whole ring
+    uint32_t now = millis();
+    String fromParam = SimpleHTTPServer::getQueryParam(query, "from");
+    String toParam = SimpleHTTPServer::getQueryParam(query, "to");
+    uint32_t first = telemetry->firstSequence();
+    uint32_t end = telemetry->endSequence();
+    uint32_t from = 0;
+    uint32_t to = now;
+    if (fromParam.length() > 0) {
+        long value = strtol(fromParam.c_str(), nullptr, 10);
+        from = value < 0 ? now + value : strtoul(fromParam.c_str(), nullptr, 10);
+        first = telemetry->findTime(from);
     } else {
-        SimpleHTTPServer::send(client, 405, "text/plain", "Method Not Allowed");
+        TelemetryRecord oldest;
+        if (telemetry->getRecord(first, oldest)) {
+            from = oldest.time;
+        }
+    }
+    if (toParam.length() > 0) {
+        long value = strtol(toParam.c_str(), nullptr, 10);
+        to = value < 0 ? now + value : strtoul(toParam.c_str(), nullptr, 10);
+        end = telemetry->findTime(to + 1);
+    }
+    if ((int32_t)(end - first) < 0) {
+        end = first;
+    }
+
+    // buckets=: per-bucket min/max/mean instead of every sample
+    String bucketParam = SimpleHTTPServer::getQueryParam(query, "buckets");
+    if (bucketParam.length() > 0) {
+        long buckets = bucketParam.toInt();
+        if (buckets < 1 || buckets > TREND_MAX_BUCKETS || (int32_t)(to - from) < 0) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid buckets or range\"}");
+            return;
+        }
+        sendTrendBuckets(client, first, end, from, to, buckets);
+        return;
+    }
+
+    bool binary = SimpleHTTPServer::getQueryParam(query, "format") == "bin";
+
+    // Records go out straight from the ring, one contiguous run at a time,
+    // as fast as the socket takes them: the server calls the producer
+    // again whenever the last piece has gone. The sequence range is fixed
+    // up front; if a slow client lets the writer lap us, stop rather than
+    // send newer data under old positions.
+    HTTPResponse response(client, 200);
+    response.header("Content-Type", binary ? "application/octet-stream" : "text/csv");
+    if (binary) {
+        response.header("X-Record-Size", (unsigned long)sizeof(TelemetryRecord));
+    }
+    response.header("X-Trend-Sequence", (unsigned long)first);
+    response.header("X-Trend-Now", (unsigned long)now);
+    auto stream = std::make_shared<HTTPStream>(response);
+
+    if (!binary) {
+        stream->print("time_ms,frequency_hz,current_a,voltage_v,status\n");
+    }
+
+    TelemetryRing* ring = telemetry;
+    uint32_t sequence = first;
+    SimpleHTTPServer::produce(client, [ring, stream, binary, sequence, end](WiFiClient&) mutable {
+        if (!stream->connected()) return false;
+
+        while (stream->writable()) {
+            if (sequence == end) {
+                stream->end();
+                return false;
+            }
+
+            // A binary run is one chunk at most; CSV stops mid-run once the queue is full
+            const TelemetryRecord* records = nullptr;
+            size_t max = binary ? HTTP_CHUNK_BUFFER / sizeof(TelemetryRecord) : TREND_SAMPLES_PER_CALL;
+            size_t count = ring->segment(sequence, min((size_t)(end - sequence), max), records);
+
+            size_t sent = count;
+            if (binary) {
+                stream->write((const uint8_t*)records, count * sizeof(TelemetryRecord));
+            } else {
+                for (sent = 0; sent < count && stream->writable(); sent++) {
+                    const TelemetryRecord& record = records[sent];
+                    stream->printf("%u,%u.%02u,%u.%02u,%u.%u,%04X\n",
+                                   record.time,
+                                   record.frequency / 100, record.frequency % 100,
+                                   record.current / 100, record.current % 100,
+                                   record.voltage / 10, record.voltage % 10,
+                                   record.statusWord);
+                }
+            }
+
+            if (count == 0 || !ring->isRetained(sequence)) {
+                DEBUG_PRINTLN("WebInterface: Trend download overtaken by the ring, truncated");
+                stream->end();
+                return false;
+            }
+            sequence += sent;
+        }
+        return true;
+    });
+}
+
+void WebInterface::sendTrendBuckets(WiFiClient& client, uint32_t first, uint32_t end,
+                                    uint32_t from, uint32_t to, uint16_t buckets) {
+    uint32_t width = (to - from) / buckets + 1;
+
+    HTTPResponse response(client, 200);
+    response.header("Content-Type", "application/json");
+    auto stream = std::make_shared<HTTPStream>(response);
+    auto json = std::make_shared<JsonWriter>(*stream);
+
+    // Written as the single pass completes each bucket - the response
+    // never exists in memory as a whole. Buckets without samples are
+    // left out; each is [start, samples, then min, max, mean per channel].
+    json->beginObject();
+    json->field("success", true);
+    json->field("from", from);
+    json->field("to", to);
+    json->field("bucketMs", width);
+    json->beginArray("channels").value("frequency").value("current").value("voltage").endArray();
+    json->beginArray("buckets");
+
+    auto aggregator = std::make_shared<TrendAggregator>(from, width, [stream, json, from, width](const TrendBucket& bucket) {
+        if (!stream->connected()) return false;
+
+        static const float scale[TREND_CHANNELS] = { 100.0, 100.0, 10.0 };
+        json->beginArray();
+        json->value(from + bucket.index * width);
+        json->value(bucket.count);
+        for (uint8_t c = 0; c < TREND_CHANNELS; c++) {
+            json->value(bucket.min[c] / scale[c], 2);
+            json->value(bucket.max[c] / scale[c], 2);
+            json->value((double)bucket.sum[c] / bucket.count / scale[c], 2);
+        }
+        json->endArray();
+        return true;
+    });
+
+    // The ring only reaches back hours (minutes without PSRAM). Whatever
+    // part of the range lies before its oldest sample comes from the
+    // flash log, at the log's one-sample-per-second resolution, mapped
+    // from RTC seconds onto the millis() timeline of the query.
+    uint32_t now = millis();
+    TelemetryRecord oldest;
+    uint32_t ringStart = telemetry->getRecord(telemetry->firstSequence(), oldest) ? oldest.time : now;
+    TelemetryLog* log = nullptr;
+    TelemetryLogCursor cursor;
+    memset(&cursor, 0, sizeof(cursor));
+    uint32_t epochNow = 0;
+    if (telemetryLog && telemetryLog->isClockValid() && (int32_t)(ringStart - from) > 0) {
+        uint32_t logTo = (int32_t)(ringStart - to) > 0 ? to : ringStart;
+        epochNow = telemetryLog->now();
+        uint32_t fromEpoch = epochNow - (now - from) / 1000;
+        uint32_t toEpoch = epochNow - (now - logTo) / 1000;
+        telemetryLog->start(cursor, fromEpoch, toEpoch, 0);
+        log = telemetryLog;
     }
+
+    // Log first, a block per call, then the ring TREND_SAMPLES_PER_CALL
+    // samples at a time - both only while the socket keeps up
+    TelemetryRing* ring = telemetry;
+    uint32_t sequence = first;
+    bool complete = true;
+    SimpleHTTPServer::produce(client, [stream, json, aggregator, log, cursor, epochNow, now, from, to,
+                                       ringStart, ring, sequence, end, complete](WiFiClient&) mutable {
+        if (!stream->connected()) return false;
+
+        if (log) {
+            bool reachedRing = false;
+            bool more = log->resume(cursor, [&](uint32_t epoch, const TelemetryRecord& record) {
+                TelemetryRecord sample = record;
+                sample.time = now - (epochNow - epoch) * 1000;
+                if ((int32_t)(sample.time - from) < 0) return true;
+                if ((int32_t)(sample.time - to) > 0 || (int32_t)(sample.time - ringStart) >= 0) {
+                    reachedRing = true;     // The ring has it
+                    return false;
+                }
+                return aggregator->add(sample) && stream->writable();
+            });
+            if (!more || reachedRing) {
+                log = nullptr;
+            }
+            return true;
+        }
+
+        size_t budget = TREND_SAMPLES_PER_CALL;
+        while (sequence != end && budget > 0 && stream->writable()) {
+            const TelemetryRecord* records;
+            size_t count = ring->segment(sequence, min((size_t)(end - sequence), budget), records);
+            size_t added = 0;
+            while (added < count && stream->writable()) {
+                aggregator->add(records[added++]);
+            }
+
+            // Lapped by the writer, between calls or during this run
+            if (count == 0 || !ring->isRetained(sequence)) {
+                complete = false;
+                sequence = end;
+                break;
+            }
+            sequence += added;
+            budget -= added;
+        }
+        if (sequence != end || !stream->writable()) return true;
+
+        aggregator->finish();
+        json->endArray();
+        json->field("complete", complete);
+        json->endObject();
+        stream->end();
+        return false;
+    });
+}
+
+void WebInterface::handleLog(WiFiClient& client, const String& method, const String& query) {
+    if (!telemetryLog) {
+        SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+        return;
+    }
+
+    String fromParam = SimpleHTTPServer::getQueryParam(query, "from");
+    String toParam = SimpleHTTPServer::getQueryParam(query, "to");
+
+    // Without a range: where the log stands
+    if (fromParam.length() == 0) {
+        TelemetryLogStats stats = telemetryLog->getStats();
+        StaticJsonDocument<384> doc;
+        doc["success"] = true;
+        doc["clockValid"] = telemetryLog->isClockValid();
+        doc["now"] = telemetryLog->now();
+        doc["firstFile"] = stats.firstFile;
+        doc["lastFile"] = stats.lastFile;
+        doc["blocksWritten"] = stats.blocksWritten;
+        doc["recordsLogged"] = stats.recordsLogged;
+        doc["dropped"] = stats.dropped;
+        doc["writeErrors"] = stats.writeErrors;
+        doc["lastWriteUs"] = stats.lastWriteUs;
+        doc["fsUsed"] = SPIFFS.usedBytes();
+        doc["fsTotal"] = SPIFFS.totalBytes();
+
+        String response;
+        serializeJson(doc, response);
+        SimpleHTTPServer::sendJSON(client, response);
+        return;
+    }
+
+    // Times are RTC seconds since 1970, "YYYY-MM-DD HH:MM[:SS]", or
+    // negative seconds back from now; `to` defaults to now
+    uint32_t now = telemetryLog->now();
+    auto parseTime = [now](const String& text, uint32_t& epoch) {
+        RTCDateTime time;
+        if (text.startsWith("-")) {
+            epoch = now + text.toInt();
+        } else if (text.indexOf('-') > 0) {
+            if (!PCF85063::parse(text.c_str(), time)) return false;
+            epoch = PCF85063::toEpoch(time);
+        } else {
+            epoch = strtoul(text.c_str(), nullptr, 10);
+        }
+        return true;
+    };
+
+    uint32_t from, to = now;
+    if (!parseTime(fromParam, from) || (toParam.length() > 0 && !parseTime(toParam, to))) {
+        SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid time\"}");
+        return;
+    }
+    uint32_t step = SimpleHTTPServer::getQueryParam(query, "step").toInt();
+
+    HTTPResponse response(client, 200);
+    response.header("Content-Type", "text/csv");
+    auto stream = std::make_shared<HTTPStream>(response);
+    stream->print("epoch,frequency_hz,current_a,voltage_v,status\n");
+
+    // Decoded a block at a time from flash, sent as the socket takes it
+    TelemetryLog* log = telemetryLog;
+    TelemetryLogCursor cursor;
+    log->start(cursor, from, to, step);
+    SimpleHTTPServer::produce(client, [log, stream, cursor](WiFiClient&) mutable {
+        if (!stream->connected()) return false;
+
+        bool more = log->resume(cursor, [&](uint32_t epoch, const TelemetryRecord& record) {
+            stream->printf("%u,%u.%02u,%u.%02u,%u.%u,%04X\n",
+                           epoch,
+                           record.frequency / 100, record.frequency % 100,
+                           record.current / 100, record.current % 100,
+                           record.voltage / 10, record.voltage % 10,
+                           record.statusWord);
+            return stream->writable();
+        });
+        if (!more) {
+            stream->end();
+        }
+        return more;
+    });
+}
+
+void WebInterface::handleFaults(WiFiClient& client, const String& method, const String& query) {
+    if (!flightRecorder) {
+        SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+        return;
+    }
+
+    if (method == "POST") {
+        DynamicJsonDocument doc(256);
+        if (!parseJSONBody(client, doc)) {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Invalid JSON\"}");
+            return;
+        }
+
+        String action = doc["action"] | "";
+        if (action == "trigger") {
+            bool success = flightRecorder->trigger();
+            SimpleHTTPServer::sendJSON(client, success ? "{\"success\":true,\"message\":\"Capture started\"}"
+                                                       : "{\"success\":false,\"error\":\"Recorder busy or no samples yet\"}");
+        } else if (action == "clear") {
+            bool success = flightRecorder->clear();
+            SimpleHTTPServer::sendJSON(client, success ? "{\"success\":true}"
+                                                       : "{\"success\":false,\"error\":\"Recorder is saving\"}");
+        } else {
+            SimpleHTTPServer::sendJSON(client, "{\"success\":false,\"error\":\"Unknown action\"}");
+        }
+        return;
+    }
+
+    // GET ?id=: one event's samples as CSV, time relative to the trigger
+    String idParam = SimpleHTTPServer::getQueryParam(query, "id");
+    if (idParam.length() > 0) {
+        uint32_t id = strtoul(idParam.c_str(), nullptr, 10);
+        FlightEventHeader header;
+        if (!flightRecorder->readHeader(id, header)) {
+            SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+            return;
+        }
+        File file = SPIFFS.open(FlightRecorder::path(id), FILE_READ);
+        if (!file) {
+            SimpleHTTPServer::send(client, 404, "text/plain", "Not Found");
+            return;
+        }
+        file.seek(sizeof(header));
+
+        HTTPResponse response(client, 200);
+        response.header("Content-Type", "text/csv");
+        HTTPStream stream(response);
+        stream.printf("# %s (0x%04X)\n", header.name, header.errorStatus);
+        stream.print("offset_ms,frequency_hz,current_a,voltage_v,status,error\n");
+
+        FlightSample sample;
+        while (file.read((uint8_t*)&sample, sizeof(sample)) == sizeof(sample)) {
+            const TelemetryRecord& record = sample.record;
+            stream.printf("%d,%u.%02u,%u.%02u,%u.%u,%04X,%04X\n",
+                          (int)(record.time - header.triggerTime),
+                          record.frequency / 100, record.frequency % 100,
+                          record.current / 100, record.current % 100,
+                          record.voltage / 10, record.voltage % 10,
+                          record.statusWord, sample.errorStatus);
+        }
+        file.close();
+        return;
+    }
+
+    // GET: recorder state and the saved events
+    FlightStats stats = flightRecorder->getStats();
+    HTTPResponse response(client, 200);
+    response.header("Content-Type", "application/json");
+    HTTPStream stream(response);
+    JsonWriter json(stream);
+
+    json.beginObject();
+    json.field("success", true);
+    json.field("state", FlightRecorder::stateName(flightRecorder->getState()));
+    json.field("triggers", stats.triggers);
+    json.field("saved", stats.saved);
+    json.field("saveErrors", stats.saveErrors);
+    json.field("skipped", stats.skipped);
+
+    // One header read per event, written as it is read
+    json.beginArray("events");
+    for (uint32_t id = flightRecorder->firstEvent(); id != flightRecorder->endEvent(); id++) {
+        FlightEventHeader header;
+        if (!flightRecorder->readHeader(id, header)) continue;
+
+        json.beginObject();
+        json.field("id", id);
+        json.field("name", header.name);
+        json.field("errorStatus", header.errorStatus);
+        json.field("manual", header.manual != 0);
+        json.field("preSamples", header.preCount);
+        json.field("postSamples", header.postCount);
+        if (header.epoch != 0) {
+            RTCDateTime time;
+            char text[24];
+            PCF85063::fromEpoch(header.epoch, time);
+            PCF85063::format(time, text, sizeof(text));
+            json.field("time", text);
+        }
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+}
+
+void WebInterface::handleEvents(WiFiClient& client, const String& method, const String& query) {
+    // ?interval= ms between events for this client, never faster than
+    // the status broadcast
+    long interval = SimpleHTTPServer::getQueryParam(query, "interval").toInt();
+    if (interval <= 0) {
+        interval = SSE_MIN_INTERVAL_MS;
+    }
+    interval = constrain(interval, SSE_MIN_INTERVAL_MS, SSE_MAX_INTERVAL_MS);
+
+    // Where a reconnecting EventSource left off; ?lastEventId= for
+    // clients that cannot set the header
+    char lastId[12] = "";
+    HTTPConnection* connection = SimpleHTTPServer::connectionOf(client);
+    const HTTPSlice* header = connection ? &connection->getRequest().lastEventId : nullptr;
+    if (header && header->length > 0 && header->length < sizeof(lastId)) {
+        memcpy(lastId, connection->text(*header), header->length);
+        lastId[header->length] = '\0';
+    } else {
+        strncpy(lastId, SimpleHTTPServer::getQueryParam(query, "lastEventId").c_str(), sizeof(lastId) - 1);
+    }
+    char* digitsEnd = lastId;
+    uint32_t resumeFrom = strtoul(lastId, &digitsEnd, 10);
+    bool resume = lastId[0] != '\0' && *digitsEnd == '\0';
+
+    if (!httpServer.beginEventStream(client, interval)) {
+        SimpleHTTPServer::send(client, 503, "text/plain", "Too many event streams");
+        return;
+    }
+    DEBUG_PRINTF("WebInterface: Event stream opened, %ld ms\n", interval);
+
+    if (resume && telemetry) {
+        replayEvents(client, resumeFrom);
+    }
+}
+
+void WebInterface::replayEvents(WiFiClient& client, uint32_t lastId) {
+    HTTPConnection* connection = SimpleHTTPServer::connectionOf(client);
+    if (!connection) return;
+
+    // An id from before a reboot can be ahead of the ring - nothing to resend
+    uint32_t end = telemetry->endSequence();
+    if ((int32_t)(end - lastId) <= 0) return;
+
+    uint32_t start = lastId;
+    uint32_t first = telemetry->firstSequence();
+    if ((int32_t)(start - first) < 0) {
+        start = first;
+    }
+
+    // Only what the connection queue takes now: past that the write would
+    // block the loop until the client reads. Counted back from the newest
+    // sample, with room for the gap event in front.
+    char frame[160];
+    size_t space = connection->writable();
+    space = space > sizeof(frame) ? space - sizeof(frame) : 0;
+    uint32_t replayFrom = end;
+    while (replayFrom != start && end - replayFrom < SSE_MAX_REPLAY) {
+        TelemetryRecord record;
+        if (!telemetry->getRecord(replayFrom - 1, record)) break;
+        size_t length = formatSampleEvent(frame, sizeof(frame), replayFrom - 1, record);
+        if (length > space) break;
+        space -= length;
+        replayFrom--;
+    }
+    start = replayFrom;
+
+    size_t length;
+    if (start != lastId) {
+        // Overwritten, or more than is worth resending
+        length = snprintf(frame, sizeof(frame), "event: gap\ndata: {\"from\":%u,\"to\":%u}\n\n", lastId, start);
+        client.write((const uint8_t*)frame, length);
+    }
+
+    for (uint32_t sequence = start; sequence != end; sequence++) {
+        TelemetryRecord record;
+        if (!telemetry->getRecord(sequence, record)) continue;
+        length = formatSampleEvent(frame, sizeof(frame), sequence, record);
+        client.write((const uint8_t*)frame, length);
+    }
+}
+
+size_t WebInterface::formatSampleEvent(char* frame, size_t size, uint32_t sequence,
+                                       const TelemetryRecord& record) {
+    // Same units as /api/trend; the id after each is the one to resume from
+    int length = snprintf(frame, size,
+                          "id: %u\nevent: sample\ndata: {\"time\":%u,\"frequency\":%u.%02u,"
+                          "\"current\":%u.%02u,\"voltage\":%u.%u,\"statusWord\":%u}\n\n",
+                          sequence + 1, record.time,
+                          record.frequency / 100, record.frequency % 100,
+                          record.current / 100, record.current % 100,
+                          record.voltage / 10, record.voltage % 10,
+                          record.statusWord);
+    return length > 0 && (size_t)length < size ? length : 0;
 }
 
 void WebInterface::handleWebSocketMessage(WebSocketClient* client, const uint8_t* data, size_t length, bool isText) {
@@ -299,29 +1841,17 @@ void WebInterface::handleWebSocketMessage(WebSocketClient* client, const uint8_t
 }
 
 bool WebInterface::parseJSONBody(WiFiClient& client, DynamicJsonDocument& doc) {
-    String body = "";
-    unsigned long timeout = millis() + 1000;
-
-    // Wait a bit for body to arrive
-    delay(10);
-
-    while (millis() < timeout) {
-        while (client.available()) {
-            char c = client.read();
-            body += c;
-            if (body.length() > 1024) {
-                DEBUG_PRINTLN("WebInterface: Body too large");
-                return false; // Body too large
-            }
-        }
-        if (body.length() > 0 && (body.indexOf('}') != -1 || body.indexOf(']') != -1)) {
-            break;
-        }
-        delay(1);
+    // The server has the whole body (Content-Length bytes) before calling us
+    HTTPConnection* connection = SimpleHTTPServer::connectionOf(client);
+    if (!connection || connection->getBodyLength() == 0) {
+        DEBUG_PRINTLN("WebInterface: No request body");
+        return false;
     }
 
-    DEBUG_PRINTF("WebInterface: Received body: %s\n", body.c_str());
+    const char* body = connection->getBody();
+    size_t length = connection->getBodyLength();
+    DEBUG_PRINTF("WebInterface: Received body: %.*s\n", (int)length, body);
 
-    DeserializationError error = deserializeJson(doc, body);
+    DeserializationError error = deserializeJson(doc, body, length);
     return !error;
 }
\ No newline at end of file
@@ -5,6 +5,17 @@
 #include "SimpleHTTPServer.h"
 #include "SimpleWebSocket.h"
 #include "ModbusVFD.h"
+#include "DriveGroup.h"
+#include "FollowerLoop.h"
+#include "PIDLoop.h"
+#include "PIDAutotuner.h"
+#include "RampGenerator.h"
+#include "RecipeEngine.h"
+#include "CalendarScheduler.h"
+#include "PresetSpeeds.h"
+#include "TelemetryRing.h"
+#include "TelemetryLog.h"
+#include "FlightRecorder.h"
 #include <ArduinoJson.h>
 
 class WebInterface {
@@ -21,23 +32,61 @@ public:
     // Update VFD status and broadcast to clients
     void updateStatus();
 
+    // Optional features (attach before begin)
+    void setDriveGroup(DriveGroup* group) { driveGroup = group; }
+    void setFollowerLoop(FollowerLoop* loop) { followerLoop = loop; }
+    void setPIDLoop(PIDLoop* loop) { pidLoop = loop; }
+    void setAutotuner(PIDAutotuner* tuner) { autotuner = tuner; }
+    void setRampGenerator(RampGenerator* ramp) { rampGenerator = ramp; }
+    void setRecipeEngine(RecipeEngine* engine) { recipeEngine = engine; }
+    void setCalendarScheduler(CalendarScheduler* scheduler) { calendarScheduler = scheduler; }
+    void setPresetSpeeds(PresetSpeeds* presets) { presetSpeeds = presets; }
+    void setTelemetryRing(TelemetryRing* ring) { telemetry = ring; }
+    void setTelemetryLog(TelemetryLog* log) { telemetryLog = log; }
+    void setFlightRecorder(FlightRecorder* recorder) { flightRecorder = recorder; }
+
 private:
     SimpleHTTPServer httpServer;
     SimpleWebSocketServer wsServer;
     ModbusVFD& vfd;
+    DriveGroup* driveGroup;
+    FollowerLoop* followerLoop;
+    PIDLoop* pidLoop;
+    PIDAutotuner* autotuner;
+    RampGenerator* rampGenerator;
+    RecipeEngine* recipeEngine;
+    CalendarScheduler* calendarScheduler;
+    PresetSpeeds* presetSpeeds;
+    TelemetryRing* telemetry;
+    TelemetryLog* telemetryLog;
+    FlightRecorder* flightRecorder;
 
     unsigned long lastStatusUpdate;
-    unsigned long lastVFDUpdate;
 
     // Setup HTTP routes
     void setupRoutes();
 
     // HTTP handlers
     void handleVFDStatus(WiFiClient& client, const String& method, const String& query);
+    void handleDriveStatus(WiFiClient& client, const String& method, const String& query);
     void handleVFDStart(WiFiClient& client, const String& method, const String& query);
     void handleVFDStop(WiFiClient& client, const String& method, const String& query);
     void handleVFDFrequency(WiFiClient& client, const String& method, const String& query);
     void handleSettings(WiFiClient& client, const String& method, const String& query);
+    void handleBusStats(WiFiClient& client, const String& method, const String& query);
+    void handleHTTPStats(WiFiClient& client, const String& method, const String& query);
+    void handleDriveGroup(WiFiClient& client, const String& method, const String& query);
+    void handleFollower(WiFiClient& client, const String& method, const String& query);
+    void handlePID(WiFiClient& client, const String& method, const String& query);
+    void handleAutotune(WiFiClient& client, const String& method, const String& query);
+    void handleRamp(WiFiClient& client, const String& method, const String& query);
+    void handleRecipe(WiFiClient& client, const String& method, const String& query);
+    void handleSchedule(WiFiClient& client, const String& method, const String& query);
+    void handlePresets(WiFiClient& client, const String& method, const String& query);
+    void handleTrend(WiFiClient& client, const String& method, const String& query);
+    void handleLog(WiFiClient& client, const String& method, const String& query);
+    void handleFaults(WiFiClient& client, const String& method, const String& query);
+    void handleEvents(WiFiClient& client, const String& method, const String& query);
 
     // WebSocket message handler
     void handleWebSocketMessage(WebSocketClient* client, const uint8_t* data, size_t length, bool isText);
@@ -45,6 +94,16 @@ private:
     // Helper to build status JSON
     String buildStatusJSON();
 
+    // Ring samples after `lastId` as "sample" events, for a resuming
+    // stream - as many of the newest as the connection queue takes
+    void replayEvents(WiFiClient& client, uint32_t lastId);
+    static size_t formatSampleEvent(char* frame, size_t size, uint32_t sequence,
+                                    const TelemetryRecord& record);
+
+    // Min/max/mean trend buckets, streamed
+    void sendTrendBuckets(WiFiClient& client, uint32_t first, uint32_t end,
+                          uint32_t from, uint32_t to, uint16_t buckets);
+
     // Parse JSON body from POST request
     bool parseJSONBody(WiFiClient& client, DynamicJsonDocument& doc);
 };
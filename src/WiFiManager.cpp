@@ -1,5 +1,6 @@
 #include "WiFiManager.h"
 #include <ArduinoJson.h>
+#include "JsonWriter.h"
 
 // Static member initialization
 WiFiManager* WiFiManager::instance = nullptr;
@@ -435,20 +436,20 @@ void WiFiManager::handleDNS() {
 // Web server route setup
 void WiFiManager::setupWebRoutes() {
     // API routes
-    webServer->on("/api/wifi/scan", [this](WiFiClient& client, const String& method, const String& query) {
+    webServer->on(HTTPMethod::GET, "/api/wifi/scan", [this](WiFiClient& client, const String& method, const String& query) {
         handleWiFiScan(client, method, query);
     });
 
-    webServer->on("/api/wifi/connect", [this](WiFiClient& client, const String& method, const String& query) {
+    webServer->on(HTTPMethod::POST, "/api/wifi/connect", [this](WiFiClient& client, const String& method, const String& query) {
         handleWiFiConnect(client, method, query);
     });
 
-    webServer->on("/api/wifi/status", [this](WiFiClient& client, const String& method, const String& query) {
+    webServer->on(HTTPMethod::GET, "/api/wifi/status", [this](WiFiClient& client, const String& method, const String& query) {
         handleWiFiStatus(client, method, query);
     });
 
     // Add a simple test endpoint
-    webServer->on("/api/test", [](WiFiClient& client, const String& method, const String& query) {
+    webServer->on(HTTPMethod::GET, "/api/test", [](WiFiClient& client, const String& method, const String& query) {
         SimpleHTTPServer::sendJSON(client, "{\"status\":\"ok\",\"message\":\"Web server is running!\"}");
     });
 }
@@ -460,30 +461,28 @@ void WiFiManager::handleWiFiScan(WiFiClient& client, const String& method, const
     // Perform WiFi scan
     int n = WiFi.scanNetworks();
 
-    // Build JSON response
-    DynamicJsonDocument doc(2048);
-    JsonArray networks = doc.createNestedArray("networks");
+    // Streamed network by network, however many there are
+    HTTPResponse response(client, 200);
+    response.header("Content-Type", "application/json");
+    HTTPStream stream(response);
+    JsonWriter json(stream);
 
+    json.beginObject();
+    json.beginArray("networks");
     for (int i = 0; i < n; i++) {
-        JsonObject network = networks.createNestedObject();
-        network["ssid"] = WiFi.SSID(i);
-        network["rssi"] = WiFi.RSSI(i);
-        network["encryption"] = (WiFi.encryptionType(i) != WIFI_AUTH_OPEN);
+        json.beginObject();
+        json.field("ssid", WiFi.SSID(i));
+        json.field("rssi", (int)WiFi.RSSI(i));
+        json.field("encryption", WiFi.encryptionType(i) != WIFI_AUTH_OPEN);
+        json.endObject();
     }
-
-    String response;
-    serializeJson(doc, response);
-
-    SimpleHTTPServer::sendJSON(client, response);
+    json.endArray();
+    json.endObject();
+    WiFi.scanDelete();
 }
 
 // Handle WiFi connect request
 void WiFiManager::handleWiFiConnect(WiFiClient& client, const String& method, const String& query) {
-    if (method != "POST") {
-        SimpleHTTPServer::send(client, 405, "text/plain", "Method Not Allowed");
-        return;
-    }
-
     // Read POST body
     String body = "";
     while (client.available()) {
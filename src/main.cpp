@@ -1,13 +1,95 @@
 #include <Arduino.h>
 #include "Config.h"
+#include <SPIFFS.h>
 #include "ModbusVFD.h"
+#include "RTUTransport.h"
+#include "ModbusTCPTransport.h"
 #include "WiFiManager.h"
 #include "WebInterface.h"
+#include "RTUBridge.h"
+#include "ModbusSlave.h"
+#include "DriveGroup.h"
+#include "FollowerLoop.h"
+#include "PollScheduler.h"
+#include "PIDLoop.h"
+#include "PIDAutotuner.h"
+#include "RampGenerator.h"
+#include "RecipeEngine.h"
+#include "PCF85063.h"
+#include "CalendarScheduler.h"
+#include "PresetSpeeds.h"
+#include "TelemetryRing.h"
+#include "TelemetryLog.h"
+#include "FlightRecorder.h"
+#include "AssetBundle.h"
 
 // Global objects
-ModbusVFD vfd;
+#if VFD_TRANSPORT_TCP
+ModbusTCPTransport vfdTransport(VFD_TCP_HOST, VFD_TCP_PORT);
+#else
+RTUTransport vfdTransport;
+#endif
+ModbusVFD vfd(vfdTransport);
 WiFiManager wifiManager;
 WebInterface* webInterface = nullptr;
+RTUBridge* rtuBridge = nullptr;
+ModbusSlave rtuSlave(vfd);
+DriveGroup driveGroup(vfdTransport);
+FollowerLoop followerLoop(vfdTransport);
+PollScheduler pollScheduler(vfd);
+PIDLoop pidLoop(vfd, pollScheduler);
+PIDAutotuner pidAutotuner(vfdTransport);
+RampGenerator rampGenerator(vfd);
+RecipeEngine recipeEngine(vfd, rampGenerator);
+PCF85063 rtc;
+CalendarScheduler calendarScheduler(vfd, rtc);
+PresetSpeeds presetSpeeds(vfdTransport);
+TelemetryRing telemetry;
+TelemetryLog telemetryLog(calendarScheduler);
+FlightRecorder flightRecorder(calendarScheduler);
+AssetBundle assetBundle;
+
+unsigned long lastVFDUpdate = 0;
+
+// Create the web interface and hook up the optional features
+bool startWebInterface() {
+    webInterface = new WebInterface(vfd);
+    webInterface->setDriveGroup(&driveGroup);
+    webInterface->setFollowerLoop(&followerLoop);
+    webInterface->setPIDLoop(&pidLoop);
+    webInterface->setAutotuner(&pidAutotuner);
+    webInterface->setRampGenerator(&rampGenerator);
+    webInterface->setRecipeEngine(&recipeEngine);
+    webInterface->setCalendarScheduler(&calendarScheduler);
+    webInterface->setPresetSpeeds(&presetSpeeds);
+    webInterface->setTelemetryRing(&telemetry);
+    webInterface->setTelemetryLog(&telemetryLog);
+    webInterface->setFlightRecorder(&flightRecorder);
+    if (webInterface->begin()) {
+        DEBUG_PRINTLN("✓ Web Interface started!");
+        DEBUG_PRINTF("✓ WebSocket server on port 81\n");
+        return true;
+    }
+
+    DEBUG_PRINTLN("✗ Failed to start Web Interface!");
+    delete webInterface;
+    webInterface = nullptr;
+    return false;
+}
+
+// Start the RTU-over-TCP bridge once the network is up
+void startRTUBridge() {
+    if (!RTU_BRIDGE_ENABLED || rtuBridge) return;
+
+    rtuBridge = new RTUBridge(vfd);
+    if (rtuBridge->begin()) {
+        DEBUG_PRINTF("✓ RTU bridge on port %d\n", RTU_BRIDGE_PORT);
+    } else {
+        DEBUG_PRINTLN("✗ Failed to start RTU bridge!");
+        delete rtuBridge;
+        rtuBridge = nullptr;
+    }
+}
 
 void setup() {
     // Initialize debug serial
@@ -20,6 +102,13 @@ void setup() {
     DEBUG_PRINTLN("Version: " FIRMWARE_VERSION);
     DEBUG_PRINTLN("==========================\n");
 
+    // Web pages from the mapped assets partition when one was uploaded,
+    // before any web server indexes its files
+    if (assetBundle.begin()) {
+        SimpleHTTPServer::setAssetBundle(&assetBundle);
+        DEBUG_PRINTF("✓ %u web assets in flash\n", (unsigned)assetBundle.getCount());
+    }
+
     // Initialize WiFi Manager
     DEBUG_PRINTLN("Initializing WiFi Manager...");
     if (wifiManager.begin()) {
@@ -37,6 +126,11 @@ void setup() {
         DEBUG_PRINTLN("✗ Failed to initialize WiFi Manager!");
     }
 
+    // Sample history, allocated before polling starts
+    if (!telemetry.begin()) {
+        DEBUG_PRINTLN("✗ No memory for the telemetry history!");
+    }
+
     // Initialize VFD communication
     vfd.enableDebug(false);  // Disable debug for cleaner operation
 
@@ -60,17 +154,60 @@ void setup() {
     params.rampDownTime = 5.0;
     vfd.setParameters(params);
 
+    // The local drive is the first group member; more are added over REST
+    driveGroup.setLimits(params.minFrequency, params.maxFrequency);
+    driveGroup.addDrive(MODBUS_SLAVE_ID);
+
+    // Master/follower loop runs in its own task once engaged
+    FollowerConfig followerConfig = followerLoop.getConfig();
+    followerConfig.minFrequency = params.minFrequency;
+    followerConfig.maxFrequency = params.maxFrequency;
+    followerLoop.setConfig(followerConfig);
+    if (followerLoop.begin() && VFD_FOLLOWER_ENABLED) {
+        followerLoop.engage();
+    }
+
+    // Bus task for scheduled reads and queued writes, then the process PID
+    pollScheduler.begin();
+    PIDConfig pidConfig = pidLoop.getConfig();
+    pidConfig.outMin = params.minFrequency;
+    pidConfig.outMax = params.maxFrequency;
+    pidLoop.setConfig(pidConfig);
+    if (pidLoop.begin() && PID_ENABLED) {
+        pidLoop.engage();
+    }
+
+    // Setpoint profiles, idle until given a target
+    rampGenerator.begin();
+
+    // Stored speed programs, started from the web interface
+    recipeEngine.begin();
+
+    // Calendar events from the RTC; saved events live on SPIFFS, which
+    // the web server would otherwise only mount once WiFi is up
+    if (!SPIFFS.begin(true)) {
+        DEBUG_PRINTLN("✗ Failed to mount SPIFFS - saved schedule not loaded");
+    }
+    calendarScheduler.begin();
+
+    // Long-term history on flash, time-stamped from the scheduler's clock
+    telemetryLog.begin();
+    flightRecorder.begin();
+
+    // RTU slave endpoint for PLCs without WiFi access
+    if (RTU_SLAVE_ENABLED) {
+        if (rtuSlave.begin()) {
+            DEBUG_PRINTF("✓ RTU slave endpoint on ID %d\n", RTU_SLAVE_ID);
+        } else {
+            DEBUG_PRINTLN("✗ Failed to start RTU slave endpoint!");
+        }
+    }
+
     // Initialize Web Interface if WiFi is ready (either connected or AP mode)
     if (wifiManager.isConnected() || wifiManager.isAPMode()) {
         DEBUG_PRINTLN("\nInitializing Web Interface...");
-        webInterface = new WebInterface(vfd);
-        if (webInterface->begin()) {
-            DEBUG_PRINTLN("✓ Web Interface started!");
-            DEBUG_PRINTF("✓ WebSocket server on port 81\n");
-        } else {
-            DEBUG_PRINTLN("✗ Failed to start Web Interface!");
-            delete webInterface;
-            webInterface = nullptr;
+        if (startWebInterface()) {
+            startRTUBridge();
         }
     }
 
@@ -86,18 +223,38 @@ void loop() {
     // Handle WiFi events
     wifiManager.handle();
 
+    // Apply queued setpoints/commands, then poll the drive. Polling lives
+    // here so the cached status stays fresh without a web client.
+    vfd.serviceCommands();
+    unsigned long now = millis();
+    if (now - lastVFDUpdate >= VFD_POLL_INTERVAL) {
+        lastVFDUpdate = now;
+        if (vfd.updateStatus()) {
+            TelemetryRecord record = TelemetryRing::toRecord(vfd.getStatus());
+            telemetry.append(record);
+            telemetryLog.append(record);
+            flightRecorder.sample(vfd.getStatus());
+        }
+    }
+
+    // Confirm the last group change
+    driveGroup.handle();
+
     // Handle web interface if active
     if (webInterface) {
         webInterface->handle();
     }
 
+    // Forward tunneled RTU frames
+    if (rtuBridge) {
+        rtuBridge->handle();
+    }
+
     // Check if we need to start web interface after WiFi is ready
     if (!webInterface && (wifiManager.isConnected() || wifiManager.isAPMode())) {
         DEBUG_PRINTLN("\nStarting Web Interface...");
-        webInterface = new WebInterface(vfd);
-        if (webInterface->begin()) {
-            DEBUG_PRINTLN("✓ Web Interface started!");
-            DEBUG_PRINTF("✓ WebSocket server on port 81\n");
+        if (startWebInterface()) {
+            startRTUBridge();
             if (wifiManager.isConnected()) {
                 DEBUG_PRINTLN("Control interface available at:");
                 DEBUG_PRINTF("  http://%s\n", wifiManager.getIP().c_str());
@@ -106,10 +263,6 @@ void loop() {
                 DEBUG_PRINTLN("Control interface available at:");
                 DEBUG_PRINTF("  http://%s (AP mode)\n", wifiManager.getIP().c_str());
             }
-        } else {
-            DEBUG_PRINTLN("✗ Failed to start Web Interface!");
-            delete webInterface;
-            webInterface = nullptr;
         }
     }
 
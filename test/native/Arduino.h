@@ -0,0 +1,46 @@
+// Arduino.h
+// Host stand-in for the parts of the Arduino core the natively tested
+// modules use: Print and a std::string backed String
+
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* data, size_t length) {
+        size_t written = 0;
+        while (length--) written += write(*data++);
+        return written;
+    }
+
+    size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+    size_t print(long number) { return printf("%ld", number); }
+    size_t print(unsigned long number) { return printf("%lu", number); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char text[64];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        if (length < 0) return 0;
+        return write((const uint8_t*)text, (size_t)length < sizeof(text) ? length : sizeof(text) - 1);
+    }
+};
+
+class String : public std::string {
+public:
+    String(const char* text = "") : std::string(text) {}
+};
+
+#endif // NATIVE_ARDUINO_H
@@ -0,0 +1,122 @@
+// test_main.cpp
+// JsonWriter output: separators across nesting, escapes and number formatting
+
+#include <unity.h>
+#include "JsonWriter.h"
+
+// Collects everything written
+class Capture : public Print {
+public:
+    std::string text;
+    size_t write(uint8_t c) override {
+        text += (char)c;
+        return 1;
+    }
+    size_t write(const uint8_t* data, size_t length) override {
+        text.append((const char*)data, length);
+        return length;
+    }
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_nested_separators() {
+    Capture out;
+    JsonWriter json(out);
+    json.beginObject();
+    json.field("a", 1).field("b", true);
+    json.beginArray("list");
+    json.value(1).value(2);
+    json.beginObject().field("x", "y").endObject();
+    json.beginArray().endArray();
+    json.null();
+    json.endArray();
+    json.beginObject("empty").endObject();
+    json.field("last", (const char*)nullptr);
+    json.endObject();
+
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"a\":1,\"b\":true,\"list\":[1,2,{\"x\":\"y\"},[],null],\"empty\":{},\"last\":null}",
+        out.text.c_str());
+}
+
+void test_top_level_array_of_objects() {
+    Capture out;
+    JsonWriter json(out);
+    json.beginArray();
+    for (int i = 0; i < 3; i++) {
+        json.beginObject().field("i", i).endObject();
+    }
+    json.endArray();
+    TEST_ASSERT_EQUAL_STRING("[{\"i\":0},{\"i\":1},{\"i\":2}]", out.text.c_str());
+}
+
+void test_string_escapes() {
+    Capture out;
+    JsonWriter json(out);
+    json.beginArray();
+    json.value("plain");
+    json.value("quote\" back\\slash");
+    json.value("line\nreturn\rtab\t");
+    json.value("\x01\x1f end");
+    json.value(String("from String"));
+    json.endArray();
+
+    TEST_ASSERT_EQUAL_STRING(
+        "[\"plain\",\"quote\\\" back\\\\slash\",\"line\\nreturn\\rtab\\t\","
+        "\"\\u0001\\u001f end\",\"from String\"]",
+        out.text.c_str());
+}
+
+void test_escaped_member_name() {
+    Capture out;
+    JsonWriter json(out);
+    json.beginObject().field("a\"b", 1).endObject();
+    TEST_ASSERT_EQUAL_STRING("{\"a\\\"b\":1}", out.text.c_str());
+}
+
+void test_integers() {
+    Capture out;
+    JsonWriter json(out);
+    json.beginArray();
+    json.value(-42).value(4000000000UL).value(-2147483647L - 1);
+    json.endArray();
+    TEST_ASSERT_EQUAL_STRING("[-42,4000000000,-2147483648]", out.text.c_str());
+}
+
+void test_doubles() {
+    Capture out;
+    JsonWriter json(out);
+    json.beginArray();
+    json.value(1.5);
+    json.value(2.0);
+    json.value(0.1, 2);
+    json.value(59.996, 2);      // Rounds up past the decimal point
+    json.value(-0.001, 2);      // Rounds to -0, printed as 0
+    json.value(NAN);
+    json.value(INFINITY);
+    json.value(1e300);          // Too long for the buffer
+    json.endArray();
+
+    TEST_ASSERT_EQUAL_STRING("[1.5,2,0.1,60,0,null,null,null]", out.text.c_str());
+}
+
+void test_double_field_decimals() {
+    Capture out;
+    JsonWriter json(out);
+    json.beginObject().field("hz", 50.123456, 1).endObject();
+    TEST_ASSERT_EQUAL_STRING("{\"hz\":50.1}", out.text.c_str());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_nested_separators);
+    RUN_TEST(test_top_level_array_of_objects);
+    RUN_TEST(test_string_escapes);
+    RUN_TEST(test_escaped_member_name);
+    RUN_TEST(test_integers);
+    RUN_TEST(test_doubles);
+    RUN_TEST(test_double_field_decimals);
+    return UNITY_END();
+}
@@ -0,0 +1,196 @@
+// test_main.cpp
+// TelemetryCodec round trips: varint/zigzag limits, worst-case records and
+// a block filled the way TelemetryLog::append() fills one
+
+#include <unity.h>
+#include "TelemetryCodec.h"
+
+static TelemetryRecord makeRecord(uint32_t time, uint16_t frequency, uint16_t current,
+                                  uint16_t voltage, uint16_t statusWord) {
+    TelemetryRecord record = { time, frequency, current, voltage, statusWord };
+    return record;
+}
+
+static void assertRecordsEqual(const TelemetryRecord& expected, const TelemetryRecord& actual) {
+    TEST_ASSERT_EQUAL_UINT32(expected.time, actual.time);
+    TEST_ASSERT_EQUAL_UINT16(expected.frequency, actual.frequency);
+    TEST_ASSERT_EQUAL_UINT16(expected.current, actual.current);
+    TEST_ASSERT_EQUAL_UINT16(expected.voltage, actual.voltage);
+    TEST_ASSERT_EQUAL_UINT16(expected.statusWord, actual.statusWord);
+}
+
+// Encodes `record` after `previous`, checks the size bound and decodes it back
+static size_t roundTrip(const TelemetryRecord& previous, const TelemetryRecord& record) {
+    uint8_t buffer[TELEMETRY_LOG_MAX_RECORD + 4];
+    memset(buffer, 0xA5, sizeof(buffer));
+
+    size_t length = TelemetryCodec::encode(buffer, previous, record);
+    TEST_ASSERT_TRUE(length > 0);
+    TEST_ASSERT_TRUE(length <= TELEMETRY_LOG_MAX_RECORD);
+    TEST_ASSERT_EQUAL_HEX8(0xA5, buffer[length]);
+
+    TelemetryRecord decoded;
+    TEST_ASSERT_EQUAL(length, TelemetryCodec::decode(buffer, length, previous, decoded));
+    assertRecordsEqual(record, decoded);
+    return length;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_zigzag_round_trip() {
+    const int32_t values[] = {
+        0, 1, -1, 63, -64, 64, -65, 32767, -32768, 65535, -65535,
+        INT32_MAX, INT32_MIN, INT32_MAX - 1, INT32_MIN + 1
+    };
+    for (int32_t value : values) {
+        TEST_ASSERT_EQUAL_INT32(value, TelemetryCodec::unzigzag(TelemetryCodec::zigzag(value)));
+    }
+
+    // Small magnitudes of either sign stay small
+    TEST_ASSERT_EQUAL_UINT32(0, TelemetryCodec::zigzag(0));
+    TEST_ASSERT_EQUAL_UINT32(1, TelemetryCodec::zigzag(-1));
+    TEST_ASSERT_EQUAL_UINT32(2, TelemetryCodec::zigzag(1));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, TelemetryCodec::zigzag(INT32_MIN));
+}
+
+void test_varint_lengths_and_round_trip() {
+    struct { uint32_t value; size_t length; } cases[] = {
+        { 0, 1 }, { 127, 1 }, { 128, 2 }, { 16383, 2 }, { 16384, 3 },
+        { 131070, 3 }, { 2097151, 3 }, { 2097152, 4 }, { 268435455, 4 },
+        { 268435456, 5 }, { UINT32_MAX, 5 }
+    };
+    for (auto& entry : cases) {
+        uint8_t buffer[8];
+        TEST_ASSERT_EQUAL(entry.length, TelemetryCodec::putVarint(buffer, entry.value));
+
+        uint32_t value = 0;
+        TEST_ASSERT_EQUAL(entry.length, TelemetryCodec::getVarint(buffer, sizeof(buffer), value));
+        TEST_ASSERT_EQUAL_UINT32(entry.value, value);
+
+        // Every cut short of the last byte is rejected
+        for (size_t cut = 0; cut < entry.length; cut++) {
+            TEST_ASSERT_EQUAL(0, TelemetryCodec::getVarint(buffer, cut, value));
+        }
+    }
+}
+
+void test_varint_rejects_overlong() {
+    const uint8_t overlong[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01 };
+    uint32_t value;
+    TEST_ASSERT_EQUAL(0, TelemetryCodec::getVarint(overlong, sizeof(overlong), value));
+}
+
+void test_unchanged_record_is_two_bytes() {
+    TelemetryRecord previous = makeRecord(1000, 5000, 120, 2300, 0x0003);
+    TelemetryRecord record = previous;
+    record.time += 100;
+    TEST_ASSERT_EQUAL(2, roundTrip(previous, record));
+}
+
+void test_worst_case_deltas() {
+    TelemetryRecord low = makeRecord(0, 0, 0, 0, 0);
+    TelemetryRecord high = makeRecord(UINT32_MAX, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF);
+
+    // Largest time step and full-scale swings in both directions hit the bound exactly
+    TEST_ASSERT_EQUAL(TELEMETRY_LOG_MAX_RECORD, roundTrip(low, high));
+    TEST_ASSERT_EQUAL(TELEMETRY_LOG_MAX_RECORD, roundTrip(high, makeRecord(UINT32_MAX - 1, 0, 0, 0, 0)));
+}
+
+void test_time_wraps() {
+    // millis() rolls over between two samples
+    TelemetryRecord previous = makeRecord(0xFFFFFF00, 100, 200, 300, 1);
+    TelemetryRecord record = makeRecord(0x00000010, 100, 200, 300, 1);
+    TEST_ASSERT_EQUAL(3, roundTrip(previous, record));
+}
+
+void test_truncated_record_rejected() {
+    TelemetryRecord previous = makeRecord(0, 0, 0, 0, 0);
+    TelemetryRecord record = makeRecord(UINT32_MAX, 0xFFFF, 0x8000, 0x7FFF, 0xFFFF);
+
+    uint8_t buffer[TELEMETRY_LOG_MAX_RECORD];
+    size_t length = TelemetryCodec::encode(buffer, previous, record);
+    TelemetryRecord decoded;
+    for (size_t cut = 0; cut < length; cut++) {
+        TEST_ASSERT_EQUAL(0, TelemetryCodec::decode(buffer, cut, previous, decoded));
+    }
+}
+
+// Fills one block payload by the rule TelemetryLog::append() uses - stop
+// once the next worst-case record might not fit - then decodes it all
+static void fillAndCheck(TelemetryRecord (*next)(uint32_t index, const TelemetryRecord& previous),
+                         uint16_t expectedCount) {
+    static uint8_t payload[TELEMETRY_LOG_PAYLOAD];
+    static TelemetryRecord records[TELEMETRY_LOG_PAYLOAD];
+    memset(payload, 0xFF, sizeof(payload));
+
+    records[0] = makeRecord(12345, 5000, 100, 2200, 0x0002);
+    size_t length = 0;
+    uint16_t count = 1;
+    while (length + TELEMETRY_LOG_MAX_RECORD <= TELEMETRY_LOG_PAYLOAD) {
+        records[count] = next(count, records[count - 1]);
+        size_t used = TelemetryCodec::encode(payload + length, records[count - 1], records[count]);
+        TEST_ASSERT_TRUE(used <= TELEMETRY_LOG_MAX_RECORD);
+        length += used;
+        count++;
+    }
+    TEST_ASSERT_TRUE(length <= TELEMETRY_LOG_PAYLOAD);
+    TEST_ASSERT_TRUE(length <= UINT16_MAX);
+    if (expectedCount) {
+        TEST_ASSERT_EQUAL_UINT16(expectedCount, count);
+    }
+
+    // Decode the way TelemetryLog::query() walks a block
+    TelemetryRecord record = records[0];
+    size_t position = 0;
+    for (uint16_t i = 1; i < count; i++) {
+        TelemetryRecord decoded;
+        size_t used = TelemetryCodec::decode(payload + position, length - position, record, decoded);
+        TEST_ASSERT_TRUE(used > 0);
+        position += used;
+        assertRecordsEqual(records[i], decoded);
+        record = decoded;
+    }
+    TEST_ASSERT_EQUAL(length, position);
+}
+
+static TelemetryRecord worstCase(uint32_t index, const TelemetryRecord& previous) {
+    // Every field swings full scale and time jumps past 2^28 ms
+    uint16_t level = (index & 1) ? 0 : 0xFFFF;
+    return makeRecord(previous.time + 0x10000000 + index, level, level, level, level);
+}
+
+static TelemetryRecord mixed(uint32_t index, const TelemetryRecord& previous) {
+    // Deterministic mix of steady samples, small drift and large steps
+    uint32_t hash = index * 2654435761u;
+    TelemetryRecord record = previous;
+    record.time += 100 + (hash % 7 == 0 ? hash : hash % 50);
+    if (hash & 0x01) record.frequency += (int16_t)(hash >> 8);
+    if (hash & 0x02) record.current -= (hash >> 16) & 0x3F;
+    if (hash & 0x04) record.voltage ^= (uint16_t)(hash >> 4);
+    if ((hash & 0x38) == 0) record.statusWord = (uint16_t)hash;
+    return record;
+}
+
+void test_block_filled_with_worst_case_records() {
+    // Every record at the bound: the block takes exactly floor(payload / max) of them
+    fillAndCheck(worstCase, 1 + TELEMETRY_LOG_PAYLOAD / TELEMETRY_LOG_MAX_RECORD);
+}
+
+void test_block_filled_with_mixed_records() {
+    fillAndCheck(mixed, 0);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_zigzag_round_trip);
+    RUN_TEST(test_varint_lengths_and_round_trip);
+    RUN_TEST(test_varint_rejects_overlong);
+    RUN_TEST(test_unchanged_record_is_two_bytes);
+    RUN_TEST(test_worst_case_deltas);
+    RUN_TEST(test_time_wraps);
+    RUN_TEST(test_truncated_record_rejected);
+    RUN_TEST(test_block_filled_with_worst_case_records);
+    RUN_TEST(test_block_filled_with_mixed_records);
+    return UNITY_END();
+}